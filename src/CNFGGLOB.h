@@ -14,6 +14,7 @@
 #define LittleEndianUnaligned 0
 #define MayInline inline
 #define MayNotInline __attribute__((noinline))
+#define AlwaysInline inline __attribute__((always_inline))
 #define SmallGlobals 0
 #define cIncludeUnused 0
 #define UnusedParam(p) (void) p
@@ -89,4 +90,10 @@ typedef si5b si5r;
 
 #define IncludeHostTextClipExchange 0
 #define EnableAutoSlow 0
+#define EnableFrameGovernor 1
+#define EnableClockMult 1
+#define EnableFastTiming 1
+#define EnableDynarec 0
+#define WantDynarecCheck 0
+#define EnableScreenDirtyRows 1
 #define EmLocalTalk 0
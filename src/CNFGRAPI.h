@@ -10,6 +10,7 @@
 #include <3ds.h>
 #include <citro3d.h>
 #include <png.h>
+#include <zlib.h>
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -29,11 +30,22 @@
 #define WantInitRunInBackground 0
 #define WantInitNotAutoSlow 0
 #define WantInitSpeedValue -1
+#define WantInitClockMultValue 0
+#define WantInitDynarecMode 0
 #define NeedRequestInsertDisk 0
 #define NeedDoMoreCommandsMsg 0
 #define NeedDoAboutMsg 0
 #define UseControlKeys 1
 #define UseActvCode 0
+#define UseEmThread 1
+#define UseFramePipe 0
+#define kFramePipeWorkers 2
+#define WantVSyncPacing 1
+#define WantPaceStats 0
+#define WantScreenBands 1
+#define WantUploadStats 0
+#define WantPresentStats 0
+#define WantScreenCapture 0
 #define EnableDemoMsg 0
 
 /* version and other info to display to user */
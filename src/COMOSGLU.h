@@ -67,6 +67,27 @@ GLOBALVAR blnr WantMacReset = falseblnr;
 
 GLOBALVAR ui3b SpeedValue = WantInitSpeedValue;
 
+#if EnableFastTiming
+GLOBALVAR blnr WantFastTiming = falseblnr;
+	/*
+		flat cost per instruction, rather than by
+		opcode, less accurate but quicker
+	*/
+#endif
+
+#if EnableClockMult
+GLOBALVAR ui3b ClockMultValue = WantInitClockMultValue;
+	/* log2 of how much faster than normal the emulated cpu runs */
+#endif
+
+#if EnableDynarec
+GLOBALVAR ui3b DynarecMode = WantInitDynarecMode;
+	/*
+		0 to only interpret, 1 to run blocks with the dynamic
+		recompiler, 2 to also check each against the interpreter
+	*/
+#endif
+
 #if EnableAutoSlow
 GLOBALVAR blnr WantNotAutoSlow = (WantInitNotAutoSlow != 0);
 #endif
@@ -230,6 +251,7 @@ LOCALPROC DiskEjectedNotify(tDrive Drive_No)
 #define ln2uiblockbitsn (3 + ln2uiblockn)
 #define uiblockbitsn (8 * uiblockn)
 
+#if 0 != vMacScreenDepth
 LOCALFUNC blnr FindFirstChangeInLVecs(uibb *ptr1, uibb *ptr2,
 					uimr L, uimr *j)
 {
@@ -313,11 +335,58 @@ Label_3:
 	*LeftMask0 = LeftMask;
 	*RightMask0 = RightMask;
 }
+#endif
 
 LOCALVAR ui3p screencomparebuff = nullpr;
 
 LOCALVAR uimr NextDrawRow = 0;
 
+#if EnableScreenDirtyRows
+GLOBALVAR ui5b ScreenDirtyRows[kScreenDirtyRowsN];
+
+LOCALFUNC blnr ScreenDirtyRange(uimr *top, uimr *bottom)
+{
+	/*
+		find the first and last dirty rows, from NextDrawRow on.
+	*/
+	uimr i = NextDrawRow;
+	uimr j = vMacScreenHeight;
+
+	while ((i < j) && ! ScreenDirtyRowTst(i)) {
+		if (0 == ScreenDirtyRows[i >> 5]) {
+			i = (i | 31) + 1;
+		} else {
+			++i;
+		}
+	}
+	if (i >= j) {
+		return falseblnr;
+	}
+	while (! ScreenDirtyRowTst(j - 1)) {
+		--j;
+	}
+
+	*top = i;
+	*bottom = j;
+	return trueblnr;
+}
+
+LOCALPROC ScreenDirtyClear(uimr top, uimr bottom)
+{
+	uimr i = top;
+
+	while (i < bottom) {
+		if ((0 == (i & 31)) && (i + 32 <= bottom)) {
+			ScreenDirtyRows[i >> 5] = 0;
+			i += 32;
+		} else {
+			ScreenDirtyRows[i >> 5] &= ~ ((ui5b)1 << (i & 31));
+			++i;
+		}
+	}
+}
+#endif
+
 
 #if BigEndianUnaligned
 
@@ -339,11 +408,64 @@ LOCALVAR uimr NextDrawRow = 0;
 LOCALVAR blnr ColorTransValid = falseblnr;
 #endif
 
+/*
+	The changed areas found by the last ScreenFindChanges, as a
+	list of rectangles covering runs of changed rows. If there
+	are more runs than fit, the last rectangle grows to cover
+	the rest.
+*/
+
+#define kMaxScrnSpans 8
+
+LOCALVAR uimr ScrnSpanN = 0;
+LOCALVAR ui4r ScrnSpanTop[kMaxScrnSpans];
+LOCALVAR ui4r ScrnSpanLeft[kMaxScrnSpans];
+LOCALVAR ui4r ScrnSpanBottom[kMaxScrnSpans];
+LOCALVAR ui4r ScrnSpanRight[kMaxScrnSpans];
+
+LOCALPROC ScrnSpanAddRow(uimr i, uimr left, uimr right)
+{
+	uimr n = ScrnSpanN;
+
+	if ((0 != n)
+		&& ((ScrnSpanBottom[n - 1] == i) || (kMaxScrnSpans == n)))
+	{
+		--n;
+		ScrnSpanBottom[n] = i + 1;
+		if (left < ScrnSpanLeft[n]) {
+			ScrnSpanLeft[n] = left;
+		}
+		if (right > ScrnSpanRight[n]) {
+			ScrnSpanRight[n] = right;
+		}
+	} else {
+		ScrnSpanTop[n] = i;
+		ScrnSpanBottom[n] = i + 1;
+		ScrnSpanLeft[n] = left;
+		ScrnSpanRight[n] = right;
+		ScrnSpanN = n + 1;
+	}
+}
+
+#if EnableFrameGovernor
+GLOBALVAR ui4r EmMaxRowsDrawn = vMacScreenHeight;
+	/* set by the frame governor */
+GLOBALVAR ui5b EmRowsDeferred = 0;
+	/* rows left for a later tick by EmMaxRowsDrawn, a count */
+#endif
+
 LOCALFUNC blnr ScreenFindChanges(ui3p screencurrentbuff,
 	si3b TimeAdjust, si4b *top, si4b *left, si4b *bottom, si4b *right)
 {
+#if 0 != vMacScreenDepth
 	uimr j0;
 	uimr j1;
+	uimr LeftMin;
+	uimr RightMax;
+	uibr LeftMask;
+	uibr RightMask;
+	int j;
+#endif
 	uimr j0h;
 	uimr j1h;
 	uimr j0v;
@@ -353,12 +475,15 @@ LOCALFUNC blnr ScreenFindChanges(ui3p screencurrentbuff,
 	uimr copyrows;
 	uimr LimitDrawRow;
 	uimr MaxRowsDrawnPerTick;
-	uimr LeftMin;
-	uimr RightMax;
-	uibr LeftMask;
-	uibr RightMask;
-	int j;
+	uimr DirtyTop = NextDrawRow;
+	uimr DirtyBottom = vMacScreenHeight;
+
+	ScrnSpanN = 0;
 
+#if EnableFrameGovernor
+	UnusedParam(TimeAdjust);
+	MaxRowsDrawnPerTick = EmMaxRowsDrawn;
+#else
 	if (TimeAdjust < 4) {
 		MaxRowsDrawnPerTick = vMacScreenHeight;
 	} else if (TimeAdjust < 6) {
@@ -366,6 +491,7 @@ LOCALFUNC blnr ScreenFindChanges(ui3p screencurrentbuff,
 	} else {
 		MaxRowsDrawnPerTick = vMacScreenHeight / 4;
 	}
+#endif
 
 #if 0 != vMacScreenDepth
 	if (UseColorMode) {
@@ -480,69 +606,67 @@ Label_2c:
 		} else
 #endif
 		{
-			if (! FindFirstChangeInLVecs(
-				(uibb *)screencurrentbuff
-					+ NextDrawRow * (vMacScreenWidth / uiblockbitsn),
-				(uibb *)screencomparebuff
-					+ NextDrawRow * (vMacScreenWidth / uiblockbitsn),
-				((uimr)(vMacScreenHeight - NextDrawRow)
-					* (uimr)vMacScreenWidth) / uiblockbitsn,
-				&j0))
-			{
+			uimr i;
+			uimr l;
+			uimr r;
+			ui3p p1;
+			ui3p p2;
+
+#if EnableScreenDirtyRows
+			if (! ScreenDirtyRange(&DirtyTop, &DirtyBottom)) {
+				/* nothing written since last compared */
 				NextDrawRow = 0;
 				return falseblnr;
 			}
-			j0v = j0 / (vMacScreenWidth / uiblockbitsn);
-			j0h = j0 - j0v * (vMacScreenWidth / uiblockbitsn);
-			j0v += NextDrawRow;
-			LimitDrawRow = j0v + MaxRowsDrawnPerTick;
-			if (LimitDrawRow >= vMacScreenHeight) {
-				LimitDrawRow = vMacScreenHeight;
+#endif
+			LimitDrawRow = DirtyBottom;
+			j0v = 0;
+			j1v = 0;
+			j0h = vMacScreenWidth;
+			j1h = 0;
+			p1 = screencurrentbuff + DirtyTop * vMacScreenMonoByteWidth;
+			p2 = screencomparebuff + DirtyTop * vMacScreenMonoByteWidth;
+			for (i = DirtyTop; i < LimitDrawRow; ++i) {
+				if (
+#if EnableScreenDirtyRows
+					ScreenDirtyRowTst(i) &&
+#endif
+					ScrnDiffRow(p1, p2, vMacScreenMonoByteWidth,
+						&l, &r))
+				{
+					if (0 == ScrnSpanN) {
+						j0v = i;
+						if (i + MaxRowsDrawnPerTick < LimitDrawRow) {
+							LimitDrawRow = i + MaxRowsDrawnPerTick;
+						}
+					}
+					ScrnSpanAddRow(i, l, r);
+					if (l < j0h) {
+						j0h = l;
+					}
+					if (r > j1h) {
+						j1h = r;
+					}
+					j1v = i + 1;
+				}
+				p1 += vMacScreenMonoByteWidth;
+				p2 += vMacScreenMonoByteWidth;
+			}
+			if (LimitDrawRow >= DirtyBottom) {
 				NextDrawRow = 0;
 			} else {
 				NextDrawRow = LimitDrawRow;
+#if EnableFrameGovernor
+				EmRowsDeferred += DirtyBottom - LimitDrawRow;
+#endif
 			}
-			FindLastChangeInLVecs((uibb *)screencurrentbuff,
-				(uibb *)screencomparebuff,
-				((uimr)LimitDrawRow
-					* (uimr)vMacScreenWidth) / uiblockbitsn,
-				&j1);
-			j1v = j1 / (vMacScreenWidth / uiblockbitsn);
-			j1h = j1 - j1v * (vMacScreenWidth / uiblockbitsn);
-			j1v++;
-
-			if (j0h < j1h) {
-				LeftMin = j0h;
-				RightMax = j1h;
-			} else {
-				LeftMin = j1h;
-				RightMax = j0h;
-			}
-
-			FindLeftRightChangeInLMat((uibb *)screencurrentbuff,
-				(uibb *)screencomparebuff,
-				(vMacScreenWidth / uiblockbitsn),
-				j0v, j1v, &LeftMin, &LeftMask, &RightMax, &RightMask);
-
-			for (j = 0; j < uiblockbitsn; ++j) {
-				if (0 != (LeftMask
-					& (((uibr)1) << (j ^ FlipCheckMonoBits))))
-				{
-					goto Label_1;
-				}
-			}
-Label_1:
-			j0h = LeftMin * uiblockbitsn + j;
-
-			for (j = uiblockbitsn; --j >= 0; ) {
-				if (0 != (RightMask
-					& (((uibr)1) << (j ^ FlipCheckMonoBits))))
-				{
-					goto Label_2;
-				}
+#if EnableScreenDirtyRows
+			/* compared here, and copied below */
+			ScreenDirtyClear(DirtyTop, LimitDrawRow);
+#endif
+			if (0 == ScrnSpanN) {
+				return falseblnr;
 			}
-Label_2:
-			j1h = RightMax * uiblockbitsn + j + 1;
 		}
 
 		copyrows = j1v - j0v;
@@ -554,6 +678,11 @@ Label_2:
 		(anyp)screencomparebuff + copyoffset,
 		copysize);
 
+	if (0 == ScrnSpanN) {
+		ScrnSpanAddRow(j0v, j0h, j1h);
+		ScrnSpanBottom[0] = j1v;
+	}
+
 	*top = j0v;
 	*left = j0h;
 	*bottom = j1v;
@@ -564,6 +693,12 @@ Label_2:
 
 GLOBALVAR blnr EmVideoDisable = falseblnr;
 GLOBALVAR si3b EmLagTime = 0;
+GLOBALVAR ui3b EmIdlePercent = 0;
+	/*
+		Percentage of emulated cpu time over the last
+		emulated second spent stopped or in a polling
+		loop, that was skipped rather than interpreted.
+	*/
 
 GLOBALVAR ui5b OnTrueTime = 0;
 	/*
@@ -576,12 +711,57 @@ LOCALVAR si4b ScreenChangedLeft;
 LOCALVAR si4b ScreenChangedBottom;
 LOCALVAR si4b ScreenChangedRight;
 
+#ifndef WantScreenBands
+#define WantScreenBands 0
+#endif
+
+#if WantScreenBands
+/*
+	The changed rows, as a bit per band of kScreenBandRows
+	rows, for hosts that upload the screen in tiles and want
+	more than one rectangle.
+*/
+
+#ifndef kScreenBandRows
+#define kScreenBandRows 8
+#endif
+
+#define kScreenBandsN \
+	((vMacScreenHeight + kScreenBandRows - 1) / kScreenBandRows)
+#define kScreenBandWords ((kScreenBandsN + 31) / 32)
+
+#define ScreenBandTst(p, i) \
+	(0 != ((p)[(i) >> 5] & ((ui5b)1 << ((i) & 31))))
+
+LOCALVAR ui5b ScreenChangedBands[kScreenBandWords];
+
+LOCALPROC ScreenBandsSet(ui5b *p, uimr top, uimr bottom)
+{
+	uimr i;
+
+	for (i = top / kScreenBandRows;
+		i < (bottom + kScreenBandRows - 1) / kScreenBandRows; ++i)
+	{
+		p[i >> 5] |= ((ui5b)1 << (i & 31));
+	}
+}
+#endif
+
 LOCALPROC ScreenClearChanges(void)
 {
 	ScreenChangedTop = vMacScreenHeight;
 	ScreenChangedBottom = 0;
 	ScreenChangedLeft = vMacScreenWidth;
 	ScreenChangedRight = 0;
+#if WantScreenBands
+	{
+		int i;
+
+		for (i = 0; i < kScreenBandWords; ++i) {
+			ScreenChangedBands[i] = 0;
+		}
+	}
+#endif
 }
 
 LOCALPROC ScreenChangedAll(void)
@@ -590,6 +770,29 @@ LOCALPROC ScreenChangedAll(void)
 	ScreenChangedBottom = vMacScreenHeight;
 	ScreenChangedLeft = 0;
 	ScreenChangedRight = vMacScreenWidth;
+#if WantScreenBands
+	ScreenBandsSet(ScreenChangedBands, 0, vMacScreenHeight);
+#endif
+}
+
+LOCALPROC ScreenChangedAdd(si4b top, si4b left,
+	si4b bottom, si4b right)
+{
+	if (top < ScreenChangedTop) {
+		ScreenChangedTop = top;
+	}
+	if (bottom > ScreenChangedBottom) {
+		ScreenChangedBottom = bottom;
+	}
+	if (left < ScreenChangedLeft) {
+		ScreenChangedLeft = left;
+	}
+	if (right > ScreenChangedRight) {
+		ScreenChangedRight = right;
+	}
+#if WantScreenBands
+	ScreenBandsSet(ScreenChangedBands, top, bottom);
+#endif
 }
 
 #if EnableAutoSlow
@@ -597,6 +800,63 @@ LOCALVAR si4b ScreenChangedQuietTop = vMacScreenHeight;
 LOCALVAR si4b ScreenChangedQuietLeft = vMacScreenWidth;
 LOCALVAR si4b ScreenChangedQuietBottom = 0;
 LOCALVAR si4b ScreenChangedQuietRight = 0;
+
+/*
+	Counts a change toward ending the quiet, unless it stays
+	within a text cursor sized area.
+*/
+LOCALPROC ScreenQuietAdd(si4b top, si4b left, si4b bottom, si4b right)
+{
+	if (top < ScreenChangedQuietTop) {
+		ScreenChangedQuietTop = top;
+	}
+	if (bottom > ScreenChangedQuietBottom) {
+		ScreenChangedQuietBottom = bottom;
+	}
+	if (left < ScreenChangedQuietLeft) {
+		ScreenChangedQuietLeft = left;
+	}
+	if (right > ScreenChangedQuietRight) {
+		ScreenChangedQuietRight = right;
+	}
+
+	if (((ScreenChangedQuietRight - ScreenChangedQuietLeft) > 1)
+		|| ((ScreenChangedQuietBottom
+			- ScreenChangedQuietTop) > 32))
+	{
+		ScreenChangedQuietTop = vMacScreenHeight;
+		ScreenChangedQuietLeft = vMacScreenWidth;
+		ScreenChangedQuietBottom = 0;
+		ScreenChangedQuietRight = 0;
+
+		QuietEnds();
+	}
+}
+#endif
+
+#ifndef WantScreenCapture
+#define WantScreenCapture 0
+#endif
+
+#if WantScreenCapture
+/*
+	Called after every compare, with the spans of what changed
+	(if anything) and screencomparebuff holding what is shown.
+*/
+FORWARDPROC ScreenCaptureFrame(void);
+#endif
+
+#ifndef UseFramePipe
+#define UseFramePipe 0
+#endif
+
+#if UseFramePipe
+/*
+	Hands the frame to the frame pipeline instead of comparing
+	it here, and returns true, or false if it must be compared
+	here after all.
+*/
+FORWARDFUNC blnr ScreenPipeFrame(ui3p screencurrentbuff);
 #endif
 
 GLOBALPROC Screen_OutputFrame(ui3p screencurrentbuff)
@@ -607,6 +867,11 @@ GLOBALPROC Screen_OutputFrame(ui3p screencurrentbuff)
 	si4b right;
 
 	if (! EmVideoDisable) {
+#if UseFramePipe
+		if (ScreenPipeFrame(screencurrentbuff)) {
+			return;
+		}
+#endif
 		if (ScreenFindChanges(screencurrentbuff, EmLagTime,
 			&top, &left, &bottom, &right))
 		{
@@ -622,34 +887,24 @@ GLOBALPROC Screen_OutputFrame(ui3p screencurrentbuff)
 			if (right > ScreenChangedRight) {
 				ScreenChangedRight = right;
 			}
-
-#if EnableAutoSlow
-			if (top < ScreenChangedQuietTop) {
-				ScreenChangedQuietTop = top;
-			}
-			if (bottom > ScreenChangedQuietBottom) {
-				ScreenChangedQuietBottom = bottom;
-			}
-			if (left < ScreenChangedQuietLeft) {
-				ScreenChangedQuietLeft = left;
-			}
-			if (right > ScreenChangedQuietRight) {
-				ScreenChangedQuietRight = right;
-			}
-
-			if (((ScreenChangedQuietRight - ScreenChangedQuietLeft) > 1)
-				|| ((ScreenChangedQuietBottom
-					- ScreenChangedQuietTop) > 32))
+#if WantScreenBands
 			{
-				ScreenChangedQuietTop = vMacScreenHeight;
-				ScreenChangedQuietLeft = vMacScreenWidth;
-				ScreenChangedQuietBottom = 0;
-				ScreenChangedQuietRight = 0;
+				uimr i;
 
-				QuietEnds();
+				for (i = 0; i < ScrnSpanN; ++i) {
+					ScreenBandsSet(ScreenChangedBands,
+						ScrnSpanTop[i], ScrnSpanBottom[i]);
+				}
 			}
 #endif
+
+#if EnableAutoSlow
+			ScreenQuietAdd(top, left, bottom, right);
+#endif
 		}
+#if WantScreenCapture
+		ScreenCaptureFrame();
+#endif
 	}
 }
 
@@ -44,7 +44,8 @@ enum {
 
 LOCALVAR uimr SpecialModes = 0;
 
-LOCALVAR blnr NeedWholeScreenDraw = falseblnr;
+LOCALVAR blnr NeedSpclModeDraw = falseblnr;
+	/* set when what the special modes show has changed */
 
 #define SpecialModeSet(i) SpecialModes |= (1 << (i))
 #define SpecialModeClr(i) SpecialModes &= ~ (1 << (i))
@@ -54,94 +55,179 @@ LOCALVAR blnr NeedWholeScreenDraw = falseblnr;
 
 LOCALVAR ui3p CntrlDisplayBuff = nullpr;
 
+/*
+	The cells of the special modes are kept in a layer of their
+	own. Drawing a special mode only lays out CntrlCells. Then
+	CntrlUpdate puts just the cells that differ from those shown
+	into CntrlDisplayBuff, which otherwise follows the emulated
+	screen one changed range of rows at a time.
+*/
+
+#define kCntrlCellsH ((long)vMacScreenWidth / 8 - 2)
+#define kCntrlCellsV (vMacScreenHeight / 16 - 1)
+#define kCellNone 0
+
+LOCALVAR ui3b CntrlCells[kCntrlCellsV][kCntrlCellsH];
+	/*
+		as laid out by the last DrawSpclMode, the cell
+		number plus one, or kCellNone.
+	*/
+LOCALVAR ui3b CntrlCellsShown[kCntrlCellsV][kCntrlCellsH];
+	/* as in CntrlDisplayBuff */
+LOCALVAR blnr CntrlShowing = falseblnr;
+
+#if 0 != vMacScreenDepth
+#define CntrlRowBytes \
+	(UseColorMode ? vMacScreenByteWidth : vMacScreenMonoByteWidth)
+#define CntrlCellBytes (UseColorMode ? (1 << vMacScreenDepth) : 1)
+#else
+#define CntrlRowBytes vMacScreenMonoByteWidth
+#define CntrlCellBytes 1
+#endif
+
 LOCALPROC DrawCell(unsigned int h, unsigned int v, int x)
 {
 #if 1
 	/* safety check */
-	if ((h < ((long)vMacScreenWidth / 8 - 2))
-		&& (v < (vMacScreenHeight / 16 - 1)))
+	if ((h < kCntrlCellsH) && (v < kCntrlCellsV))
 #endif
 	{
-		int i;
-		ui3p p0 = ((ui3p)CellData) + 16 * x;
+		CntrlCells[v][h] = x + 1;
+	}
+}
+
+LOCALPROC CntrlStampCell(unsigned int h, unsigned int v, int x)
+{
+	int i;
+	ui3p p0 = ((ui3p)CellData) + 16 * x;
 
 #if 0 != vMacScreenDepth
-		if (UseColorMode) {
-			ui3p p = CntrlDisplayBuff
-				+ ((h + 1) << vMacScreenDepth)
-				+ (v * 16 + 11) * vMacScreenByteWidth;
+	if (UseColorMode) {
+		ui3p p = CntrlDisplayBuff
+			+ ((h + 1) << vMacScreenDepth)
+			+ (v * 16 + 11) * vMacScreenByteWidth;
 
-			for (i = 16; --i >= 0; ) {
+		for (i = 16; --i >= 0; ) {
 #if 1 == vMacScreenDepth
-				int k;
-				ui3b t0 = *p0;
-				ui3p p2 = p;
-				for (k = 2; --k >= 0; ) {
-					*p2++ = (((t0) & 0x80) ? 0xC0 : 0x00)
-						| (((t0) & 0x40) ? 0x30 : 0x00)
-						| (((t0) & 0x20) ? 0x0C : 0x00)
-						| (((t0) & 0x10) ? 0x03 : 0x00);
-						/* black RRGGBBAA, white RRGGBBAA */
-					t0 <<= 4;
-				}
+			int k;
+			ui3b t0 = *p0;
+			ui3p p2 = p;
+			for (k = 2; --k >= 0; ) {
+				*p2++ = (((t0) & 0x80) ? 0xC0 : 0x00)
+					| (((t0) & 0x40) ? 0x30 : 0x00)
+					| (((t0) & 0x20) ? 0x0C : 0x00)
+					| (((t0) & 0x10) ? 0x03 : 0x00);
+					/* black RRGGBBAA, white RRGGBBAA */
+				t0 <<= 4;
+			}
 #elif 2 == vMacScreenDepth
-				int k;
-				ui3b t0 = *p0;
-				ui3p p2 = p;
-				for (k = 4; --k >= 0; ) {
-					*p2++ = (((t0) & 0x40) ? 0x0F : 0x00)
-						| (((t0) & 0x80) ? 0xF0 : 0x00);
-						/* black RRGGBBAA, white RRGGBBAA */
-					t0 <<= 2;
-				}
+			int k;
+			ui3b t0 = *p0;
+			ui3p p2 = p;
+			for (k = 4; --k >= 0; ) {
+				*p2++ = (((t0) & 0x40) ? 0x0F : 0x00)
+					| (((t0) & 0x80) ? 0xF0 : 0x00);
+					/* black RRGGBBAA, white RRGGBBAA */
+				t0 <<= 2;
+			}
 #elif 3 == vMacScreenDepth
-				int k;
-				ui3b t0 = *p0;
-				ui3p p2 = p;
-				for (k = 8; --k >= 0; ) {
-					*p2++ = ((t0 >> k) & 0x01) ? 0xFF : 0x00;
-						/* black RRGGBBAA, white RRGGBBAA */
-				}
+			int k;
+			ui3b t0 = *p0;
+			ui3p p2 = p;
+			for (k = 8; --k >= 0; ) {
+				*p2++ = ((t0 >> k) & 0x01) ? 0xFF : 0x00;
+					/* black RRGGBBAA, white RRGGBBAA */
+			}
 #elif 4 == vMacScreenDepth
-				int k;
-				ui4r v;
-				ui3b t0 = *p0;
-				ui3p p2 = p;
-				for (k = 8; --k >= 0; ) {
-					v = ((t0 >> k) & 0x01) ? 0x0000 : 0x7FFF;
-						/* black RRGGBBAA, white RRGGBBAA */
-					/* *((ui4b *)p2)++ = v; need big endian, so : */
-					*p2++ = v >> 8;
-					*p2++ = v;
-				}
+			int k;
+			ui4r v;
+			ui3b t0 = *p0;
+			ui3p p2 = p;
+			for (k = 8; --k >= 0; ) {
+				v = ((t0 >> k) & 0x01) ? 0x0000 : 0x7FFF;
+					/* black RRGGBBAA, white RRGGBBAA */
+				/* *((ui4b *)p2)++ = v; need big endian, so : */
+				*p2++ = v >> 8;
+				*p2++ = v;
+			}
 #elif 5 == vMacScreenDepth
-				int k;
-				ui5r v;
-				ui3b t0 = *p0;
-				ui3p p2 = p;
-				for (k = 8; --k >= 0; ) {
-					v = ((t0 >> k) & 0x01) ? 0x00000000 : 0x00FFFFFF;
-						/* black RRGGBBAA, white RRGGBBAA */
-					/* *((ui5b *)p2)++ = v; need big endian, so : */
-					*p2++ = v >> 24;
-					*p2++ = v >> 16;
-					*p2++ = v >> 8;
-					*p2++ = v;
-				}
-#endif
-				p += vMacScreenByteWidth;
-				p0 ++;
+			int k;
+			ui5r v;
+			ui3b t0 = *p0;
+			ui3p p2 = p;
+			for (k = 8; --k >= 0; ) {
+				v = ((t0 >> k) & 0x01) ? 0x00000000 : 0x00FFFFFF;
+					/* black RRGGBBAA, white RRGGBBAA */
+				/* *((ui5b *)p2)++ = v; need big endian, so : */
+				*p2++ = v >> 24;
+				*p2++ = v >> 16;
+				*p2++ = v >> 8;
+				*p2++ = v;
 			}
-		} else
 #endif
-		{
-			ui3p p = CntrlDisplayBuff + (h + 1)
-				+ (v * 16 + 11) * vMacScreenMonoByteWidth;
+			p += vMacScreenByteWidth;
+			p0 ++;
+		}
+	} else
+#endif
+	{
+		ui3p p = CntrlDisplayBuff + (h + 1)
+			+ (v * 16 + 11) * vMacScreenMonoByteWidth;
+
+		for (i = 16; --i >= 0; ) {
+			*p = *p0;
+			p += vMacScreenMonoByteWidth;
+			p0 ++;
+		}
+	}
+}
+
+LOCALPROC CntrlRestoreCell(unsigned int h, unsigned int v)
+{
+	int i;
+	int j;
+	uimr offset = (h + 1) * CntrlCellBytes
+		+ (v * 16 + 11) * CntrlRowBytes;
+	ui3p p = CntrlDisplayBuff + offset;
+	ui3p p0 = screencomparebuff + offset;
+
+	for (i = 16; --i >= 0; ) {
+		for (j = 0; j < CntrlCellBytes; ++j) {
+			p[j] = p0[j];
+		}
+		p += CntrlRowBytes;
+		p0 += CntrlRowBytes;
+	}
+}
 
-			for (i = 16; --i >= 0; ) {
-				*p = *p0;
-				p += vMacScreenMonoByteWidth;
-				p0 ++;
+LOCALPROC CntrlComposite(uimr top, uimr bottom)
+{
+	/*
+		bring rows top to bottom of CntrlDisplayBuff up to date
+		with the emulated screen, keeping the cells shown there.
+	*/
+	uimr h;
+	uimr v;
+	uimr v0;
+	uimr v1;
+	ui3r x;
+
+	if (CntrlShowing && (bottom > top)) {
+		MyMoveBytes((anyp)screencomparebuff + top * CntrlRowBytes,
+			(anyp)CntrlDisplayBuff + top * CntrlRowBytes,
+			(bottom - top) * CntrlRowBytes);
+
+		v0 = (top < 11) ? 0 : (top - 11) / 16;
+		v1 = (bottom <= 11) ? 0 : (bottom - 11 + 15) / 16;
+		if (v1 > kCntrlCellsV) {
+			v1 = kCntrlCellsV;
+		}
+		for (v = v0; v < v1; ++v) {
+			for (h = 0; h < kCntrlCellsH; ++h) {
+				x = CntrlCellsShown[v][h];
+				if (kCellNone != x) {
+					CntrlStampCell(h, v, x - 1);
+				}
 			}
 		}
 	}
@@ -340,12 +426,12 @@ LOCALPROC MacMsgDisplayOff(void)
 {
 	SpecialModeClr(SpclModeMessage);
 	SavedBriefMsg = nullpr;
-	NeedWholeScreenDraw = trueblnr;
+	NeedSpclModeDraw = trueblnr;
 }
 
 LOCALPROC MacMsgDisplayOn(void)
 {
-	NeedWholeScreenDraw = trueblnr;
+	NeedSpclModeDraw = trueblnr;
 	DisconnectKeyCodes1(kKeepMaskControl | kKeepMaskCapsLock);
 		/* command */
 	SpecialModeSet(SpclModeMessage);
@@ -422,6 +508,15 @@ enum {
 	kCntrlMsgNewRunInBack,
 #if EnableAutoSlow
 	kCntrlMsgNewAutoSlow,
+#endif
+#if EnableClockMult
+	kCntrlMsgNewClockMult,
+#endif
+#if EnableFastTiming
+	kCntrlMsgNewFastTiming,
+#endif
+#if EnableDynarec
+	kCntrlMsgNewDynarec,
 #endif
 	kCntrlMsgAbout,
 	kCntrlMsgHelp,
@@ -436,7 +531,7 @@ LOCALPROC DoEnterControlMode(void)
 {
 	CurControlMode = kCntrlModeBase;
 	ControlMessage = kCntrlMsgBaseStart;
-	NeedWholeScreenDraw = trueblnr;
+	NeedSpclModeDraw = trueblnr;
 	DisconnectKeyCodes1(kKeepMaskControl | kKeepMaskCapsLock);
 	SpecialModeSet(SpclModeControl);
 }
@@ -445,7 +540,7 @@ LOCALPROC DoLeaveControlMode(void)
 {
 	SpecialModeClr(SpclModeControl);
 	CurControlMode = kCntrlModeOff;
-	NeedWholeScreenDraw = trueblnr;
+	NeedSpclModeDraw = trueblnr;
 }
 
 LOCALPROC Keyboard_UpdateControlKey(blnr down)
@@ -634,6 +729,28 @@ LOCALPROC DoControlModeKey(int key)
 					CurControlMode = kCntrlModeBase;
 					ControlMessage = kCntrlMsgNewAutoSlow;
 					break;
+#endif
+#if EnableClockMult
+				case MKC_C:
+					ClockMultValue = (ClockMultValue + 1) & 3;
+					CurControlMode = kCntrlModeBase;
+					ControlMessage = kCntrlMsgNewClockMult;
+					break;
+#endif
+#if EnableFastTiming
+				case MKC_T:
+					WantFastTiming = ! WantFastTiming;
+					CurControlMode = kCntrlModeBase;
+					ControlMessage = kCntrlMsgNewFastTiming;
+					break;
+#endif
+#if EnableDynarec
+				case MKC_R:
+					DynarecMode = (DynarecMode + 1)
+						% (WantDynarecCheck ? 3 : 2);
+					CurControlMode = kCntrlModeBase;
+					ControlMessage = kCntrlMsgNewDynarec;
+					break;
 #endif
 				case MKC_Z:
 					SetSpeedValue(0);
@@ -659,7 +776,7 @@ LOCALPROC DoControlModeKey(int key)
 			}
 			break;
 	}
-	NeedWholeScreenDraw = trueblnr;
+	NeedSpclModeDraw = trueblnr;
 }
 
 LOCALFUNC char * ControlMode2TitleStr(void)
@@ -754,6 +871,15 @@ LOCALPROC DrawCellsControlModeBody(void)
 			DrawCellsKeyCommand("B", kStrSpeedBackToggle);
 #if EnableAutoSlow
 			DrawCellsKeyCommand("W", kStrSpeedAutoSlowToggle);
+#endif
+#if EnableClockMult
+			DrawCellsKeyCommand("C", kStrSpeedClockMult);
+#endif
+#if EnableFastTiming
+			DrawCellsKeyCommand("T", kStrSpeedFastTiming);
+#endif
+#if EnableDynarec
+			DrawCellsKeyCommand("R", kStrSpeedDynarec);
 #endif
 			DrawCellsBlankLine();
 			DrawCellsKeyCommand("E", kStrSpeedExit);
@@ -772,6 +898,21 @@ LOCALPROC DrawCellsControlModeBody(void)
 			DrawCellsOneLineStr(kStrNewAutoSlow);
 			break;
 #endif
+#if EnableClockMult
+		case kCntrlMsgNewClockMult:
+			DrawCellsOneLineStr(kStrNewClockMult);
+			break;
+#endif
+#if EnableFastTiming
+		case kCntrlMsgNewFastTiming:
+			DrawCellsOneLineStr(kStrNewFastTiming);
+			break;
+#endif
+#if EnableDynarec
+		case kCntrlMsgNewDynarec:
+			DrawCellsOneLineStr(kStrNewDynarec);
+			break;
+#endif
 #if EnableMagnify
 		case kCntrlMsgMagnify:
 			DrawCellsOneLineStr(kStrNewMagnify);
@@ -864,7 +1005,7 @@ LOCALPROC DrawDemoMode(void)
 
 LOCALPROC DemoModeSecondNotify(void)
 {
-	NeedWholeScreenDraw = trueblnr;
+	NeedSpclModeDraw = trueblnr;
 	SpecialModeSet(SpclModeDemo);
 }
 
@@ -904,23 +1045,56 @@ LOCALPROC DrawSpclMode(void)
 	}
 }
 
-LOCALFUNC ui3p GetCurDrawBuff(void)
+LOCALPROC CntrlUpdate(void)
 {
-	ui3p p = screencomparebuff;
-
-	if (0 != SpecialModes) {
-		MyMoveBytes((anyp)p, (anyp)CntrlDisplayBuff,
-#if 0 != vMacScreenDepth
-			UseColorMode ? vMacScreenNumBytes :
-#endif
-				vMacScreenMonoNumBytes
-			);
-		p = CntrlDisplayBuff;
+	/*
+		lay out the special modes again, and put the cells that
+		changed into CntrlDisplayBuff, marking just them changed.
+	*/
+	uimr h;
+	uimr v;
+	ui3r x;
+	blnr Showing = (0 != SpecialModes);
+
+	for (v = 0; v < kCntrlCellsV; ++v) {
+		for (h = 0; h < kCntrlCellsH; ++h) {
+			CntrlCells[v][h] = kCellNone;
+		}
+	}
 
+	if (Showing) {
 		DrawSpclMode();
+		if (! CntrlShowing) {
+			MyMoveBytes((anyp)screencomparebuff,
+				(anyp)CntrlDisplayBuff,
+				vMacScreenHeight * CntrlRowBytes);
+		}
+	}
+
+	for (v = 0; v < kCntrlCellsV; ++v) {
+		for (h = 0; h < kCntrlCellsH; ++h) {
+			x = CntrlCells[v][h];
+			if (x != CntrlCellsShown[v][h]) {
+				CntrlCellsShown[v][h] = x;
+				if (Showing) {
+					if (kCellNone == x) {
+						CntrlRestoreCell(h, v);
+					} else {
+						CntrlStampCell(h, v, x - 1);
+					}
+				}
+				ScreenChangedAdd(v * 16 + 11, (h + 1) * 8,
+					v * 16 + 11 + 16, (h + 2) * 8);
+			}
+		}
 	}
 
-	return p;
+	CntrlShowing = Showing;
+}
+
+LOCALFUNC ui3p GetCurDrawBuff(void)
+{
+	return CntrlShowing ? CntrlDisplayBuff : screencomparebuff;
 }
 
 LOCALPROC Keyboard_UpdateKeyMap2(int key, blnr down)
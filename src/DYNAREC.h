@@ -0,0 +1,553 @@
+/*
+	DYNAREC.h
+
+	You can redistribute this file and/or modify it under the terms
+	of version 2 of the GNU General Public License as published by
+	the Free Software Foundation.  You should have received a copy
+	of the license along with this file; see the file COPYING.
+
+	This file is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	license for more details.
+*/
+
+/*
+	DYNAmic RECompiler
+
+	Runs the emulated cpu a block at a time, for a backend
+	that translates blocks into host code. A block is a run
+	of instructions ending with a branch. It is found by
+	interpreting it once, one instruction at a time, noting
+	where each instruction starts and what it costs.
+
+	Blocks are looked up by real program counter in a direct
+	mapped table. Each keeps a copy of its instructions, so
+	code that has been changed since is noticed and recorded
+	again, without having to watch every write to memory.
+
+	A block is run with all but its own cycles moved from
+	MaxCyclesToGo to MoreCyclesToGo, which m68k_go_nCycles
+	puts back after each block, checking for interrupts
+	as usual. So the interpreter stops at the end of the
+	block, or sooner if something like an exception happens.
+
+	regs stays the real cpu state. A backend loads and stores
+	it, goes through the MATC caches for memory, and leaves
+	exceptions and memory mapped devices to the interpreter.
+	The interpreter backend here translates nothing and runs
+	each block with m68k_go_MaxCycles. A backend generating
+	host code (x86-64 to develop on a desktop, ARMv6K for the
+	console) would replace DrCurBackend.
+
+	With WantDynarecCheck and DynarecMode 2, each translated
+	block is run twice, first by the interpreter and then by
+	the backend, and the registers and memory written are
+	compared. Blocks that use a device are left to the
+	interpreter, as that can't be done twice. Without
+	WantDynarecCheck, mode 2 is the same as 1.
+
+	Included by MINEM68K.c.
+*/
+
+#define ln2DrNumBlocks 10
+#define kDrNumBlocks (1 << ln2DrNumBlocks)
+#define kDrMaxInstrs 16
+#define kDrMaxBytes 64
+
+enum {
+	kDrModeOff,
+	kDrModeOn,
+	kDrModeCheck
+};
+
+struct DrBlock {
+	ui3p start_p; /* nullpr if the entry is unused */
+	CPTR pc;
+	si5r cycles;
+	ui4r nbytes;
+	ui4r ninstrs;
+	blnr translated;
+	anyp code; /* for the backend */
+	ui4b copy[kDrMaxBytes / 2];
+};
+typedef struct DrBlock DrBlock;
+
+struct DrBackend {
+	char *name;
+	blnr (*Translate)(DrBlock *b);
+		/*
+			for a newly recorded block, returns falseblnr if
+			the block should just be interpreted.
+		*/
+	void (*Run)(DrBlock *b);
+		/*
+			leaves regs as the interpreter would, including
+			MaxCyclesToGo. May stop before the end of the
+			block, such as for an exception.
+		*/
+	void (*Discard)(DrBlock *b);
+		/* frees what Translate made */
+};
+typedef struct DrBackend DrBackend;
+
+struct DrCpuState {
+	ui5r regs[16];
+	CPTR pc;
+	ui4r sr;
+	CPTR usp;
+	CPTR isp;
+	si5r cycles;
+};
+typedef struct DrCpuState DrCpuState;
+
+LOCALVAR DrBlock DrBlocks[kDrNumBlocks];
+LOCALVAR DrBlock *DrRecording = nullpr;
+LOCALVAR ui3b DrMode = kDrModeOff;
+
+/* regs up to the big disp_table, which doesn't change */
+#define DrRegsSz ((uimr)((ui3p)&regs.disp_table - (ui3p)&regs))
+
+#if WantDynarecCheck
+LOCALVAR ui3b DrSavedRegs[sizeof(regs) - sizeof(regs.disp_table)];
+LOCALVAR ui3b DrRefRegs[sizeof(regs) - sizeof(regs.disp_table)];
+LOCALVAR DrJournalEl DrRefJournal[kDrJournalSz];
+#endif
+
+enum {
+	kDrStatRun,
+	kDrStatRecorded,
+	kDrStatChecked,
+	kDrStatUnchecked,
+	kDrStatMismatch,
+
+	kNumDrStats
+};
+
+LOCALVAR ui5r DrStats[kNumDrStats];
+
+#if dbglog_HAVE
+LOCALVAR char *DrStatNames[kNumDrStats] = {
+	"dynarec blocks run",
+	"dynarec blocks recorded",
+	"dynarec blocks checked",
+	"dynarec blocks using devices",
+	"dynarec mismatches"
+};
+
+GLOBALPROC m68k_LogDynarecStats(void)
+{
+	int i;
+
+	for (i = 0; i < kNumDrStats; ++i) {
+		dbglog_writelnNum(DrStatNames[i], DrStats[i]);
+		DrStats[i] = 0;
+	}
+}
+#endif
+
+LOCALPROC DrInterpret(si5r n)
+{
+	/* run the interpreter for at most n more cycles */
+	if (regs.MaxCyclesToGo > n) {
+		regs.MoreCyclesToGo += regs.MaxCyclesToGo - n;
+		regs.MaxCyclesToGo = n;
+	}
+	m68k_go_MaxCycles();
+}
+
+/* --- interpreter backend --- */
+
+LOCALFUNC blnr DrInterpTranslate(DrBlock *b)
+{
+	UnusedParam(b);
+	return trueblnr;
+}
+
+LOCALPROC DrInterpRun(DrBlock *b)
+{
+	DrInterpret(b->cycles);
+}
+
+LOCALPROC DrInterpDiscard(DrBlock *b)
+{
+	UnusedParam(b);
+}
+
+LOCALVAR const DrBackend DrInterpBackend = {
+	"interpreter",
+	DrInterpTranslate,
+	DrInterpRun,
+	DrInterpDiscard
+};
+
+LOCALVAR const DrBackend *DrCurBackend = &DrInterpBackend;
+
+/* --- blocks --- */
+
+LOCALPROC DrDiscard(DrBlock *b)
+{
+	if (b->translated) {
+		DrCurBackend->Discard(b);
+		b->translated = falseblnr;
+	}
+	b->start_p = nullpr;
+}
+
+LOCALPROC DrFlush(void)
+{
+	int i;
+
+	for (i = 0; i < kDrNumBlocks; ++i) {
+		DrDiscard(&DrBlocks[i]);
+	}
+	DrRecording = nullpr;
+}
+
+LOCALFUNC blnr DrBlockValid(DrBlock *b)
+{
+	ui4b *p = (ui4b *)b->start_p;
+	ui4r n = b->nbytes >> 1;
+	ui4r i;
+
+	for (i = 0; i < n; ++i) {
+		if (p[i] != b->copy[i]) {
+			return falseblnr;
+		}
+	}
+	return trueblnr;
+}
+
+LOCALFUNC ui4r DrJumpLength(ui5r opcode)
+{
+	/* length of JMP or JSR, from the addressing mode */
+	switch ((opcode >> 3) & 7) {
+		case 2:
+			return 2;
+		case 5:
+			return 4;
+#if ! Use68020
+		case 6:
+			return 4;
+#endif
+		case 7:
+			switch (opcode & 7) {
+				case 0:
+				case 2:
+				case 3:
+					return 4;
+				case 1:
+					return 6;
+				default:
+					return 0;
+			}
+		default:
+			return 0;
+	}
+}
+
+LOCALFUNC ui4r DrEndLength(void)
+{
+	/*
+		For the instruction just run, the length if it ends a
+		block, whose length the program counter after it
+		doesn't tell. 1 for an ordinary instruction. 0 for
+		an instruction left to the interpreter, that changes
+		the status register or always causes an exception.
+	*/
+	switch (GetDcoMainClas(&regs.CurDecOp)) {
+		case kIKindBccB:
+		case kIKindBraB:
+		case kIKindBsrB:
+		case kIKindRts:
+		case kIKindRtr:
+			return 2;
+		case kIKindBccW:
+		case kIKindBraW:
+		case kIKindBsrW:
+		case kIKindDBcc:
+		case kIKindDBF:
+			return 4;
+#if Use68020
+		case kIKindBraL:
+		case kIKindBccL:
+		case kIKindBsrL:
+			return 6;
+		case kIKindRtd:
+			return 4;
+		case kIKindTRAPcc:
+		case kIKindChkL:
+		case kIKindBkpt:
+		case kIKindMoveC:
+		case kIKindMoveS:
+		case kIKindCallMorRtm:
+#endif
+		case kIKindA:
+		case kIKindF:
+		case kIKindIllegal:
+		case kIKindTrap:
+		case kIKindTrapV:
+		case kIKindChkW:
+		case kIKindRte:
+		case kIKindStop:
+		case kIKindReset:
+		case kIKindMoveEaSR:
+		case kIKindBinOpStatusCCR:
+		case kIKindMoveRUSP:
+		case kIKindMoveUSPR:
+			return 0;
+		case kIKindJmp:
+		case kIKindJsr:
+			return DrJumpLength(regs.opcode);
+		default:
+			return 1;
+	}
+}
+
+LOCALPROC DrEndRecording(void)
+{
+	DrBlock *b = DrRecording;
+
+	DrRecording = nullpr;
+	if (0 == b->ninstrs) {
+		b->start_p = nullpr;
+	} else {
+		b->translated = DrCurBackend->Translate(b);
+		++DrStats[kDrStatRecorded];
+	}
+}
+
+LOCALPROC DrRecordStep(DrBlock *b)
+{
+	ui3p p = regs.pc_p;
+	ui3p oldp = regs.pc_oldp;
+	ui4r n;
+	blnr ends = trueblnr;
+
+	DrInterpret(1); /* one instruction */
+
+	n = DrEndLength();
+	if (1 == n) {
+		if (oldp == regs.pc_oldp) {
+			n = regs.pc_p - p;
+			ends = falseblnr;
+		} else {
+			/* exception, or a jump through m68k_setpc */
+			n = 0;
+		}
+	}
+
+	if ((0 == n) || (b->nbytes + n > kDrMaxBytes)) {
+		/* leave this one out */
+		DrEndRecording();
+	} else {
+		MyMoveBytes((anyp)p, (anyp)((ui3p)b->copy + b->nbytes), n);
+		b->nbytes += n;
+		b->cycles += GetDcoCycles(&regs.CurDecOp);
+		++b->ninstrs;
+		if (ends || (kDrMaxInstrs == b->ninstrs)) {
+			DrEndRecording();
+		}
+	}
+}
+
+#if WantDynarecCheck
+/* --- lockstep check --- */
+
+LOCALPROC DrGetCpuState(DrCpuState *s)
+{
+	int i;
+
+	for (i = 0; i < 16; ++i) {
+		s->regs[i] = regs.regs[i];
+	}
+	s->pc = m68k_getpc();
+	s->sr = m68k_getSR();
+	s->usp = regs.usp;
+	s->isp = regs.isp;
+	s->cycles = regs.MaxCyclesToGo + regs.MoreCyclesToGo;
+}
+
+LOCALFUNC blnr DrSameCpuState(DrCpuState *a, DrCpuState *b)
+{
+	int i;
+
+	for (i = 0; i < 16; ++i) {
+		if (a->regs[i] != b->regs[i]) {
+			return falseblnr;
+		}
+	}
+	return (a->pc == b->pc) && (a->sr == b->sr)
+		&& (a->usp == b->usp) && (a->isp == b->isp)
+		&& (a->cycles == b->cycles);
+}
+
+LOCALPROC DrJournalStart(void)
+{
+	DrJournalN = 0;
+	DrDeviceUsed = falseblnr;
+	DrJournalOn = trueblnr;
+}
+
+LOCALPROC DrJournalUndo(DrJournalEl *j, ui5r n)
+{
+	while (n > 0) {
+		--n;
+		*j[n].p = j[n].old;
+	}
+}
+
+LOCALFUNC blnr DrSameMemory(ui5r RefN)
+{
+	/*
+		Everything the interpreter wrote must have the same
+		value now, and anything only the backend wrote must
+		still have its old value.
+	*/
+	ui5r i;
+	ui5r k;
+	ui4b v;
+
+	for (i = 0; i < RefN; ++i) {
+		if (*DrRefJournal[i].p != DrRefJournal[i].new) {
+			return falseblnr;
+		}
+	}
+	for (i = 0; i < DrJournalN; ++i) {
+		v = DrJournal[i].old;
+		for (k = 0; k < RefN; ++k) {
+			if (DrRefJournal[k].p == DrJournal[i].p) {
+				v = DrRefJournal[k].new;
+				break;
+			}
+		}
+		if (*DrJournal[i].p != v) {
+			return falseblnr;
+		}
+	}
+	return trueblnr;
+}
+
+LOCALPROC DrMismatch(DrBlock *b, ui5r RefN)
+{
+	/* go with what the interpreter did */
+	ui5r i;
+
+	if (DrJournalN <= kDrJournalSz) {
+		DrJournalUndo(DrJournal, DrJournalN);
+	}
+	for (i = 0; i < RefN; ++i) {
+		*DrRefJournal[i].p = DrRefJournal[i].new;
+	}
+	MyMoveBytes((anyp)DrRefRegs, (anyp)&regs, DrRegsSz);
+
+#if dbglog_HAVE
+	dbglog_writeCStr("dynarec mismatch in block at ");
+	dbglog_writeHex(b->pc);
+	dbglog_writeCStr(" with ");
+	dbglog_writeCStr(DrCurBackend->name);
+	dbglog_writeReturn();
+#endif
+
+	DrCurBackend->Discard(b);
+	b->translated = falseblnr;
+	++DrStats[kDrStatMismatch];
+}
+
+LOCALPROC DrRunChecked(DrBlock *b)
+{
+	DrCpuState Ref;
+	DrCpuState Got;
+	ui5r RefN;
+	ui5r i;
+
+	MyMoveBytes((anyp)&regs, (anyp)DrSavedRegs, DrRegsSz);
+	DrJournalStart();
+	DrInterpret(b->cycles);
+	DrJournalOn = falseblnr;
+
+	if (DrDeviceUsed || (DrJournalN > kDrJournalSz)) {
+		/* keep what the interpreter did */
+		++DrStats[kDrStatUnchecked];
+		return;
+	}
+
+	DrGetCpuState(&Ref);
+	MyMoveBytes((anyp)&regs, (anyp)DrRefRegs, DrRegsSz);
+	RefN = DrJournalN;
+	for (i = 0; i < RefN; ++i) {
+		DrJournal[i].new = *DrJournal[i].p;
+	}
+	MyMoveBytes((anyp)DrJournal, (anyp)DrRefJournal,
+		RefN * sizeof(DrJournalEl));
+	DrJournalUndo(DrRefJournal, RefN);
+	MyMoveBytes((anyp)DrSavedRegs, (anyp)&regs, DrRegsSz);
+
+	DrJournalStart();
+	DrCurBackend->Run(b);
+	DrJournalOn = falseblnr;
+	DrGetCpuState(&Got);
+
+	if (DrDeviceUsed || (DrJournalN > kDrJournalSz)
+		|| ! DrSameCpuState(&Ref, &Got) || ! DrSameMemory(RefN))
+	{
+		DrMismatch(b, RefN);
+	}
+	++DrStats[kDrStatChecked];
+}
+#endif /* WantDynarecCheck */
+
+/* --- main loop --- */
+
+LOCALPROC Dr_go_MaxCycles(void)
+{
+	/* called by m68k_go_nCycles, runs one block */
+	ui3p p = regs.pc_p;
+	DrBlock *b = DrRecording;
+
+	if (nullpr != b) {
+		if (p == b->start_p + b->nbytes) {
+			DrRecordStep(b);
+			return;
+		}
+		DrEndRecording();
+	}
+
+	b = &DrBlocks[((uimr)p >> 1) & (kDrNumBlocks - 1)];
+	if ((p == b->start_p) && (m68k_getpc() == b->pc)
+		&& DrBlockValid(b))
+	{
+		++DrStats[kDrStatRun];
+		if (! b->translated) {
+			DrInterpret(b->cycles);
+#if WantDynarecCheck
+		} else if (kDrModeCheck == DrMode) {
+			DrRunChecked(b);
+#endif
+		} else {
+			DrCurBackend->Run(b);
+		}
+	} else {
+		DrDiscard(b);
+		b->start_p = p;
+		b->pc = m68k_getpc();
+		b->cycles = 0;
+		b->nbytes = 0;
+		b->ninstrs = 0;
+		DrRecording = b;
+		DrRecordStep(b);
+	}
+}
+
+GLOBALPROC m68k_SetDynarec(ui3r v)
+{
+	/*
+		called between calls to m68k_go_nCycles.
+		0 to only interpret, 1 to run blocks with
+		the backend, 2 to also check them.
+	*/
+	if (v != DrMode) {
+		DrFlush();
+		DrMode = v;
+	}
+}
@@ -169,4 +169,23 @@ enum {
 #define kROM_ln2Spc 20
 
 #define WantDisasm 0
+#ifndef WantThreadedDispatch
+#define WantThreadedDispatch 1
+#endif
+#define WantInstrCount 0
+#define WantLazyFlags 1
+#define WantSpecializedOps 1
+#ifndef WantFusedOps
+#define WantFusedOps 1
+#endif
+#ifndef WantBlockCache
+#define WantBlockCache 0
+#endif
+#define WantFuseCounts 0
+#define WantDBFAccel 1
+#define WantATTPageTable 1
+#define WantMATCStats 0
+#define WantSliceStats 0
+#define WantIdleSkip 1
+#define WantWordSwappedMem 1
 #define ExtraAbnormalReports 0
@@ -0,0 +1,195 @@
+/*
+	FRAMEPIPE.c
+
+	You can redistribute this file and/or modify it under the terms
+	of version 2 of the GNU General Public License as published by
+	the Free Software Foundation.  You should have received a copy
+	of the license along with this file; see the file COPYING.
+
+	This file is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	license for more details.
+*/
+
+/*
+	FRAME PIPEline
+
+	The compare and conversion of a 1 bit frame, split by bands
+	of rows between workers, so they can run on other threads
+	than the emulation, which then only copies the frame. Prev
+	plays the part of screencomparebuff: each worker compares
+	its rows of the new frame with it, copies over the rows that
+	differ, and converts the changed columns of their bands.
+
+	Bands are dealt out in turn, band i to worker i modulo the
+	number of workers, so changes in one area of the screen,
+	such as a menu, are still shared. A band is 512 bytes or
+	more of the frame, so two workers never share a cache line
+	of it either, and each has its own slice of results.
+
+	There are no threads here, the caller runs FramePipeWork
+	for each worker however it likes. Platform independent,
+	tests/framepipe_test.c checks it against a serial compare
+	and conversion, and tests/framepipe_bench.c times it with
+	1 to 4 threads on a desktop.
+*/
+
+#ifndef AllFiles
+#include "SYSDEPNS.h"
+#endif
+
+#include <string.h>
+
+#include "PIXCONV.h"
+#include "SCRNDIFF.h"
+
+#include "FRAMEPIPE.h"
+
+GLOBALPROC FramePipeSetup(FramePipe *p, uimr Width, uimr Height,
+	uimr BandRows, ui3p Prev, ui3p Dst, uimr DstPitch,
+	PixConv *Conv)
+{
+	p->Width = Width;
+	p->Height = Height;
+	p->ByteWidth = Width / 8;
+	p->BandRows = BandRows;
+	p->NumBands = (Height + BandRows - 1) / BandRows;
+	p->Cur = nullpr;
+	p->Prev = Prev;
+	p->Dst = Dst;
+	p->DstPitch = DstPitch;
+	p->Conv = Conv;
+	p->NumWorkers = 1;
+}
+
+GLOBALPROC FramePipeStart(FramePipe *p, ui3p Cur, uimr NumWorkers)
+{
+	p->Cur = Cur;
+	p->NumWorkers = NumWorkers;
+}
+
+GLOBALPROC FramePipeWork(FramePipe *p, uimr w)
+{
+	FramePipeSlice *s = &p->Slice[w];
+	uimr ByteWidth = p->ByteWidth;
+	uimr PixelBytes = p->Conv->PixelBytes;
+	uimr Top = p->Height;
+	uimr Left = p->Width;
+	uimr Bottom = 0;
+	uimr Right = 0;
+	uimr BandLeft;
+	uimr BandRight;
+	uimr BandTop;
+	uimr BandBottom;
+	uimr RowLeft;
+	uimr RowRight;
+	uimr Row;
+	uimr i;
+	ui3p Cur;
+	ui3p Prev;
+
+	for (i = 0; i < kFramePipeBandWords; ++i) {
+		s->Bands[i] = 0;
+	}
+
+	for (i = w; i < p->NumBands; i += p->NumWorkers) {
+		BandTop = i * p->BandRows;
+		BandBottom = BandTop + p->BandRows;
+		if (BandBottom > p->Height) {
+			BandBottom = p->Height;
+		}
+
+		BandLeft = p->Width;
+		BandRight = 0;
+		Cur = p->Cur + BandTop * ByteWidth;
+		Prev = p->Prev + BandTop * ByteWidth;
+		for (Row = BandTop; Row < BandBottom; ++Row) {
+			if (ScrnDiffRow(Cur, Prev, ByteWidth,
+				&RowLeft, &RowRight))
+			{
+				memcpy(Prev, Cur, ByteWidth);
+				if (RowLeft < BandLeft) {
+					BandLeft = RowLeft;
+				}
+				if (RowRight > BandRight) {
+					BandRight = RowRight;
+				}
+				if (Row < Top) {
+					Top = Row;
+				}
+				Bottom = Row + 1;
+			}
+			Cur += ByteWidth;
+			Prev += ByteWidth;
+		}
+
+		if (BandRight > BandLeft) {
+			s->Bands[i / 32] |= ((ui5b)1 << (i & 31));
+			if (BandLeft < Left) {
+				Left = BandLeft;
+			}
+			if (BandRight > Right) {
+				Right = BandRight;
+			}
+
+			BandLeft &= ~ 7;
+			BandRight = (BandRight + 7) & ~ 7;
+			PixConvRect(p->Conv,
+				p->Prev + BandTop * ByteWidth + BandLeft / 8,
+				ByteWidth,
+				p->Dst + BandTop * p->DstPitch
+					+ BandLeft * PixelBytes,
+				p->DstPitch,
+				BandRight - BandLeft, BandBottom - BandTop);
+		}
+	}
+
+	s->Top = Top;
+	s->Left = Left;
+	s->Bottom = Bottom;
+	s->Right = Right;
+}
+
+GLOBALFUNC blnr FramePipeResult(FramePipe *p, ui5b *Bands,
+	uimr *Top, uimr *Left, uimr *Bottom, uimr *Right)
+{
+	FramePipeSlice *s;
+	uimr w;
+	uimr i;
+
+	*Top = p->Height;
+	*Left = p->Width;
+	*Bottom = 0;
+	*Right = 0;
+	if (nullpr != Bands) {
+		for (i = 0; i < (p->NumBands + 31) / 32; ++i) {
+			Bands[i] = 0;
+		}
+	}
+
+	for (w = 0; w < p->NumWorkers; ++w) {
+		s = &p->Slice[w];
+		if (s->Bottom > s->Top) {
+			if (s->Top < *Top) {
+				*Top = s->Top;
+			}
+			if (s->Bottom > *Bottom) {
+				*Bottom = s->Bottom;
+			}
+			if (s->Left < *Left) {
+				*Left = s->Left;
+			}
+			if (s->Right > *Right) {
+				*Right = s->Right;
+			}
+			if (nullpr != Bands) {
+				for (i = 0; i < (p->NumBands + 31) / 32; ++i) {
+					Bands[i] |= s->Bands[i];
+				}
+			}
+		}
+	}
+
+	return *Bottom > *Top;
+}
@@ -0,0 +1,89 @@
+/*
+	FRAMEPIPE.h
+
+	You can redistribute this file and/or modify it under the terms
+	of version 2 of the GNU General Public License as published by
+	the Free Software Foundation.  You should have received a copy
+	of the license along with this file; see the file COPYING.
+
+	This file is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	license for more details.
+*/
+
+#ifdef FRAMEPIPE_H
+#error "header already included"
+#else
+#define FRAMEPIPE_H
+#endif
+
+#define kFramePipeMaxWorkers 4
+#define kFramePipeMaxBands 64
+#define kFramePipeBandWords (kFramePipeMaxBands / 32)
+
+/*
+	What one worker found, kept apart from the others so they
+	never write the same word. Padded to a cache line of its own.
+*/
+struct FramePipeSlice {
+	ui5b Bands[kFramePipeBandWords];
+	uimr Top; /* Top >= Bottom if nothing changed */
+	uimr Left;
+	uimr Bottom;
+	uimr Right;
+	ui3b Pad[64 - kFramePipeBandWords * 4 - 4 * sizeof(uimr)];
+};
+typedef struct FramePipeSlice FramePipeSlice;
+
+struct FramePipe {
+	uimr Width;
+	uimr Height;
+	uimr ByteWidth;
+	uimr BandRows;
+	uimr NumBands;
+	ui3p Cur; /* the frame being worked on */
+	ui3p Prev; /* the frame last worked on, brought up to Cur */
+	ui3p Dst; /* converted pixels, kept between frames */
+	uimr DstPitch; /* in bytes */
+	PixConv *Conv;
+	uimr NumWorkers;
+	FramePipeSlice Slice[kFramePipeMaxWorkers];
+};
+typedef struct FramePipe FramePipe;
+
+EXPORTPROC FramePipeSetup(FramePipe *p, uimr Width, uimr Height,
+	uimr BandRows, ui3p Prev, ui3p Dst, uimr DstPitch,
+	PixConv *Conv);
+	/*
+		Takes the buffers, which the caller allocates. The
+		screen is 1 bit, Width a multiple of 64, and at most
+		kFramePipeMaxBands bands of BandRows rows. Prev and the
+		frames passed to FramePipeStart must be word aligned.
+		Conv is set up for Depth 0 and only read.
+	*/
+
+EXPORTPROC FramePipeStart(FramePipe *p, ui3p Cur, uimr NumWorkers);
+	/*
+		Starts a frame of Cur, to be split between NumWorkers,
+		1 to kFramePipeMaxWorkers. Then FramePipeWork must run
+		once for each worker, in any order or all at once.
+	*/
+
+EXPORTPROC FramePipeWork(FramePipe *p, uimr w);
+	/*
+		Worker w's share, every NumWorkers th band from band w.
+		Each row that differs from Prev is copied there, and
+		the changed columns of its band, to the byte, are
+		converted into Dst.
+	*/
+
+EXPORTFUNC blnr FramePipeResult(FramePipe *p, ui5b *Bands,
+	uimr *Top, uimr *Left, uimr *Bottom, uimr *Right);
+	/*
+		Once every worker is done, gathers what they found:
+		sets Bands, a bit per band, and the changed rectangle,
+		and returns true if anything changed. Bands may be
+		nullpr. Only reads, so any thread may call it until the
+		next FramePipeStart.
+	*/
@@ -32,6 +32,7 @@
 #include "EMCONFIG.h"
 #endif
 
+#include "ICTHEAP.h"
 #include "GLOBGLUE.h"
 
 IMPORTPROC m68k_reset(void);
@@ -55,6 +56,9 @@ IMPORTPROC Sony_SetQuitOnEject(void);
 IMPORTPROC m68k_IPLchangeNtfy(void);
 IMPORTPROC MINEM68K_Init(
 	ui3b *fIPL);
+#if WantBlockCache
+IMPORTPROC m68k_MemWriteNtfy(ui3p p, ui5r L);
+#endif
 
 IMPORTFUNC ui5b GetCyclesRemaining(void);
 IMPORTPROC SetCyclesRemaining(ui5b n);
@@ -117,6 +121,81 @@ GLOBALVAR ui3p VidROM = nullpr;
 GLOBALVAR ui3p VidMem = nullpr;
 #endif
 
+#if WantWordSwappedMem
+#if EmVidCard
+#error "WantWordSwappedMem not yet supported with EmVidCard"
+#endif
+
+/*
+	copy between emulated memory, stored with words swapped,
+	and buffers in ordinary byte order.
+*/
+
+GLOBALPROC MoveBytesToVMem(ui3p src, ui3p dst, ui5r n)
+{
+	if (0 == (1 & (uimr)dst)) {
+		for (; n >= 2; n -= 2) {
+			dst[0] = src[1];
+			dst[1] = src[0];
+			src += 2;
+			dst += 2;
+		}
+	}
+	for (; 0 != n; --n) {
+		*VMemByteAddr(dst) = *src;
+		++src;
+		++dst;
+	}
+}
+
+GLOBALPROC MoveBytesFromVMem(ui3p src, ui3p dst, ui5r n)
+{
+	if (0 == (1 & (uimr)src)) {
+		for (; n >= 2; n -= 2) {
+			dst[0] = src[1];
+			dst[1] = src[0];
+			src += 2;
+			dst += 2;
+		}
+	}
+	for (; 0 != n; --n) {
+		*dst = *VMemByteAddr(src);
+		++src;
+		++dst;
+	}
+}
+
+GLOBALPROC MoveBytesVMem(ui3p src, ui3p dst, ui5r n)
+{
+	if (0 == (1 & ((uimr)src | (uimr)dst | n))) {
+		MyMoveBytes((anyp)src, (anyp)dst, n);
+	} else {
+		for (; 0 != n; --n) {
+			*VMemByteAddr(dst) = *VMemByteAddr(src);
+			++src;
+			++dst;
+		}
+	}
+}
+
+/*
+	convert a block of emulated memory (at an even address, of
+	even size) that was filled in ordinary byte order, such as
+	the ROM image as loaded from disk.
+*/
+GLOBALPROC ByteOrderToVMem(ui3p p, ui5r n)
+{
+	ui3r t;
+
+	for (; n >= 2; n -= 2) {
+		t = p[0];
+		p[0] = p[1];
+		p[1] = t;
+		p += 2;
+	}
+}
+#endif
+
 GLOBALVAR ui3b Wires[kNumWires];
 
 
@@ -288,6 +367,34 @@ GLOBALPROC DoReportAbnormal(void)
 #define kASC_Mask 0x00000FFF
 
 
+#if IncludeExtnPbufs && WantWordSwappedMem
+#define kPbufBounceSize 0x0200
+
+LOCALVAR ui3b PbufBounce[kPbufBounceSize];
+
+LOCALPROC PbufTransferVMem(ui3p Buffer,
+	tPbuf i, ui5r offset, ui5r count, blnr IsWrite)
+{
+	ui5r n;
+
+	while (0 != count) {
+		n = (count > kPbufBounceSize) ? kPbufBounceSize : count;
+		if (IsWrite) {
+			MoveBytesFromVMem(Buffer, PbufBounce, n);
+			PbufTransfer(PbufBounce, i, offset, n, trueblnr);
+		} else {
+			PbufTransfer(PbufBounce, i, offset, n, falseblnr);
+			MoveBytesToVMem(PbufBounce, Buffer, n);
+		}
+		Buffer += n;
+		offset += n;
+		count -= n;
+	}
+}
+#else
+#define PbufTransferVMem PbufTransfer
+#endif
+
 #if IncludeExtnPbufs
 LOCALFUNC tMacErr PbufTransferVM(CPTR Buffera,
 	tPbuf i, ui5r offset, ui5r count, blnr IsWrite)
@@ -304,7 +411,7 @@ label_1:
 		if (0 == contig) {
 			result = mnvm_miscErr;
 		} else {
-			PbufTransfer(Buffer, i, offset, contig, IsWrite);
+			PbufTransferVMem(Buffer, i, offset, contig, IsWrite);
 			offset += contig;
 			Buffera += contig;
 			count -= contig;
@@ -1515,6 +1622,50 @@ GLOBALPROC Addr32_ChangeNtfy(void)
 }
 #endif
 
+#if EnableScreenDirtyRows
+GLOBALVAR ui3p ScreenDirtyBase = nullpr;
+	/*
+		host address of the screen buffer being displayed,
+		set by the screen emulation.
+	*/
+
+GLOBALPROC ScreenDirtyNtfy(ui3p p, ui5r L)
+{
+	/* L bytes at p, in host memory, have been written */
+	/* as integers, p needn't be in the screen buffer */
+	uimr lo = (uimr)ScreenDirtyBase;
+	uimr hi = lo + vMacScreenNumBytes;
+	uimr a = (uimr)p;
+	uimr i;
+	uimr last;
+
+	if ((0 == lo) || (0 == L) || (a >= hi) || (a + L <= lo)) {
+		return;
+	}
+	if (a < lo) {
+		L -= lo - a;
+		a = lo;
+	}
+	if (a + L > hi) {
+		L = hi - a;
+	}
+	i = (a - lo) / vMacScreenByteWidth;
+	last = (a - lo + L - 1) / vMacScreenByteWidth;
+	for (; i <= last; ++i) {
+		ScreenDirtyRowSet(i);
+	}
+}
+
+GLOBALPROC ScreenDirtyAll(void)
+{
+	int i;
+
+	for (i = 0; i < kScreenDirtyRowsN; ++i) {
+		ScreenDirtyRows[i] = (ui5b) -1;
+	}
+}
+#endif
+
 LOCALFUNC ATTep get_address_realblock1(blnr WriteMem, CPTR addr)
 {
 	ATTep p;
@@ -1593,6 +1744,17 @@ label_1:
 		}
 	}
 
+#if EnableScreenDirtyRows
+	if (WritableMem && (nullpr != p)) {
+		ScreenDirtyNtfy(p, *actL);
+	}
+#endif
+#if WantBlockCache
+	if (WritableMem && (nullpr != p)) {
+		m68k_MemWriteNtfy(p, *actL);
+	}
+#endif
+
 	return p;
 }
 
@@ -1704,21 +1866,94 @@ GLOBALFUNC blnr FindKeyEvent(int *VirtualKey, blnr *KeyDown)
 #include <stdio.h>
 #endif
 
-GLOBALVAR uimr ICTactive;
+/*
+	Pending tasks are kept in a min-heap by when they are due,
+	see ICTHEAP.c, so finding the next one doesn't depend on how
+	many task ids there are.
+*/
+
 GLOBALVAR iCountt ICTwhen[kNumICTs];
+LOCALVAR ui4b ICTheap[kNumICTs];
+LOCALVAR ui4b ICTpos[kNumICTs];
+LOCALVAR ICTHeap ICTpending = { 0, ICTheap, ICTpos, ICTwhen };
+
+GLOBALVAR iCountt NextiCount = 0;
 
 GLOBALPROC ICT_Zap(void)
 {
-	ICTactive = 0;
+	ICTHeapZap(&ICTpending, kNumICTs);
 }
 
-LOCALPROC InsertICT(int taskid, iCountt when)
+GLOBALPROC ICT_cancel(int taskid)
 {
-	ICTwhen[taskid] = when;
-	ICTactive |= (1 << taskid);
+	ICTHeapCancel(&ICTpending, taskid);
 }
 
-GLOBALVAR iCountt NextiCount = 0;
+GLOBALFUNC blnr ICT_TakeDue(int *taskid)
+{
+	if (ICTHeapEmpty(&ICTpending)
+		|| (ICTHeapFirstWhen(&ICTpending) != NextiCount))
+	{
+		return falseblnr;
+	}
+	*taskid = ICTHeapFirst(&ICTpending);
+	ICTHeapCancel(&ICTpending, *taskid);
+	return trueblnr;
+}
+
+GLOBALFUNC ui5b ICT_TimeToNext(ui5b maxn)
+{
+	ui5b d;
+
+	if (ICTHeapEmpty(&ICTpending)) {
+		return maxn;
+	}
+	d = ICTHeapFirstWhen(&ICTpending) - NextiCount;
+		/* at this point d must be > 0 */
+#ifdef _VIA_Debug
+	fprintf(stderr, "coming task %d, %d, %d\n",
+		NextiCount, ICTHeapFirst(&ICTpending), d);
+#endif
+	return (d < maxn) ? d : maxn;
+}
+
+/*
+	Tasks that ICTNeedsConsumer only do work for someone else,
+	such as kICT_SubTick, which feeds sound. They are only
+	scheduled while something has registered with
+	ICT_AddConsumer, so while nothing is listening they don't cut
+	the emulation into short slices. Consumers come and go at run
+	time, and when the last one goes, a pending run of the task
+	is cancelled.
+*/
+
+#define ICTNeedsConsumer(taskid) (kICT_SubTick == (taskid))
+
+LOCALVAR ui3b ICTconsumers[kNumICTs];
+
+GLOBALPROC ICT_AddConsumer(int taskid)
+{
+	++ICTconsumers[taskid];
+}
+
+GLOBALPROC ICT_RemoveConsumer(int taskid)
+{
+	if (0 == ICTconsumers[taskid]) {
+		/* without a matching ICT_AddConsumer */
+		ReportAbnormal("ICT_RemoveConsumer too many times");
+		return;
+	}
+	if (0 == --ICTconsumers[taskid]) {
+		if (ICTNeedsConsumer(taskid)) {
+			ICT_cancel(taskid);
+		}
+	}
+}
+
+GLOBALFUNC blnr ICT_HasConsumer(int taskid)
+{
+	return (0 != ICTconsumers[taskid]) || ! ICTNeedsConsumer(taskid);
+}
 
 GLOBALFUNC iCountt GetCuriCount(void)
 {
@@ -1731,10 +1966,15 @@ GLOBALPROC ICT_add(int taskid, ui5b n)
 	si5r x = GetCyclesRemaining();
 	ui5b when = NextiCount - x + n;
 
+	if (! ICT_HasConsumer(taskid)) {
+		/* no one wants it done */
+		return;
+	}
+
 #ifdef _VIA_Debug
 	fprintf(stderr, "ICT_add: %d, %d, %d\n", when, taskid, n);
 #endif
-	InsertICT(taskid, when);
+	ICTHeapAdd(&ICTpending, taskid, when);
 
 	if (x > (si5r)n) {
 		SetCyclesRemaining(n);
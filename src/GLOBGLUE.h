@@ -68,19 +68,127 @@ typedef ui5b CPTR;
 EXPORTFUNC ui3p get_real_address0(ui5b L, blnr WritableMem, CPTR addr,
 	ui5b *actL);
 
+/*
+	layout of the memory of the emulated computer (RAM, ROM,
+	video memory) in real memory.
+
+	With WantWordSwappedMem, each aligned 16 bit word is stored
+	in host byte order, so that on a little endian host word and
+	long accesses are plain loads and stores, and the byte at
+	emulated address a is found at real address a ^ 1. This
+	relies on each block of emulated memory being allocated at
+	an even address. Word and long accesses must be to even
+	addresses.
+
+	Otherwise, the memory is stored in the byte order of the
+	emulated computer, and the do_get_vmem routines are the
+	same as the do_get_mem routines from ENDIANAC.h.
+*/
+
+#ifndef WantWordSwappedMem
+#define WantWordSwappedMem 0
+#endif
+
+#if WantWordSwappedMem
+
+#if defined(__BYTE_ORDER__)
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "WantWordSwappedMem requires a little endian host"
+#endif
+#elif ! LittleEndianUnaligned
+#error "WantWordSwappedMem requires a little endian host"
+#endif
+
+#define VMemByteAddr(a) ((ui3p)(((uimr)(a)) ^ 1))
+
+#define do_get_vmem_byte(a) ((ui3r)*VMemByteAddr(a))
+#define do_get_vmem_word(a) ((ui4r)*((ui4b *)(a)))
+
+#define do_put_vmem_byte(a, v) ((*VMemByteAddr(a)) = (v))
+#define do_put_vmem_word(a, v) ((*((ui4b *)(a))) = (v))
+
+#ifdef __GNUC__
+
+/*
+	A long is the two words swapped, so it is one 32 bit
+	load or store and a rotate by 16. Longs are only word
+	aligned, which the ARM11 handles in a single access.
+*/
+
+typedef __UINT32_TYPE__
+	__attribute__((__may_alias__, __aligned__(2))) VMemLong;
+
+static MayInline ui5r do_get_vmem_long(ui3p a)
+{
+	ui5r v = *((VMemLong *)a);
+
+	return ((v << 16) | (v >> 16)) & 0xFFFFFFFF;
+}
+
+static MayInline void do_put_vmem_long(ui3p a, ui5r v)
+{
+	*((VMemLong *)a) = (v << 16) | ((v >> 16) & 0x0000FFFF);
+}
+
+#else
+
+static MayInline ui5r do_get_vmem_long(ui3p a)
+{
+	return (((ui5r)*((ui4b *)a)) << 16) | ((ui5r)*((ui4b *)(a + 2)));
+}
+
+static MayInline void do_put_vmem_long(ui3p a, ui5r v)
+{
+	*((ui4b *)a) = v >> 16;
+	*((ui4b *)(a + 2)) = v;
+}
+
+#endif
+
+EXPORTPROC MoveBytesToVMem(ui3p src, ui3p dst, ui5r n);
+EXPORTPROC MoveBytesFromVMem(ui3p src, ui3p dst, ui5r n);
+EXPORTPROC MoveBytesVMem(ui3p src, ui3p dst, ui5r n);
+EXPORTPROC ByteOrderToVMem(ui3p p, ui5r n);
+
+#else
+
+#define do_get_vmem_byte(a) do_get_mem_byte(a)
+#define do_get_vmem_word(a) do_get_mem_word(a)
+#define do_get_vmem_long(a) do_get_mem_long(a)
+
+#define do_put_vmem_byte(a, v) do_put_mem_byte((a), (v))
+#define do_put_vmem_word(a, v) do_put_mem_word((a), (v))
+#define do_put_vmem_long(a, v) do_put_mem_long((a), (v))
+
+#define MoveBytesToVMem(src, dst, n) \
+	MyMoveBytes((anyp)(src), (anyp)(dst), (n))
+#define MoveBytesFromVMem(src, dst, n) \
+	MyMoveBytes((anyp)(src), (anyp)(dst), (n))
+#define MoveBytesVMem(src, dst, n) \
+	MyMoveBytes((anyp)(src), (anyp)(dst), (n))
+#define ByteOrderToVMem(p, n)
+
+#endif
+
+#if EnableScreenDirtyRows
+EXPORTVAR(ui3p, ScreenDirtyBase)
+EXPORTPROC ScreenDirtyNtfy(ui3p p, ui5r L);
+EXPORTPROC ScreenDirtyAll(void);
+#endif
+
 /*
 	memory access routines that can use when have address
 	that is known to be in RAM (and that is in the first
 	copy of the ram, not the duplicates, i.e. < kRAM_Size).
 */
 
-#define get_ram_byte(addr) do_get_mem_byte((addr) + RAM)
-#define get_ram_word(addr) do_get_mem_word((addr) + RAM)
-#define get_ram_long(addr) do_get_mem_long((addr) + RAM)
+#define get_ram_byte(addr) do_get_vmem_byte((addr) + RAM)
+#define get_ram_word(addr) do_get_vmem_word((addr) + RAM)
+#define get_ram_long(addr) do_get_vmem_long((addr) + RAM)
 
-#define put_ram_byte(addr, b) do_put_mem_byte((addr) + RAM, (b))
-#define put_ram_word(addr, w) do_put_mem_word((addr) + RAM, (w))
-#define put_ram_long(addr, l) do_put_mem_long((addr) + RAM, (l))
+#define put_ram_byte(addr, b) do_put_vmem_byte((addr) + RAM, (b))
+#define put_ram_word(addr, w) do_put_vmem_word((addr) + RAM, (w))
+#define put_ram_long(addr, l) do_put_vmem_long((addr) + RAM, (l))
 
 #define get_ram_address(addr) ((addr) + RAM)
 
@@ -155,12 +263,19 @@ enum {
 };
 
 EXPORTPROC ICT_add(int taskid, ui5b n);
+EXPORTPROC ICT_cancel(int taskid);
+EXPORTPROC ICT_AddConsumer(int taskid);
+EXPORTPROC ICT_RemoveConsumer(int taskid);
+EXPORTFUNC blnr ICT_HasConsumer(int taskid);
 
 #define iCountt ui5b
 EXPORTFUNC iCountt GetCuriCount(void);
 EXPORTPROC ICT_Zap(void);
+EXPORTFUNC blnr ICT_TakeDue(int *taskid);
+	/* takes off a task due at NextiCount, if any */
+EXPORTFUNC ui5b ICT_TimeToNext(ui5b maxn);
+	/* until the next task, or maxn if sooner */
 
-EXPORTVAR(uimr, ICTactive)
 EXPORTVAR(iCountt, ICTwhen[kNumICTs])
 EXPORTVAR(iCountt, NextiCount)
 
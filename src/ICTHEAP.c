@@ -0,0 +1,140 @@
+/*
+	ICTHEAP.c
+
+	You can redistribute this file and/or modify it under the terms
+	of version 2 of the GNU General Public License as published by
+	the Free Software Foundation.  You should have received a copy
+	of the license along with this file; see the file COPYING.
+
+	This file is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	license for more details.
+*/
+
+/*
+	Internal Cycle Task HEAP
+
+	The pending internal cycle tasks (see ICT_add in GLOBGLUE.c),
+	in a binary min-heap ordered by when each is due, so the next
+	deadline is always at the top, and there can be any number of
+	task ids. Each task's index in the heap is kept, so a pending
+	task can be moved or cancelled where it is, with a sift of
+	O(log n), rather than looked for.
+
+	Ties go to the lower task id, the order in which tasks were
+	found when they were a bitmask scanned from bit 0, so that
+	the emulation is the same.
+
+	Platform independent, tests/ictheap_test.c checks it against
+	a scan of all tasks, and tests/ictheap_bench.c times it next
+	to the bitmask.
+*/
+
+#ifndef AllFiles
+#include "SYSDEPNS.h"
+#endif
+
+#include "ICTHEAP.h"
+
+LOCALFUNC blnr ICTHeapBefore(ICTHeap *h, ui4r a, ui4r b)
+{
+	si5r d = (si5r)(h->When[a] - h->When[b]);
+
+	return (d < 0) || ((0 == d) && (a < b));
+}
+
+LOCALPROC ICTHeapPlace(ICTHeap *h, uimr i, ui4r taskid)
+{
+	h->Heap[i] = taskid;
+	h->Pos[taskid] = i + 1;
+}
+
+LOCALPROC ICTHeapSiftUp(ICTHeap *h, uimr i, ui4r taskid)
+{
+	uimr parent;
+
+	while (i > 0) {
+		parent = (i - 1) >> 1;
+		if (! ICTHeapBefore(h, taskid, h->Heap[parent])) {
+			break;
+		}
+		ICTHeapPlace(h, i, h->Heap[parent]);
+		i = parent;
+	}
+	ICTHeapPlace(h, i, taskid);
+}
+
+LOCALPROC ICTHeapSiftDown(ICTHeap *h, uimr i, ui4r taskid)
+{
+	uimr child;
+
+	while ((child = 2 * i + 1) < h->n) {
+		if ((child + 1 < h->n)
+			&& ICTHeapBefore(h, h->Heap[child + 1], h->Heap[child]))
+		{
+			++child;
+		}
+		if (! ICTHeapBefore(h, h->Heap[child], taskid)) {
+			break;
+		}
+		ICTHeapPlace(h, i, h->Heap[child]);
+		i = child;
+	}
+	ICTHeapPlace(h, i, taskid);
+}
+
+/* puts taskid at index i, up or down as it needs */
+LOCALPROC ICTHeapFix(ICTHeap *h, uimr i, ui4r taskid)
+{
+	if ((i > 0) && ICTHeapBefore(h, taskid, h->Heap[(i - 1) >> 1])) {
+		ICTHeapSiftUp(h, i, taskid);
+	} else {
+		ICTHeapSiftDown(h, i, taskid);
+	}
+}
+
+GLOBALPROC ICTHeapZap(ICTHeap *h, uimr NumTasks)
+{
+	uimr i;
+
+	h->n = 0;
+	for (i = 0; i < NumTasks; ++i) {
+		h->Pos[i] = 0;
+	}
+}
+
+GLOBALPROC ICTHeapInit(ICTHeap *h, ui4b *Heap, ui4b *Pos, ui5b *When,
+	uimr NumTasks)
+{
+	h->Heap = Heap;
+	h->Pos = Pos;
+	h->When = When;
+	ICTHeapZap(h, NumTasks);
+}
+
+GLOBALPROC ICTHeapAdd(ICTHeap *h, uimr taskid, ui5b when)
+{
+	uimr i = h->Pos[taskid];
+
+	h->When[taskid] = when;
+	if (0 == i) {
+		ICTHeapSiftUp(h, h->n++, taskid);
+	} else {
+		ICTHeapFix(h, i - 1, taskid);
+	}
+}
+
+GLOBALPROC ICTHeapCancel(ICTHeap *h, uimr taskid)
+{
+	uimr i = h->Pos[taskid];
+	ui4r last;
+
+	if (0 != i) {
+		h->Pos[taskid] = 0;
+		last = h->Heap[--h->n];
+		if (last != taskid) {
+			ICTHeapFix(h, i - 1, last);
+		}
+	}
+}
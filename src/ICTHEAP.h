@@ -0,0 +1,55 @@
+/*
+	ICTHEAP.h
+
+	You can redistribute this file and/or modify it under the terms
+	of version 2 of the GNU General Public License as published by
+	the Free Software Foundation.  You should have received a copy
+	of the license along with this file; see the file COPYING.
+
+	This file is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	license for more details.
+*/
+
+#ifdef ICTHEAP_H
+#error "header already included"
+#else
+#define ICTHEAP_H
+#endif
+
+struct ICTHeap {
+	uimr n; /* tasks pending */
+	ui4b *Heap; /* pending task ids, the earliest first */
+	ui4b *Pos; /* for each task, 1 + its index in Heap, or 0 */
+	ui5b *When; /* for each task, when it is due */
+};
+typedef struct ICTHeap ICTHeap;
+
+EXPORTPROC ICTHeapInit(ICTHeap *h, ui4b *Heap, ui4b *Pos, ui5b *When,
+	uimr NumTasks);
+	/*
+		Takes the arrays, which the caller allocates, each
+		with an entry per task id, and starts with nothing
+		pending.
+	*/
+
+EXPORTPROC ICTHeapZap(ICTHeap *h, uimr NumTasks);
+	/* nothing pending */
+
+EXPORTPROC ICTHeapAdd(ICTHeap *h, uimr taskid, ui5b when);
+	/* makes the task due at when, pending or not */
+
+EXPORTPROC ICTHeapCancel(ICTHeap *h, uimr taskid);
+	/* makes the task not pending, if it is */
+
+/*
+	The pending task due first, ties going to the lower task
+	id. Times are compared as differences, so they may wrap
+	around, as long as all pending are within half the range.
+*/
+#define ICTHeapEmpty(h) (0 == (h)->n)
+#define ICTHeapFirst(h) ((h)->Heap[0])
+#define ICTHeapFirstWhen(h) ((h)->When[(h)->Heap[0]])
+
+#define ICTHeapPending(h, taskid) (0 != (h)->Pos[taskid])
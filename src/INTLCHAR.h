@@ -1690,6 +1690,48 @@ LOCALFUNC char * GetSubstitutionStr(char x)
 					break;
 			}
 			break;
+#if EnableFastTiming
+		case 't':
+			if (WantFastTiming) {
+				s = kStrOn;
+			} else {
+				s = kStrOff;
+			}
+			break;
+#endif
+#if EnableDynarec
+		case 'j':
+			switch (DynarecMode) {
+				case 0:
+					s = kStrOff;
+					break;
+				case 1:
+					s = kStrOn;
+					break;
+				default:
+					s = kStrDynarecCheck;
+					break;
+			}
+			break;
+#endif
+#if EnableClockMult
+		case 'c':
+			switch (ClockMultValue) {
+				case 0:
+					s = "1x";
+					break;
+				case 1:
+					s = "2x";
+					break;
+				case 2:
+					s = "4x";
+					break;
+				default:
+					s = "8x";
+					break;
+			}
+			break;
+#endif
 		default:
 			s = "???";
 			break;
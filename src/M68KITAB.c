@@ -28,6 +28,10 @@
 
 #include "M68KITAB.h"
 
+#ifndef WantSpecializedOps
+#define WantSpecializedOps 0
+#endif
+
 struct WorkR {
 	/* expected size : 8 bytes */
 	ui5b opcode;
@@ -67,8 +71,6 @@ enum {
 
 #define CheckInSet(v, m) (0 != ((1 << (v)) & (m)))
 
-#define kMyAvgCycPerInstr (10 * kCycleScale + (40 * kCycleScale / 64))
-
 LOCALFUNC MayNotInline ui3r GetArgkRegSz(WorkR *p)
 {
 	ui3r CurArgk;
@@ -2624,6 +2626,94 @@ LOCALPROC MayInline DeCodeF(WorkR *p)
 	p->MainClass = kIKindF;
 }
 
+#if WantSpecializedOps
+/*
+	Switch the common register and simple indirect forms of
+	MOVE and CMP over to handlers specialized for their
+	addressing modes. Everything else keeps the generic kind.
+	The specialized kinds are counted separately by
+	WantDumpTable, which is the way to check the choice
+	against a real instruction mix.
+*/
+LOCALPROC DeCodeSpecialize(WorkR *p)
+{
+	ui3r samd = GetDcoSrcAMd(&p->DecOp);
+	ui3r damd = GetDcoDstAMd(&p->DecOp);
+
+	switch (p->MainClass) {
+		case kIKindMoveL:
+			if (kAMdReg == samd) {
+				switch (damd) {
+					case kAMdReg:
+						p->MainClass = kIKindMoveLRgRg;
+						break;
+					case kAMdAPosIncL:
+						p->MainClass = kIKindMoveLRgAPI;
+						break;
+					case kAMdAPreDecL:
+						p->MainClass = kIKindMoveLRgAPD;
+						break;
+					case kAMdADisp:
+						p->MainClass = kIKindMoveLRgAD;
+						break;
+				}
+			} else if (kAMdReg == damd) {
+				switch (samd) {
+					case kAMdIndirect:
+						p->MainClass = kIKindMoveLARg;
+						break;
+					case kAMdAPosIncL:
+						p->MainClass = kIKindMoveLAPIRg;
+						break;
+					case kAMdADisp:
+						p->MainClass = kIKindMoveLADRg;
+						break;
+				}
+			}
+			break;
+		case kIKindMoveW:
+			if (kAMdReg == damd) {
+				switch (samd) {
+					case kAMdReg:
+						p->MainClass = kIKindMoveWRgRg;
+						break;
+					case kAMdIndirect:
+						p->MainClass = kIKindMoveWARg;
+						break;
+					case kAMdAPosIncW:
+						p->MainClass = kIKindMoveWAPIRg;
+						break;
+					case kAMdADisp:
+						p->MainClass = kIKindMoveWADRg;
+						break;
+				}
+			}
+			break;
+		case kIKindCmpB:
+			if ((kAMdReg == damd) && (kAMdImmedB == samd)) {
+				p->MainClass = kIKindCmpBImRg;
+			}
+			break;
+		case kIKindCmpW:
+			if ((kAMdReg == damd) && (kAMdImmedW == samd)) {
+				p->MainClass = kIKindCmpWImRg;
+			}
+			break;
+		case kIKindCmpL:
+			if (kAMdReg == damd) {
+				if (kAMdImmedL == samd) {
+					p->MainClass = kIKindCmpLImRg;
+				} else if (kAMdReg == samd) {
+					p->MainClass = kIKindCmpLRgRg;
+				}
+			}
+			break;
+		default:
+			break;
+	}
+}
+#endif
+
 LOCALPROC DeCodeOneOp(WorkR *p)
 {
 	switch (p->opcode >> 12) {
@@ -2678,6 +2768,10 @@ LOCALPROC DeCodeOneOp(WorkR *p)
 			break;
 	}
 
+#if WantSpecializedOps
+	DeCodeSpecialize(p);
+#endif
+
 	if (kIKindIllegal == p->MainClass) {
 #if WantCycByPriOp
 		p->Cycles = (34 * kCycleScale
@@ -131,6 +131,21 @@ enum {
 	kIKindCallMorRtm,
 	kIKindStop,
 	kIKindReset,
+	kIKindMoveLRgRg,
+	kIKindMoveLRgAPI,
+	kIKindMoveLRgAPD,
+	kIKindMoveLRgAD,
+	kIKindMoveLARg,
+	kIKindMoveLAPIRg,
+	kIKindMoveLADRg,
+	kIKindMoveWRgRg,
+	kIKindMoveWARg,
+	kIKindMoveWAPIRg,
+	kIKindMoveWADRg,
+	kIKindCmpBImRg,
+	kIKindCmpWImRg,
+	kIKindCmpLImRg,
+	kIKindCmpLRgRg,
 
 #if Use68020
 	kIKindBraL,
@@ -231,4 +246,6 @@ typedef struct DecOpR DecOpR;
 #define SetDcoSrcArgDat(p, x) SetDcoFldArgDat((p)->B, x)
 #define SetDcoCycles(p, x) SetUi5rField((p)->B, 0, 16, x)
 
+#define kMyAvgCycPerInstr (10 * kCycleScale + (40 * kCycleScale / 64))
+
 EXPORTPROC M68KITAB_setup(DecOpR *p);
@@ -76,6 +76,66 @@ typedef MATCr *MATCp;
 #define USE_POINTER 1
 #endif
 
+#ifndef WantFusedOps
+#define WantFusedOps 0
+#endif
+
+#ifndef WantFuseCounts
+#define WantFuseCounts 0
+#endif
+
+#ifndef WantATTPageTable
+#define WantATTPageTable 0
+#endif
+
+#ifndef WantMATCStats
+#define WantMATCStats 0
+#endif
+
+#ifndef WantDBFAccel
+#define WantDBFAccel 0
+#endif
+
+#ifndef WantIdleSkip
+#define WantIdleSkip 0
+#endif
+
+#if WantFusedOps && ! WantThreadedDispatch
+#error "WantFusedOps requires WantThreadedDispatch"
+#endif
+
+#ifndef WantLazyFlags
+#define WantLazyFlags 0
+#endif
+
+#ifndef EnableDynarec
+#define EnableDynarec 0
+#endif
+
+#ifndef WantDynarecCheck
+#define WantDynarecCheck 0
+#endif
+
+#if EnableDynarec && ! USE_POINTER
+#error "EnableDynarec requires USE_POINTER"
+#endif
+
+#if EnableDynarec && WantCloserCyc
+#error "EnableDynarec requires every instruction to cost cycles"
+#endif
+
+#ifndef WantBlockCache
+#define WantBlockCache 0
+#endif
+
+#if WantBlockCache && ! (USE_POINTER && WantThreadedDispatch)
+#error "WantBlockCache requires USE_POINTER and WantThreadedDispatch"
+#endif
+
+#if WantBlockCache && (WantFusedOps || EnableDynarec || WantDisasm)
+#error "WantBlockCache replaces WantFusedOps, EnableDynarec and WantDisasm"
+#endif
+
 #define AKMemory 0
 #define AKRegister 1
 #define AKConstant 2
@@ -86,6 +146,67 @@ union ArgAddrT {
 };
 typedef union ArgAddrT ArgAddrT;
 
+#if WantBlockCache
+
+/*
+	Block cache of decoded instructions. The second time a run of
+	instructions is started at the same place, a record of each
+	is kept, with its disp_table entry (kind, effective address
+	modes and cycles), the address of its handler, and the
+	operands its extension words gave, already sign extended.
+	After that, the run is executed from the records: no opcode
+	fetch, no lookup in disp_table or DispatchTab, and no
+	extension words decoded in DecodeAMd. Each record is only
+	used if the pc is where it was recorded, so a run can follow
+	branches, and ends at an exception, where execution leaves
+	the page, or after kBcMaxInstrs.
+
+	The cycles of the whole block are charged on entry. Limit
+	in each record is minus the cycles of it and the rest of
+	the block, so the check before each instruction is the same
+	as the main loop's, and BcSettle gives back what wasn't run
+	before anything looks at regs.MaxCyclesToGo. So the
+	interrupt and ICT boundaries fall exactly where they do
+	without the cache.
+
+	Blocks are looked up by real program counter in a direct
+	mapped table. A block in RAM is only valid while the write
+	generations of its page, and of the next one, which its last
+	instruction may run into, are unchanged. Writes to RAM, by
+	the cpu or by devices (m68k_MemWriteNtfy), bump the
+	generation of the page. ROM is never written, so blocks in
+	ROM share generations that never change.
+*/
+
+#define ln2BcNumBlocks 9
+#define kBcNumBlocks (1 << ln2BcNumBlocks)
+#define kBcMaxInstrs 15
+#define kBcMaxExt 2 /* a source and a destination */
+
+#define ln2BcPageSz 10
+#define kBcNumPages (kRAM_Size >> ln2BcPageSz)
+
+struct BcInstr {
+	ui3p pc_p; /* where the instruction starts, nullpr ends a block */
+	si5r Limit;
+	ui4b opcode;
+	void *Handler;
+	DecOpR DecOp;
+	ui5r Ext[kBcMaxExt]; /* in the order DecodeAMd decoded them */
+};
+typedef struct BcInstr BcInstr;
+
+struct BcBlock {
+	ui5b *GenP; /* generation of its page, the next page's follows */
+	ui5b Gen;
+	ui5b Gen2;
+	ui5r n;
+	BcInstr Instr[kBcMaxInstrs + 1];
+};
+typedef struct BcBlock BcBlock;
+
+#endif
+
 LOCALVAR struct regstruct
 {
 	ui5r regs[16]; /* Data and Address registers */
@@ -111,6 +232,11 @@ LOCALVAR struct regstruct
 	flagtype z; /* bit 2: Zero */
 	flagtype v; /* bit 1: oVerflow */
 	flagtype c; /* bit 0: Carry */
+#if WantLazyFlags
+	ui5r LazyFlagKind; /* how to get n, z, v, c, if not kLazyFlagsNone */
+	ui5r LazySrc;
+	ui5r LazyDst;
+#endif
 
 	flagtype TracePending;
 	flagtype ExternalInterruptPending;
@@ -139,6 +265,11 @@ LOCALVAR struct regstruct
 	MATCr MATCex;
 	ATTep HeadATTel;
 	DecOpR CurDecOp;
+#if WantBlockCache
+	BcInstr *BcNext; /* the record expected next, BcIdle if none */
+	ui5r *BcExtP; /* operands of the current record, or nullpr */
+	ui5b *BcGenP; /* page generation of the block last entered */
+#endif
 
 
 #if USE_POINTER
@@ -153,7 +284,31 @@ LOCALVAR struct regstruct
 	si5r MaxCyclesToGo;
 	si5r MoreCyclesToGo;
 	si5r ResidualCycles;
-	ui3b fakeword[2];
+#if EnableFastTiming
+	blnr FlatCycles;
+#endif
+#if EnableClockMult
+	ui3b ClockShift;
+		/*
+			log2 of cpu cycles per cycle of
+			the rest of the machine
+		*/
+#endif
+#if WantInstrCount
+	ui5r InstrCount;
+#endif
+	ui4b fakeword;
+#if WantIdleSkip
+	flagtype stopped;
+	flagtype IdleArmed;
+	flagtype IdleProgress;
+	ui5r IdleBackoff;
+	CPTR IdlePC;
+	ui5r IdleRegs[16];
+	ui4r IdleSR;
+	si5r IdleCyc;
+	ui5r IdleCycles;
+#endif
 
 #define disp_table_sz (256 * 256)
 #if SmallGlobals
@@ -163,13 +318,98 @@ LOCALVAR struct regstruct
 #endif
 } regs;
 
+#if WantDumpTable
+LOCALVAR ui5b DumpTable[kNumIKinds];
+#endif
+
+#if WantBlockCache
+LOCALVAR BcBlock BcBlocks[kBcNumBlocks];
+LOCALVAR ui3p BcStart[kBcNumBlocks];
+	/* where each block starts, nullpr if unused */
+LOCALVAR ui3p BcSeen[kBcNumBlocks];
+	/* a block is recorded the second time it is started at */
+LOCALVAR ui5b BcPageGen[kBcNumPages + 1];
+LOCALVAR ui5b BcROMGen[2];
+LOCALVAR BcInstr BcIdle; /* pc_p is nullpr and Limit 0 */
+LOCALVAR BcInstr *BcResume = &BcIdle;
+	/* the record a block was left at by BcSettle */
+LOCALVAR BcBlock *BcCurB; /* the block last entered */
+LOCALVAR BcBlock *BcRec = nullpr; /* the block being recorded */
+LOCALVAR ui5r *BcRecExtP = nullpr;
+LOCALVAR ui5r *BcRecExtEnd;
+LOCALVAR blnr BcRecBad;
+
+LOCALPROC BcSettle0(void)
+{
+	/* back to cycles charged an instruction at a time */
+	regs.MaxCyclesToGo -= regs.BcNext->Limit;
+	BcResume = regs.BcNext;
+	regs.BcNext = &BcIdle;
+}
+
+#define BcSettle() \
+	((&BcIdle != regs.BcNext) ? BcSettle0() : (void)0)
+
+#define BcWriteNtfy(m) \
+	{ \
+		uimr BcOffset = (uimr)(m) - (uimr)RAM; \
+		if (BcOffset < kRAM_Size) { \
+			ui5b *BcGenP = &BcPageGen[BcOffset >> ln2BcPageSz]; \
+			++*BcGenP; \
+			if ((uimr)BcGenP - (uimr)regs.BcGenP <= sizeof(ui5b)) { \
+				/* the running block may have changed */ \
+				BcSettle(); \
+			} \
+		} \
+	}
+#else
+#define BcSettle()
+#define BcWriteNtfy(m)
+#endif
+
 #define ui5r_MSBisSet(x) (((si5r)(x)) < 0)
 
+#if WantLazyFlags
+/*
+	CMP, ADD, SUB, and the instructions that just set N and Z
+	from a result (MOVE, TST, AND, ...) only record their operands
+	here. N, Z, V and C are worked out from them the first time
+	something looks at the flags. X is always kept up to date.
+*/
+
+enum {
+	kLazyFlagsNone,
+	kLazyFlagsLogic,
+	kLazyFlagsAddB,
+	kLazyFlagsAddW,
+	kLazyFlagsAddL,
+	kLazyFlagsCmpB,
+	kLazyFlagsCmpW,
+	kLazyFlagsCmpL
+};
+
+LOCALPROC m68k_NeedFlags0(void);
+
+#define m68k_NeedFlags() \
+	((kLazyFlagsNone != regs.LazyFlagKind) ? m68k_NeedFlags0() : (void)0)
+
+#define SetLazyFlags(k, s, d) \
+	(regs.LazyFlagKind = (k), regs.LazySrc = (s), regs.LazyDst = (d))
+
+#define ZFLG (*(m68k_NeedFlags(), &regs.z))
+#define NFLG (*(m68k_NeedFlags(), &regs.n))
+#define CFLG (*(m68k_NeedFlags(), &regs.c))
+#define VFLG (*(m68k_NeedFlags(), &regs.v))
+#define XFLG (*(m68k_NeedFlags(), &regs.x))
+#else
+#define m68k_NeedFlags()
+
 #define ZFLG regs.z
 #define NFLG regs.n
 #define CFLG regs.c
 #define VFLG regs.v
 #define XFLG regs.x
+#endif
 
 LOCALFUNC ui4b m68k_getCR(void)
 {
@@ -179,152 +419,330 @@ LOCALFUNC ui4b m68k_getCR(void)
 
 LOCALFUNC MayInline void m68k_setCR(ui4b newcr)
 {
-	XFLG = (newcr >> 4) & 1;
-	NFLG = (newcr >> 3) & 1;
-	ZFLG = (newcr >> 2) & 1;
-	VFLG = (newcr >> 1) & 1;
-	CFLG = newcr & 1;
+#if WantLazyFlags
+	regs.LazyFlagKind = kLazyFlagsNone;
+#endif
+	regs.x = (newcr >> 4) & 1;
+	regs.n = (newcr >> 3) & 1;
+	regs.z = (newcr >> 2) & 1;
+	regs.v = (newcr >> 1) & 1;
+	regs.c = newcr & 1;
 }
 
-LOCALFUNC MayInline blnr cctrue(void)
+/*
+	The SetCCRfor routines below write the flags directly,
+	and are shared by the eager and lazy versions.
+*/
+
+LOCALPROC SetCCRforLogic0(ui5r v)
 {
-	switch ((regs.opcode >> 8) & 15) {
-		case 0:  return trueblnr;                   /* T */
-		case 1:  return falseblnr;                  /* F */
-		case 2:  return (! CFLG) && (! ZFLG);       /* HI */
-		case 3:  return CFLG || ZFLG;               /* LS */
-		case 4:  return ! CFLG;                     /* CC */
-		case 5:  return CFLG;                       /* CS */
-		case 6:  return ! ZFLG;                     /* NE */
-		case 7:  return ZFLG;                       /* EQ */
-		case 8:  return ! VFLG;                     /* VC */
-		case 9:  return VFLG;                       /* VS */
-		case 10: return ! NFLG;                     /* PL */
-		case 11: return NFLG;                       /* MI */
-		case 12: return NFLG == VFLG;               /* GE */
-		case 13: return NFLG != VFLG;               /* LT */
-		case 14: return (! ZFLG) && (NFLG == VFLG); /* GT */
-		case 15: return ZFLG || (NFLG != VFLG);     /* LE */
-		default: return falseblnr; /* shouldn't get here */
-	}
+	regs.v = regs.c = 0;
+	regs.z = (v == 0);
+	regs.n = ui5r_MSBisSet(v);
 }
 
-LOCALPROC ALU_CmpB(ui5r srcvalue, ui5r dstvalue)
+LOCALPROC SetCCRforCmpB(ui5r srcvalue, ui5r dstvalue)
 {
 	ui5r result0 = dstvalue - srcvalue;
 	ui5r result1 = ui5r_FromUByte(dstvalue) - ui5r_FromUByte(srcvalue);
 	ui5r result = ui5r_FromSByte(result0);
 
-	ZFLG = (result == 0);
-	NFLG = ui5r_MSBisSet(result);
-	VFLG = (((result0 >> 1) ^ result0) >> 7) & 1;
-	CFLG = (result1 >> 8) & 1;
+	regs.z = (result == 0);
+	regs.n = ui5r_MSBisSet(result);
+	regs.v = (((result0 >> 1) ^ result0) >> 7) & 1;
+	regs.c = (result1 >> 8) & 1;
 }
 
-LOCALPROC ALU_CmpW(ui5r srcvalue, ui5r dstvalue)
+LOCALPROC SetCCRforCmpW(ui5r srcvalue, ui5r dstvalue)
 {
 	ui5r result0 = dstvalue - srcvalue;
 	ui5r result1 = ui5r_FromUWord(dstvalue) - ui5r_FromUWord(srcvalue);
 	ui5r result = ui5r_FromSWord(result0);
 
-	ZFLG = (result == 0);
-	NFLG = ui5r_MSBisSet(result);
-	VFLG = (((result0 >> 1) ^ result0) >> 15) & 1;
-	CFLG = (result1 >> 16) & 1;
+	regs.z = (result == 0);
+	regs.n = ui5r_MSBisSet(result);
+	regs.v = (((result0 >> 1) ^ result0) >> 15) & 1;
+	regs.c = (result1 >> 16) & 1;
 }
 
-LOCALPROC ALU_CmpL(ui5r srcvalue, ui5r dstvalue)
+LOCALPROC SetCCRforCmpL(ui5r srcvalue, ui5r dstvalue)
 {
 	ui5r result = ui5r_FromSLong(dstvalue - srcvalue);
 
 	int flgs = ui5r_MSBisSet(srcvalue);
 	int flgo = ui5r_MSBisSet(dstvalue);
-	ZFLG = (result == 0);
-	NFLG = ui5r_MSBisSet(result);
-	VFLG = (flgs != flgo) && (NFLG != flgo);
-	CFLG = (flgs && ! flgo) || (NFLG && ((! flgo) || flgs));
+	regs.z = (result == 0);
+	regs.n = ui5r_MSBisSet(result);
+	regs.v = (flgs != flgo) && (regs.n != flgo);
+	regs.c = (flgs && ! flgo) || (regs.n && ((! flgo) || flgs));
 }
 
-LOCALFUNC ui5r ALU_AddB(ui5r srcvalue, ui5r dstvalue)
+LOCALPROC SetCCRforAddB(ui5r srcvalue, ui5r dstvalue)
 {
 	ui5r result0 = dstvalue + srcvalue;
 	ui5r result1 = ui5r_FromUByte(dstvalue) + ui5r_FromUByte(srcvalue);
 	ui5r result = ui5r_FromSByte(result0);
 
-	ZFLG = (result == 0);
-	NFLG = ui5r_MSBisSet(result);
-	VFLG = (((result0 >> 1) ^ result0) >> 7) & 1;
-	XFLG = CFLG = (result1 >> 8);
-
-	return result;
+	regs.z = (result == 0);
+	regs.n = ui5r_MSBisSet(result);
+	regs.v = (((result0 >> 1) ^ result0) >> 7) & 1;
+	regs.c = (result1 >> 8);
 }
 
-LOCALFUNC ui5r ALU_AddW(ui5r srcvalue, ui5r dstvalue)
+LOCALPROC SetCCRforAddW(ui5r srcvalue, ui5r dstvalue)
 {
 	ui5r result0 = dstvalue + srcvalue;
 	ui5r result1 = ui5r_FromUWord(dstvalue) + ui5r_FromUWord(srcvalue);
 	ui5r result = ui5r_FromSWord(result0);
 
-	ZFLG = (result == 0);
-	NFLG = ui5r_MSBisSet(result);
-	VFLG = (((result0 >> 1) ^ result0) >> 15) & 1;
-	XFLG = CFLG = (result1 >> 16);
+	regs.z = (result == 0);
+	regs.n = ui5r_MSBisSet(result);
+	regs.v = (((result0 >> 1) ^ result0) >> 15) & 1;
+	regs.c = (result1 >> 16);
+}
 
-	return result;
+LOCALPROC SetCCRforAddL(ui5r srcvalue, ui5r dstvalue)
+{
+	ui5r result = ui5r_FromSLong(dstvalue + srcvalue);
+
+	int flgs = ui5r_MSBisSet(srcvalue);
+	int flgo = ui5r_MSBisSet(dstvalue);
+	regs.z = (result == 0);
+	regs.n = ui5r_MSBisSet(result);
+	regs.v = (flgs && flgo && ! regs.n) || ((! flgs) && (! flgo) && regs.n);
+	regs.c = (flgs && flgo) || ((! regs.n) && (flgo || flgs));
+}
+
+#if WantLazyFlags
+LOCALPROC m68k_NeedFlags0(void)
+{
+	ui5r s = regs.LazySrc;
+	ui5r d = regs.LazyDst;
+
+	switch (regs.LazyFlagKind) {
+		case kLazyFlagsLogic: SetCCRforLogic0(d); break;
+		case kLazyFlagsAddB:  SetCCRforAddB(s, d); break;
+		case kLazyFlagsAddW:  SetCCRforAddW(s, d); break;
+		case kLazyFlagsAddL:  SetCCRforAddL(s, d); break;
+		case kLazyFlagsCmpB:  SetCCRforCmpB(s, d); break;
+		case kLazyFlagsCmpW:  SetCCRforCmpW(s, d); break;
+		case kLazyFlagsCmpL:  SetCCRforCmpL(s, d); break;
+		default: break;
+	}
+	regs.LazyFlagKind = kLazyFlagsNone;
+}
+
+#define SetCCRforLogic(v) SetLazyFlags(kLazyFlagsLogic, 0, (v))
+#else
+#define SetCCRforLogic SetCCRforLogic0
+#endif
+
+/*
+	bit i of cctrue_tab[cc] is set if condition cc holds
+	when the flags are NZVC == i.
+*/
+LOCALVAR const ui4b cctrue_tab[16] = {
+	0xFFFF, /* T */
+	0x0000, /* F */
+	0x0505, /* HI */
+	0xFAFA, /* LS */
+	0x5555, /* CC */
+	0xAAAA, /* CS */
+	0x0F0F, /* NE */
+	0xF0F0, /* EQ */
+	0x3333, /* VC */
+	0xCCCC, /* VS */
+	0x00FF, /* PL */
+	0xFF00, /* MI */
+	0xCC33, /* GE */
+	0x33CC, /* LT */
+	0x0C03, /* GT */
+	0xF3FC  /* LE */
+};
+
+#if WantLazyFlags
+/*
+	After a CMP or SUB the usual conditions are just comparisons
+	of the operands, so there is no need to work out the flags.
+	Returns -1 for the conditions that do need them.
+*/
+LOCALFUNC int cctrueCmp(int cc)
+{
+	ui5r us;
+	ui5r ud;
+	si5r ss;
+	si5r sd;
+
+	switch (regs.LazyFlagKind) {
+		case kLazyFlagsCmpB:
+			us = ui5r_FromUByte(regs.LazySrc);
+			ud = ui5r_FromUByte(regs.LazyDst);
+			ss = (si5r)ui5r_FromSByte(regs.LazySrc);
+			sd = (si5r)ui5r_FromSByte(regs.LazyDst);
+			break;
+		case kLazyFlagsCmpW:
+			us = ui5r_FromUWord(regs.LazySrc);
+			ud = ui5r_FromUWord(regs.LazyDst);
+			ss = (si5r)ui5r_FromSWord(regs.LazySrc);
+			sd = (si5r)ui5r_FromSWord(regs.LazyDst);
+			break;
+		case kLazyFlagsCmpL:
+			us = ui5r_FromULong(regs.LazySrc);
+			ud = ui5r_FromULong(regs.LazyDst);
+			ss = (si5r)ui5r_FromSLong(regs.LazySrc);
+			sd = (si5r)ui5r_FromSLong(regs.LazyDst);
+			break;
+		default:
+			return -1;
+	}
+
+	switch (cc) {
+		case 2:  return ud > us;  /* HI */
+		case 3:  return ud <= us; /* LS */
+		case 4:  return ud >= us; /* CC */
+		case 5:  return ud < us;  /* CS */
+		case 6:  return ud != us; /* NE */
+		case 7:  return ud == us; /* EQ */
+		case 12: return sd >= ss; /* GE */
+		case 13: return sd < ss;  /* LT */
+		case 14: return sd > ss;  /* GT */
+		case 15: return sd <= ss; /* LE */
+		default: return -1;
+	}
+}
+#endif
+
+LOCALFUNC MayInline blnr cctrue(void)
+{
+	int cc = (regs.opcode >> 8) & 15;
+
+#if WantLazyFlags
+	if (regs.LazyFlagKind >= kLazyFlagsCmpB) {
+		int r = cctrueCmp(cc);
+
+		if (r >= 0) {
+			return r;
+		}
+	}
+#endif
+	m68k_NeedFlags();
+	return (cctrue_tab[cc] >> ((regs.n << 3) | (regs.z << 2)
+		| (regs.v << 1) | regs.c)) & 1;
+}
+
+LOCALPROC ALU_CmpB(ui5r srcvalue, ui5r dstvalue)
+{
+#if WantLazyFlags
+	SetLazyFlags(kLazyFlagsCmpB, srcvalue, dstvalue);
+#else
+	SetCCRforCmpB(srcvalue, dstvalue);
+#endif
+}
+
+LOCALPROC ALU_CmpW(ui5r srcvalue, ui5r dstvalue)
+{
+#if WantLazyFlags
+	SetLazyFlags(kLazyFlagsCmpW, srcvalue, dstvalue);
+#else
+	SetCCRforCmpW(srcvalue, dstvalue);
+#endif
+}
+
+LOCALPROC ALU_CmpL(ui5r srcvalue, ui5r dstvalue)
+{
+#if WantLazyFlags
+	SetLazyFlags(kLazyFlagsCmpL, srcvalue, dstvalue);
+#else
+	SetCCRforCmpL(srcvalue, dstvalue);
+#endif
+}
+
+LOCALFUNC ui5r ALU_AddB(ui5r srcvalue, ui5r dstvalue)
+{
+#if WantLazyFlags
+	SetLazyFlags(kLazyFlagsAddB, srcvalue, dstvalue);
+	regs.x = (ui5r_FromUByte(dstvalue) + ui5r_FromUByte(srcvalue)) >> 8;
+#else
+	SetCCRforAddB(srcvalue, dstvalue);
+	XFLG = CFLG;
+#endif
+
+	return ui5r_FromSByte(dstvalue + srcvalue);
+}
+
+LOCALFUNC ui5r ALU_AddW(ui5r srcvalue, ui5r dstvalue)
+{
+#if WantLazyFlags
+	SetLazyFlags(kLazyFlagsAddW, srcvalue, dstvalue);
+	regs.x = (ui5r_FromUWord(dstvalue) + ui5r_FromUWord(srcvalue)) >> 16;
+#else
+	SetCCRforAddW(srcvalue, dstvalue);
+	XFLG = CFLG;
+#endif
+
+	return ui5r_FromSWord(dstvalue + srcvalue);
 }
 
 LOCALFUNC ui5r ALU_AddL(ui5r srcvalue, ui5r dstvalue)
 {
 	ui5r result = ui5r_FromSLong(dstvalue + srcvalue);
 
+#if WantLazyFlags
 	int flgs = ui5r_MSBisSet(srcvalue);
 	int flgo = ui5r_MSBisSet(dstvalue);
-	ZFLG = (result == 0);
-	NFLG = ui5r_MSBisSet(result);
-	VFLG = (flgs && flgo && ! NFLG) || ((! flgs) && (! flgo) && NFLG);
-	XFLG = CFLG = (flgs && flgo) || ((! NFLG) && (flgo || flgs));
+	int flgn = ui5r_MSBisSet(result);
+	SetLazyFlags(kLazyFlagsAddL, srcvalue, dstvalue);
+	regs.x = (flgs && flgo) || ((! flgn) && (flgo || flgs));
+#else
+	SetCCRforAddL(srcvalue, dstvalue);
+	XFLG = CFLG;
+#endif
 
 	return result;
 }
 
 LOCALFUNC ui5r ALU_SubB(ui5r srcvalue, ui5r dstvalue)
 {
-	ui5r result0 = dstvalue - srcvalue;
-	ui5r result1 = ui5r_FromUByte(dstvalue) - ui5r_FromUByte(srcvalue);
-	ui5r result = ui5r_FromSByte(result0);
-
-	ZFLG = (result == 0);
-	NFLG = ui5r_MSBisSet(result);
-	VFLG = (((result0 >> 1) ^ result0) >> 7) & 1;
-	XFLG = CFLG = (result1 >> 8) & 1;
+#if WantLazyFlags
+	SetLazyFlags(kLazyFlagsCmpB, srcvalue, dstvalue);
+	regs.x = ((ui5r_FromUByte(dstvalue) - ui5r_FromUByte(srcvalue)) >> 8)
+		& 1;
+#else
+	SetCCRforCmpB(srcvalue, dstvalue);
+	XFLG = CFLG;
+#endif
 
-	return result;
+	return ui5r_FromSByte(dstvalue - srcvalue);
 }
 
 LOCALFUNC ui5r ALU_SubW(ui5r srcvalue, ui5r dstvalue)
 {
-	ui5r result0 = dstvalue - srcvalue;
-	ui5r result1 = ui5r_FromUWord(dstvalue) - ui5r_FromUWord(srcvalue);
-	ui5r result = ui5r_FromSWord(result0);
-
-	ZFLG = (result == 0);
-	NFLG = ui5r_MSBisSet(result);
-	VFLG = (((result0 >> 1) ^ result0) >> 15) & 1;
-	XFLG = CFLG = (result1 >> 16) & 1;
+#if WantLazyFlags
+	SetLazyFlags(kLazyFlagsCmpW, srcvalue, dstvalue);
+	regs.x = ((ui5r_FromUWord(dstvalue) - ui5r_FromUWord(srcvalue)) >> 16)
+		& 1;
+#else
+	SetCCRforCmpW(srcvalue, dstvalue);
+	XFLG = CFLG;
+#endif
 
-	return result;
+	return ui5r_FromSWord(dstvalue - srcvalue);
 }
 
 LOCALFUNC ui5r ALU_SubL(ui5r srcvalue, ui5r dstvalue)
 {
 	ui5r result = ui5r_FromSLong(dstvalue - srcvalue);
 
+#if WantLazyFlags
 	int flgs = ui5r_MSBisSet(srcvalue);
 	int flgo = ui5r_MSBisSet(dstvalue);
-	ZFLG = (result == 0);
-	NFLG = ui5r_MSBisSet(result);
-	VFLG = (flgs != flgo) && (NFLG != flgo);
-	XFLG = CFLG = (flgs && ! flgo) || (NFLG && ((! flgo) || flgs));
+	int flgn = ui5r_MSBisSet(result);
+	SetLazyFlags(kLazyFlagsCmpL, srcvalue, dstvalue);
+	regs.x = (flgs && ! flgo) || (flgn && ((! flgo) || flgs));
+#else
+	SetCCRforCmpL(srcvalue, dstvalue);
+	XFLG = CFLG;
+#endif
 
 	return result;
 }
@@ -495,13 +913,125 @@ LOCALFUNC ui5r ALU_SubXL(ui5r srcvalue, ui5r dstvalue)
 #define m68k_logExceptions (dbglog_HAVE && 0)
 
 
+#if WantMATCStats && dbglog_HAVE
+/*
+	FindATTel is called on every miss of the MATC caches, so
+	counting what it finds gives the miss rate per kind of
+	region, and how many of the misses had to walk the list.
+*/
+enum {
+	kMATCStatRAM,
+	kMATCStatROM,
+	kMATCStatDev,
+	kMATCStatOther,
+	kMATCStatWalk,
+
+	kNumMATCStats
+};
+
+LOCALVAR ui5r MATCStats[kNumMATCStats];
+
+LOCALVAR char *MATCStatNames[kNumMATCStats] = {
+	"MATC misses RAM",
+	"MATC misses ROM",
+	"MATC misses device",
+	"MATC misses other",
+	"ATT list walks"
+};
+
+GLOBALPROC m68k_LogMATCStats(void)
+{
+	int i;
+
+	for (i = 0; i < kNumMATCStats; ++i) {
+		dbglog_writelnNum(MATCStatNames[i], MATCStats[i]);
+		MATCStats[i] = 0;
+	}
+}
+
+LOCALFUNC ATTep MATCStatNtfy(ATTep p)
+{
+	if (0 != (p->Access & kATTA_writereadymask)) {
+		++MATCStats[kMATCStatRAM];
+	} else if (0 != (p->Access & kATTA_readreadymask)) {
+		++MATCStats[kMATCStatROM];
+	} else if (0 != (p->Access & kATTA_mmdvmask)) {
+		++MATCStats[kMATCStatDev];
+	} else {
+		++MATCStats[kMATCStatOther];
+	}
+
+	return p;
+}
+
+#define MATCStatWalkNtfy() (++MATCStats[kMATCStatWalk])
+#else
+#define MATCStatNtfy(p) (p)
+#define MATCStatWalkNtfy()
+#endif
+
+#if WantATTPageTable
+/*
+	For each 64K page of the 24 bit address space, the ATT
+	entry that every address in the page maps to, whatever
+	the high 8 bits of the address, or nullpr if that isn't
+	the case. Rebuilt by SetHeadATTel whenever the memory map
+	changes. FindATTel only has to walk the list for pages
+	that are nullpr here.
+*/
+
+#define ln2ATTPageSz 16
+#define kNumATTPages 256
+
+LOCALVAR ATTep ATTPageTab[kNumATTPages];
+
+LOCALPROC ATTPageTabSetUp(ATTep h)
+{
+	ui5r i;
+	ATTep p;
+	ATTep v;
+
+	for (i = 0; i < kNumATTPages; ++i) {
+		ui5r a = i << ln2ATTPageSz;
+
+		v = nullpr;
+		for (p = h; nullpr != p; p = p->Next) {
+			if (0 != (p->cmpvalu & ~ p->cmpmask)) {
+				/* never matches */
+			} else if (0 ==
+				((a ^ p->cmpvalu) & p->cmpmask & 0x00FF0000))
+			{
+				/*
+					first entry that could match some
+					address in this page. usable if it
+					matches all of them.
+				*/
+				if (0 == (p->cmpmask & 0xFF00FFFF)) {
+					v = p;
+				}
+				break;
+			}
+		}
+		ATTPageTab[i] = v;
+	}
+}
+#endif
+
 GLOBALFUNC ATTep FindATTel(CPTR addr)
 {
 	ATTep prev;
 	ATTep p;
 
+#if WantATTPageTable
+	p = ATTPageTab[(addr >> ln2ATTPageSz) & (kNumATTPages - 1)];
+	if (nullpr != p) {
+		return MATCStatNtfy(p);
+	}
+#endif
+
 	p = regs.HeadATTel;
 	if ((addr & p->cmpmask) != p->cmpvalu) {
+		MATCStatWalkNtfy();
 		do {
 			prev = p;
 			p = p->Next;
@@ -521,7 +1051,7 @@ GLOBALFUNC ATTep FindATTel(CPTR addr)
 		}
 	}
 
-	return p;
+	return MATCStatNtfy(p);
 }
 
 LOCALPROC SetUpMATC(
@@ -534,25 +1064,99 @@ LOCALPROC SetUpMATC(
 	CurMATC->usebase = p->usebase;
 }
 
-LOCALFUNC ui5r get_byte_ext(CPTR addr)
-{
-	ATTep p;
-	ui3p m;
-	ui5r AccFlags;
-	ui5r Data;
+#if EnableScreenDirtyRows
+/*
+	Compared as integers, since m needn't be in the screen buffer,
+	and ScreenDirtyBase is nullpr until the screen is set up, when
+	the offset can't come out in range.
+*/
+#define ScreenWriteNtfy(m) \
+	{ \
+		uimr ScrnOffset = (uimr)(m) - (uimr)ScreenDirtyBase; \
+		if (ScrnOffset < vMacScreenNumBytes) { \
+			ScreenDirtyRowSet(ScrnOffset / vMacScreenByteWidth); \
+		} \
+	}
+#else
+#define ScreenWriteNtfy(m)
+#endif
 
-Label_Retry:
-	p = FindATTel(addr);
-	AccFlags = p->Access;
+#if WantIdleSkip
+#define IdleProgressNtfy() (regs.IdleProgress = trueblnr)
+#else
+#define IdleProgressNtfy()
+#endif
 
-	if (0 != (AccFlags & kATTA_readreadymask)) {
-		SetUpMATC(&regs.MATCrdB, p);
-		m = p->usebase + (addr & p->usemask);
+#if EnableDynarec && WantDynarecCheck
+/*
+	While the dynamic recompiler checks a block against the
+	interpreter (see DYNAREC.h), writes to memory are journaled
+	so that they can be undone, and any access to a device is
+	noted, since that can't be undone and done again.
+*/
 
-		Data = *m;
-	} else if (0 != (AccFlags & kATTA_mmdvmask)) {
-		Data = MMDV_Access(p, 0, falseblnr, trueblnr, addr);
-	} else if (0 != (AccFlags & kATTA_ntfymask)) {
+#define kDrJournalSz 1024
+
+struct DrJournalEl {
+	ui4b *p;
+	ui4b old;
+	ui4b new;
+};
+typedef struct DrJournalEl DrJournalEl;
+
+LOCALVAR blnr DrJournalOn = falseblnr;
+LOCALVAR blnr DrDeviceUsed;
+LOCALVAR ui5r DrJournalN;
+LOCALVAR DrJournalEl DrJournal[kDrJournalSz];
+
+LOCALPROC DrJournalWrite(ui3p m, ui5r n)
+{
+	/* whole words, so it works with WantWordSwappedMem */
+	ui3p p = (ui3p)(((uimr)m) & ~ (uimr)1);
+
+	for (; p < m + n; p += 2) {
+		if (DrJournalN < kDrJournalSz) {
+			DrJournal[DrJournalN].p = (ui4b *)p;
+			DrJournal[DrJournalN].old = *(ui4b *)p;
+		}
+		++DrJournalN;
+	}
+}
+
+#define DrWriteNtfy(m, n) \
+	{ \
+		if (DrJournalOn) { \
+			DrJournalWrite((m), (n)); \
+		} \
+	}
+#define DrDeviceNtfy() (DrDeviceUsed = trueblnr)
+#else
+#define DrWriteNtfy(m, n)
+#define DrDeviceNtfy()
+#endif
+
+LOCALFUNC ui5r get_byte_ext(CPTR addr)
+{
+	ATTep p;
+	ui3p m;
+	ui5r AccFlags;
+	ui5r Data;
+
+Label_Retry:
+	p = FindATTel(addr);
+	AccFlags = p->Access;
+
+	if (0 != (AccFlags & kATTA_readreadymask)) {
+		SetUpMATC(&regs.MATCrdB, p);
+		m = p->usebase + (addr & p->usemask);
+
+		Data = do_get_vmem_byte(m);
+	} else if (0 != (AccFlags & kATTA_mmdvmask)) {
+		IdleProgressNtfy();
+		DrDeviceNtfy();
+		Data = MMDV_Access(p, 0, falseblnr, trueblnr, addr);
+	} else if (0 != (AccFlags & kATTA_ntfymask)) {
+		DrDeviceNtfy();
 		if (MemAccessNtfy(p)) {
 			goto Label_Retry;
 		} else {
@@ -570,7 +1174,7 @@ LOCALFUNC MayNotInline ui5r get_byte(CPTR addr)
 	ui3p m = (addr & regs.MATCrdB.usemask) + regs.MATCrdB.usebase;
 
 	if ((addr & regs.MATCrdB.cmpmask) == regs.MATCrdB.cmpvalu) {
-		return ui5r_FromSByte(*m);
+		return ui5r_FromSByte(do_get_vmem_byte(m));
 	} else {
 		return get_byte_ext(addr);
 	}
@@ -582,6 +1186,8 @@ LOCALPROC put_byte_ext(CPTR addr, ui5r b)
 	ui3p m;
 	ui5r AccFlags;
 
+	IdleProgressNtfy();
+
 Label_Retry:
 	p = FindATTel(addr);
 	AccFlags = p->Access;
@@ -589,10 +1195,15 @@ Label_Retry:
 	if (0 != (AccFlags & kATTA_writereadymask)) {
 		SetUpMATC(&regs.MATCwrB, p);
 		m = p->usebase + (addr & p->usemask);
-		*m = b;
+		DrWriteNtfy(m, 1);
+		do_put_vmem_byte(m, b);
+		ScreenWriteNtfy(m);
+		BcWriteNtfy(m);
 	} else if (0 != (AccFlags & kATTA_mmdvmask)) {
+		DrDeviceNtfy();
 		(void) MMDV_Access(p, b & 0x00FF, trueblnr, trueblnr, addr);
 	} else if (0 != (AccFlags & kATTA_ntfymask)) {
+		DrDeviceNtfy();
 		if (MemAccessNtfy(p)) {
 			goto Label_Retry;
 		} else {
@@ -607,7 +1218,10 @@ LOCALPROC MayNotInline put_byte(CPTR addr, ui5r b)
 {
 	ui3p m = (addr & regs.MATCwrB.usemask) + regs.MATCwrB.usebase;
 	if ((addr & regs.MATCwrB.cmpmask) == regs.MATCwrB.cmpvalu) {
-		*m = b;
+		DrWriteNtfy(m, 1);
+		do_put_vmem_byte(m, b);
+		ScreenWriteNtfy(m);
+		BcWriteNtfy(m);
 	} else {
 		put_byte_ext(addr, b);
 	}
@@ -635,10 +1249,13 @@ Label_Retry:
 			SetUpMATC(&regs.MATCrdW, p);
 			regs.MATCrdW.cmpmask |= 0x01;
 			m = p->usebase + (addr & p->usemask);
-			Data = do_get_mem_word(m);
+			Data = do_get_vmem_word(m);
 		} else if (0 != (AccFlags & kATTA_mmdvmask)) {
+			IdleProgressNtfy();
+			DrDeviceNtfy();
 			Data = MMDV_Access(p, 0, falseblnr, falseblnr, addr);
 		} else if (0 != (AccFlags & kATTA_ntfymask)) {
+			DrDeviceNtfy();
 			if (MemAccessNtfy(p)) {
 				goto Label_Retry;
 			} else {
@@ -656,7 +1273,7 @@ LOCALFUNC MayNotInline ui5r get_word(CPTR addr)
 {
 	ui3p m = (addr & regs.MATCrdW.usemask) + regs.MATCrdW.usebase;
 	if ((addr & regs.MATCrdW.cmpmask) == regs.MATCrdW.cmpvalu) {
-		return ui5r_FromSWord(do_get_mem_word(m));
+		return ui5r_FromSWord(do_get_vmem_word(m));
 	} else {
 		return get_word_ext(addr);
 	}
@@ -664,6 +1281,8 @@ LOCALFUNC MayNotInline ui5r get_word(CPTR addr)
 
 LOCALPROC put_word_ext(CPTR addr, ui5r w)
 {
+	IdleProgressNtfy();
+
 	if (0 != (addr & 0x01)) {
 		put_byte(addr, w >> 8);
 		put_byte(addr + 1, w);
@@ -680,11 +1299,16 @@ Label_Retry:
 			SetUpMATC(&regs.MATCwrW, p);
 			regs.MATCwrW.cmpmask |= 0x01;
 			m = p->usebase + (addr & p->usemask);
-			do_put_mem_word(m, w);
+			DrWriteNtfy(m, 2);
+			do_put_vmem_word(m, w);
+			ScreenWriteNtfy(m);
+			BcWriteNtfy(m);
 		} else if (0 != (AccFlags & kATTA_mmdvmask)) {
+			DrDeviceNtfy();
 			(void) MMDV_Access(p, w & 0x0000FFFF,
 				trueblnr, falseblnr, addr);
 		} else if (0 != (AccFlags & kATTA_ntfymask)) {
+			DrDeviceNtfy();
 			if (MemAccessNtfy(p)) {
 				goto Label_Retry;
 			} else {
@@ -700,7 +1324,10 @@ LOCALPROC MayNotInline put_word(CPTR addr, ui5r w)
 {
 	ui3p m = (addr & regs.MATCwrW.usemask) + regs.MATCwrW.usebase;
 	if ((addr & regs.MATCwrW.cmpmask) == regs.MATCwrW.cmpvalu) {
-		do_put_mem_word(m, w);
+		DrWriteNtfy(m, 2);
+		do_put_vmem_word(m, w);
+		ScreenWriteNtfy(m);
+		BcWriteNtfy(m);
 	} else {
 		put_word_ext(addr, w);
 	}
@@ -724,12 +1351,20 @@ LOCALFUNC MayNotInline ui5r get_long(CPTR addr)
 	if (((addr & regs.MATCrdW.cmpmask) == regs.MATCrdW.cmpvalu)
 		&& ((addr2 & regs.MATCrdW.cmpmask) == regs.MATCrdW.cmpvalu))
 	{
-		ui5r hi = do_get_mem_word(m);
-		ui5r lo = do_get_mem_word(m2);
-		ui5r Data = ((hi << 16) & 0xFFFF0000)
-			| (lo & 0x0000FFFF);
+#if WantWordSwappedMem
+		/* one access unless the long wraps around a mirror */
+		if (m2 == m + 2) {
+			return ui5r_FromSLong(do_get_vmem_long(m));
+		} else
+#endif
+		{
+			ui5r hi = do_get_vmem_word(m);
+			ui5r lo = do_get_vmem_word(m2);
+			ui5r Data = ((hi << 16) & 0xFFFF0000)
+				| (lo & 0x0000FFFF);
 
-		return ui5r_FromSLong(Data);
+			return ui5r_FromSLong(Data);
+		}
 	} else {
 		return get_long_ext(addr);
 	}
@@ -749,8 +1384,21 @@ LOCALPROC MayNotInline put_long(CPTR addr, ui5r l)
 	if (((addr & regs.MATCwrW.cmpmask) == regs.MATCwrW.cmpvalu)
 		&& ((addr2 & regs.MATCwrW.cmpmask) == regs.MATCwrW.cmpvalu))
 	{
-		do_put_mem_word(m, l >> 16);
-		do_put_mem_word(m2, l);
+		DrWriteNtfy(m, 2);
+		DrWriteNtfy(m2, 2);
+#if WantWordSwappedMem
+		if (m2 == m + 2) {
+			do_put_vmem_long(m, l);
+		} else
+#endif
+		{
+			do_put_vmem_word(m, l >> 16);
+			do_put_vmem_word(m2, l);
+		}
+		ScreenWriteNtfy(m);
+		ScreenWriteNtfy(m2);
+		BcWriteNtfy(m);
+		BcWriteNtfy(m2);
 	} else {
 		put_long_ext(addr, l);
 	}
@@ -785,7 +1433,7 @@ Label_Retry:
 			SetUpMATC(&regs.MATCex, p);
 			regs.MATCex.cmpmask |= 0x01;
 			m = p->usebase + (addr & p->usemask);
-			Data = do_get_mem_word(m);
+			Data = do_get_vmem_word(m);
 		} else
 		/*
 			no, don't run from device
@@ -812,7 +1460,7 @@ LOCALFUNC MayInline ui4r nextiword(void)
 /* NOT sign extended */
 {
 #if USE_POINTER
-	ui4r r = do_get_mem_word(regs.pc_p);
+	ui4r r = do_get_vmem_word(regs.pc_p);
 	regs.pc_p += 2;
 	return r;
 #else
@@ -822,7 +1470,7 @@ LOCALFUNC MayInline ui4r nextiword(void)
 
 	m = (addr & regs.MATCex.usemask) + regs.MATCex.usebase;
 	if ((addr & regs.MATCex.cmpmask) == regs.MATCex.cmpvalu) {
-		Data = do_get_mem_word(m);
+		Data = do_get_vmem_word(m);
 	} else {
 		Data = get_pc_word_ext();
 	}
@@ -834,7 +1482,7 @@ LOCALFUNC MayInline ui4r nextiword(void)
 LOCALFUNC MayInline ui3r nextibyte(void)
 {
 #if USE_POINTER
-	ui3r r = do_get_mem_byte(regs.pc_p + 1);
+	ui3r r = do_get_vmem_byte(regs.pc_p + 1);
 	regs.pc_p += 2;
 	return r;
 #else
@@ -845,7 +1493,7 @@ LOCALFUNC MayInline ui3r nextibyte(void)
 LOCALFUNC MayInline ui5r nextilong(void)
 {
 #if USE_POINTER
-	ui5r r = do_get_mem_long(regs.pc_p);
+	ui5r r = do_get_vmem_long(regs.pc_p);
 	regs.pc_p += 4;
 #else
 	ui5r hi = nextiword();
@@ -918,17 +1566,35 @@ Label_Retry:
 	if (0 == (p->Access & kATTA_readreadymask))
 	{
 		if (0 != (p->Access & kATTA_ntfymask)) {
+			DrDeviceNtfy();
 			if (MemAccessNtfy(p)) {
 				goto Label_Retry;
 			}
 		}
 		/* in trouble if get here */
 		/* ReportAbnormal("get_pc_real_address fails"); */
-		v = regs.fakeword;
+		v = (ui3p)&regs.fakeword;
 		regs.MATCex.cmpmask = 0;
 		regs.MATCex.cmpvalu = 0xFFFFFFFF;
-	} else {
+	} else
+#if WantWordSwappedMem
+	if (0 != (addr & 0x01)) {
+		/*
+			An address error on a real 68000, which isn't
+			emulated. Can't fetch words from an odd address
+			with words swapped in real memory, so execute the
+			illegal instruction in fakeword instead.
+		*/
+		v = (ui3p)&regs.fakeword;
+		regs.MATCex.cmpmask = 0;
+		regs.MATCex.cmpvalu = 0xFFFFFFFF;
+	} else
+#endif
+	{
 		SetUpMATC(&regs.MATCex, p);
+#if WantWordSwappedMem
+		regs.MATCex.cmpmask |= 0x01;
+#endif
 		v = (addr & p->usemask) + p->usebase;
 	}
 
@@ -975,6 +1641,23 @@ LOCALFUNC MayInline CPTR m68k_getpc(void)
 #endif
 }
 
+#if USE_POINTER
+/* relative jump within the current block of memory */
+LOCALFUNC MayInline void m68k_setpc_p(ui3p s)
+{
+	regs.pc_p = s;
+#if WantWordSwappedMem
+	if (0 != (1 & (uimr)s)) {
+		/*
+			odd target, let get_pc_real_address
+			send it to fakeword
+		*/
+		m68k_setpc(m68k_getpc());
+	}
+#endif
+}
+#endif
+
 LOCALFUNC ui4b m68k_getSR(void)
 {
 	return (regs.t1 << 15)
@@ -991,6 +1674,7 @@ LOCALFUNC ui4b m68k_getSR(void)
 
 LOCALPROC NeedToGetOut(void)
 {
+	BcSettle();
 	if (regs.MaxCyclesToGo <= 0) {
 		/*
 			already have gotten out, and exception processing has
@@ -1066,6 +1750,10 @@ LOCALPROC m68k_setSR(ui4r newsr)
 #define FastRelativeJump (1 && USE_POINTER)
 #endif
 
+#if WantDBFAccel && ! FastRelativeJump
+#error "WantDBFAccel requires FastRelativeJump"
+#endif
+
 LOCALPROC ExceptionTo(CPTR newpc
 #if Use68020
 	, int nr
@@ -1074,6 +1762,9 @@ LOCALPROC ExceptionTo(CPTR newpc
 {
 	ui4b saveSR = m68k_getSR();
 
+#if WantIdleSkip
+	regs.stopped = falseblnr;
+#endif
 	if (! regs.s) {
 		regs.usp = m68k_areg(7);
 		m68k_areg(7) =
@@ -1106,6 +1797,12 @@ LOCALPROC ExceptionTo(CPTR newpc
 	m68k_areg(7) -= 2;
 	put_word(m68k_areg(7), saveSR);
 	m68k_setpc(newpc);
+#if WantBlockCache
+	if (nullpr != BcRec) {
+		/* the decoding may not have been finished */
+		BcRecBad = trueblnr;
+	}
+#endif
 	regs.t1 = 0;
 #if Use68020
 	regs.t0 = 0;
@@ -1237,12 +1934,45 @@ LOCALFUNC MayNotInline ui5b get_disp_ea(ui5b base)
 }
 
 
-LOCALFUNC MayNotInline ArgAddrT DecodeSrcDst(ui5r f)
+/*
+	DecodeAMd, GetArgkValue and SetArgkValue take the addressing
+	mode and argument kind as separate parameters, so that a handler
+	specialized for one mode can pass a constant and have the switch
+	folded away.
+*/
+
+#if WantBlockCache
+LOCALFUNC MayInline ui5r BcExtTake(ui5r n)
+{
+	/* an operand from the record, instead of its extension words */
+	regs.pc_p += n;
+	return *regs.BcExtP++;
+}
+
+LOCALFUNC MayInline ui5r BcExtKeep(ui5r v)
+{
+	if (nullpr != BcRecExtP) {
+		if (BcRecExtP < BcRecExtEnd) {
+			*BcRecExtP++ = v;
+		} else {
+			BcRecBad = trueblnr;
+		}
+	}
+	return v;
+}
+
+#define BcExt(x, n) \
+	((nullpr != regs.BcExtP) ? BcExtTake(n) : BcExtKeep(x))
+#else
+#define BcExt(x, n) (x)
+#endif
+
+LOCALFUNC AlwaysInline ArgAddrT DecodeAMd(ui5r f, ui3r amd)
 {
 	ui5r *p;
 	ArgAddrT v;
 
-	switch (GetDcoFldAMd(f)) {
+	switch (amd) {
 		case kAMdReg :
 			v.rga = &regs.regs[GetDcoFldArgDat(f)];
 			break;
@@ -1282,33 +2012,33 @@ LOCALFUNC MayNotInline ArgAddrT DecodeSrcDst(ui5r f)
 			break;
 		case kAMdADisp :
 			p = &regs.regs[GetDcoFldArgDat(f)];
-			v.mem = *p + ui5r_FromSWord(nextiword());
+			v.mem = *p + BcExt(ui5r_FromSWord(nextiword()), 2);
 			break;
 		case kAMdAIndex :
 			p = &regs.regs[GetDcoFldArgDat(f)];
 			v.mem = get_disp_ea(*p);
 			break;
 		case kAMdAbsW :
-			v.mem = ui5r_FromSWord(nextiword());
+			v.mem = BcExt(ui5r_FromSWord(nextiword()), 2);
 			break;
 		case kAMdAbsL :
-			v.mem = nextilong();
+			v.mem = BcExt(nextilong(), 4);
 			break;
 		case kAMdPCDisp :
 			v.mem = m68k_getpc();
-			v.mem += ui5r_FromSWord(nextiword());
+			v.mem += BcExt(ui5r_FromSWord(nextiword()), 2);
 			break;
 		case kAMdPCIndex :
 			v.mem = get_disp_ea(m68k_getpc());
 			break;
 		case kAMdImmedB :
-			v.mem = ui5r_FromSByte(nextibyte());
+			v.mem = BcExt(ui5r_FromSByte(nextibyte()), 2);
 			break;
 		case kAMdImmedW :
-			v.mem = ui5r_FromSWord(nextiword());
+			v.mem = BcExt(ui5r_FromSWord(nextiword()), 2);
 			break;
 		case kAMdImmedL :
-			v.mem = ui5r_FromSLong(nextilong());
+			v.mem = BcExt(ui5r_FromSLong(nextilong()), 4);
 			break;
 		case kAMdDat4 :
 		default: /* make compiler happy, should not happen */
@@ -1319,11 +2049,16 @@ LOCALFUNC MayNotInline ArgAddrT DecodeSrcDst(ui5r f)
 	return v;
 }
 
-LOCALFUNC MayNotInline ui5r GetSrcDstValue(ui5r f, ArgAddrT addr)
+LOCALFUNC MayNotInline ArgAddrT DecodeSrcDst(ui5r f)
+{
+	return DecodeAMd(f, GetDcoFldAMd(f));
+}
+
+LOCALFUNC AlwaysInline ui5r GetArgkValue(ui3r argk, ArgAddrT addr)
 {
 	ui5r v;
 
-	switch (GetDcoFldArgk(f)) {
+	switch (argk) {
 		case kArgkRegB:
 			v = ui5r_FromSByte(*addr.rga);
 			break;
@@ -1351,9 +2086,14 @@ LOCALFUNC MayNotInline ui5r GetSrcDstValue(ui5r f, ArgAddrT addr)
 	return v;
 }
 
-LOCALPROC MayNotInline SetSrcDstValue(ui5r f, ArgAddrT addr, ui5r v)
+LOCALFUNC MayNotInline ui5r GetSrcDstValue(ui5r f, ArgAddrT addr)
 {
-	switch (GetDcoFldArgk(f)) {
+	return GetArgkValue(GetDcoFldArgk(f), addr);
+}
+
+LOCALPROC AlwaysInline SetArgkValue(ui3r argk, ArgAddrT addr, ui5r v)
+{
+	switch (argk) {
 		case kArgkRegB:
 			*addr.rga = (*addr.rga & ~ 0xff) | ((v) & 0xff);
 			break;
@@ -1377,6 +2117,11 @@ LOCALPROC MayNotInline SetSrcDstValue(ui5r f, ArgAddrT addr, ui5r v)
 	}
 }
 
+LOCALPROC MayNotInline SetSrcDstValue(ui5r f, ArgAddrT addr, ui5r v)
+{
+	SetArgkValue(GetDcoFldArgk(f), addr, v);
+}
+
 LOCALFUNC MayInline ArgAddrT DecodeSrc(void)
 {
 	return DecodeSrcDst(regs.CurDecOp.B);
@@ -1437,9 +2182,7 @@ LOCALPROCUSEDONCE DoCodeTst(void)
 	ArgAddrT DstAddr = DecodeDst();
 	ui5r srcvalue = GetDstValue(DstAddr);
 
-	VFLG = CFLG = 0;
-	ZFLG = (srcvalue == 0);
-	NFLG = ui5r_MSBisSet(srcvalue);
+	SetCCRforLogic(srcvalue);
 }
 
 LOCALPROCUSEDONCE DoCodeCmpB(void)
@@ -1460,6 +2203,134 @@ LOCALPROCUSEDONCE DoCodeCmpL(void)
 	ALU_CmpL(regs.SrcVal, dstvalue);
 }
 
+#if WantIdleSkip
+/*
+	Idle loop skipping. A taken backward branch into one of the
+	idle ranges marks a possible polling loop. If the cpu comes
+	back to the same place with the same registers and SR, and in
+	between nothing was written and no device was touched, every
+	further pass will be identical until something outside the
+	cpu changes, which only happens at the end of the slice. So
+	all but the last pass of the slice are charged without being
+	interpreted. The last pass is run normally, so timing is
+	exactly as if the loop had been interpreted.
+
+	Writes are noticed by turning off the write MATCs, so that
+	they go through put_byte_ext or put_word_ext. Only one in
+	kIdleBackoff backward branches is looked at, which keeps the
+	cost low in ordinary loops; comparing states several passes
+	apart works just as well.
+*/
+
+#define kNumIdleRanges 4
+#define kIdleBackoff 32
+#define kIdleNoPC 0xFFFFFFFF
+
+LOCALVAR CPTR IdleRangeLo[kNumIdleRanges];
+LOCALVAR CPTR IdleRangeHi[kNumIdleRanges];
+LOCALVAR ui3r IdleRangeCount = 0;
+
+GLOBALPROC m68k_AddIdleRange(CPTR lo, CPTR hi)
+{
+	if (IdleRangeCount < kNumIdleRanges) {
+		IdleRangeLo[IdleRangeCount] = lo;
+		IdleRangeHi[IdleRangeCount] = hi;
+		++IdleRangeCount;
+	}
+}
+
+GLOBALFUNC ui5r m68k_TakeIdleCycles(void)
+{
+	ui5r v = regs.IdleCycles;
+
+	regs.IdleCycles = 0;
+#if EnableClockMult
+	v >>= regs.ClockShift;
+#endif
+	return v;
+}
+
+LOCALPROC IdleSaveState(CPTR pc)
+{
+	int i;
+
+	for (i = 0; i < 16; ++i) {
+		regs.IdleRegs[i] = regs.regs[i];
+	}
+	regs.IdleSR = m68k_getSR();
+	regs.IdlePC = pc;
+	regs.IdleArmed = falseblnr;
+}
+
+LOCALFUNC blnr IdleSameState(void)
+{
+	int i;
+
+	for (i = 0; i < 16; ++i) {
+		if (regs.IdleRegs[i] != regs.regs[i]) {
+			return falseblnr;
+		}
+	}
+	return regs.IdleSR == m68k_getSR();
+}
+
+LOCALPROC MayNotInline IdleBackBranchNtfy(void)
+{
+	CPTR pc = m68k_getpc();
+	si5r r;
+	si5r iter;
+	si5r k;
+	int i;
+
+	BcSettle();
+	r = regs.MaxCyclesToGo + regs.MoreCyclesToGo;
+	if (pc != regs.IdlePC) {
+		for (i = 0; i < IdleRangeCount; ++i) {
+			if ((pc >= IdleRangeLo[i]) && (pc < IdleRangeHi[i])) {
+				IdleSaveState(pc);
+				break;
+			}
+		}
+	} else if (! IdleSameState()) {
+		IdleSaveState(pc);
+	} else if (regs.IdleProgress || ! regs.IdleArmed) {
+		/* a pass left the registers alone, now watch memory */
+		regs.IdleArmed = trueblnr;
+		regs.IdleProgress = falseblnr;
+		regs.MATCwrB.cmpmask = 0;
+		regs.MATCwrB.cmpvalu = 0xFFFFFFFF;
+		regs.MATCwrW.cmpmask = 0;
+		regs.MATCwrW.cmpvalu = 0xFFFFFFFF;
+	} else {
+		iter = regs.IdleCyc - r;
+		if ((iter > 0) && (r > iter)) {
+			k = (r - 1) / iter;
+			r -= k * iter;
+			regs.IdleCycles += k * iter;
+			if (regs.MaxCyclesToGo >= r) {
+				regs.MoreCyclesToGo = 0;
+				regs.MaxCyclesToGo = r;
+			} else {
+				regs.MoreCyclesToGo = r - regs.MaxCyclesToGo;
+			}
+		}
+	}
+	regs.IdleCyc = r;
+	regs.IdleBackoff = kIdleBackoff;
+}
+
+#define IdleBackBranchCheck(d) \
+	if ((d) < 0) { \
+		if (0 == regs.IdleBackoff) { \
+			IdleBackBranchNtfy(); \
+		} else { \
+			--regs.IdleBackoff; \
+		} \
+	}
+#else
+#define IdleBackBranchCheck(d)
+#endif
+
 LOCALPROCUSEDONCE DoCodeBraB(void)
 {
 	ui5b src = ((ui5b)regs.opcode) & 255;
@@ -1472,10 +2343,11 @@ LOCALPROCUSEDONCE DoCodeBraB(void)
 	s += (si3b)(ui3b)src;
 
 #if FastRelativeJump
-	regs.pc_p = s;
+	m68k_setpc_p(s);
 #else
 	m68k_setpc(s);
 #endif
+	IdleBackBranchCheck((si3b)(ui3b)src);
 }
 
 LOCALPROCUSEDONCE DoCodeBraW(void)
@@ -1485,14 +2357,16 @@ LOCALPROCUSEDONCE DoCodeBraW(void)
 #else
 	ui5r s = m68k_getpc();
 #endif
+	si4b d = (si4b)(ui4b)nextiword();
 
-	s += (si4b)(ui4b)nextiword();
+	s += d;
 
 #if FastRelativeJump
-	regs.pc_p = s;
+	m68k_setpc_p(s);
 #else
 	m68k_setpc(s);
 #endif
+	IdleBackBranchCheck(d);
 }
 
 #if Use68020
@@ -1508,17 +2382,17 @@ LOCALPROCUSEDONCE DoCodeBraL(void)
 
 	/* Bra 0110ccccnnnnnnnn */
 #if FastRelativeJump
-	regs.pc_p = s;
+	m68k_setpc_p(s);
 #else
 	m68k_setpc(s);
 #endif
 }
 #endif
 
-LOCALPROCUSEDONCE DoCodeBccB(void)
+LOCALFUNC MayInline void DoBccB(blnr t)
 {
-	/* Bcc 0110ccccnnnnnnnn */
-	if (cctrue()) {
+	/* Bcc 0110ccccnnnnnnnn, t if the condition holds */
+	if (t) {
 #if WantCloserCyc
 		regs.MaxCyclesToGo -= (10 * kCycleScale + 2 * RdAvgXtraCyc);
 #endif
@@ -1531,10 +2405,15 @@ LOCALPROCUSEDONCE DoCodeBccB(void)
 	}
 }
 
-LOCALPROCUSEDONCE DoCodeBccW(void)
+LOCALPROCUSEDONCE DoCodeBccB(void)
 {
-	/* Bcc 0110ccccnnnnnnnn */
-	if (cctrue()) {
+	DoBccB(cctrue());
+}
+
+LOCALFUNC MayInline void DoBccW(blnr t)
+{
+	/* Bcc 0110ccccnnnnnnnn, t if the condition holds */
+	if (t) {
 #if WantCloserCyc
 		regs.MaxCyclesToGo -= (10 * kCycleScale + 2 * RdAvgXtraCyc);
 #endif
@@ -1547,6 +2426,11 @@ LOCALPROCUSEDONCE DoCodeBccW(void)
 	}
 }
 
+LOCALPROCUSEDONCE DoCodeBccW(void)
+{
+	DoBccW(cctrue());
+}
+
 #if Use68020
 LOCALPROCUSEDONCE DoCodeBccL(void)
 {
@@ -1562,90 +2446,436 @@ LOCALPROCUSEDONCE DoCodeBccL(void)
 #define reg (regs.opcode & 7)
 #define rg9 ((regs.opcode >> 9) & 7)
 
-LOCALPROCUSEDONCE DoCodeDBcc(void)
-{
-	/* DBcc 0101cccc11001ddd */
+#if WantDBFAccel
+/*
+	DBF loops with a single MOVE (An)+,(An)+, MOVE Dn,(An)+ or
+	CLR (An)+ as the body are the usual way to copy, fill and
+	clear memory. When both sides are plain memory through the
+	MATC caches, run as many more iterations as the interpreter
+	would have before its cycles ran out, all at once.
+*/
 
-	ui5r dstvalue;
-#if FastRelativeJump
-	ui3p srcvalue = regs.pc_p;
-#else
-	ui5r srcvalue = m68k_getpc();
-#endif
+LOCALFUNC ui3p DBFAccelMemPtr(MATCp m, CPTR addr, ui5r len, ui5r sz)
+{
+	CPTR lastelem = addr + len - sz;
 
-	srcvalue += (si4b)(ui4b)nextiword();
-	if (cctrue()) {
-#if WantCloserCyc
-		regs.MaxCyclesToGo -= (12 * kCycleScale + 2 * RdAvgXtraCyc);
-#endif
+	if (((addr & m->cmpmask) == m->cmpvalu)
+		&& ((lastelem & m->cmpmask) == m->cmpvalu)
+		&& ((addr & m->usemask) + len - 1
+			== ((addr + len - 1) & m->usemask)))
+	{
+		return m->usebase + (addr & m->usemask);
 	} else {
-		dstvalue = ui5r_FromSWord(m68k_dreg(reg));
-		--dstvalue;
-		m68k_dreg(reg) = (m68k_dreg(reg) & ~ 0xffff)
-			| ((dstvalue) & 0xffff);
-		if ((si5b)dstvalue == -1) {
-#if WantCloserCyc
-			regs.MaxCyclesToGo -= (14 * kCycleScale + 3 * RdAvgXtraCyc);
-#endif
-		} else {
-#if WantCloserCyc
-			regs.MaxCyclesToGo -= (10 * kCycleScale + 2 * RdAvgXtraCyc);
-#endif
-#if FastRelativeJump
-			regs.pc_p = srcvalue;
-#else
-			m68k_setpc(srcvalue);
-#endif
-		}
+		return nullpr;
 	}
 }
 
-LOCALPROCUSEDONCE DoCodeSwap(void)
+LOCALFUNC ui5r DBFAccelGetMem(ui3p p, ui5r sz)
 {
-	/* Swap 0100100001000rrr */
-	ui5r srcreg = reg;
-	ui5r src = m68k_dreg(srcreg);
-	ui5r dst = ui5r_FromSLong(((src >> 16) & 0xFFFF)
-		| ((src & 0xFFFF) << 16));
-	VFLG = CFLG = 0;
-	ZFLG = (dst == 0);
-	NFLG = ui5r_MSBisSet(dst);
-	m68k_dreg(srcreg) = dst;
+	switch (sz) {
+		case 1:
+			return ui5r_FromSByte(do_get_vmem_byte(p));
+		case 2:
+			return ui5r_FromSWord(do_get_vmem_word(p));
+		case 4:
+		default:
+			return ui5r_FromSLong(do_get_vmem_long(p));
+	}
 }
 
-LOCALPROCUSEDONCE DoCodeMove(void)
+/*
+	Called after a DBF has decremented its counter and branched
+	back to looptop, which is the instruction just before it.
+*/
+LOCALPROC DBFLoopAccel(ui3p looptop)
 {
-	ArgAddrT SrcAddr = DecodeSrc();
-	ui5r src = GetSrcValue(SrcAddr);
-	ArgAddrT DstAddr = DecodeDst();
+	ui5r bodyop = do_get_vmem_word(looptop);
+	ui5r dstreg = ((bodyop >> 9) & 7) + 8;
+	ui5r srcreg;
+	ui5r sz;
+	ui5r v;
+	si5r BodyCycles;
+	si5r IterCycles;
+	ui5r n;
+	ui5r len;
+	ui3p pd;
+	ui3p ps = nullpr;
+
+	if (0x00D8 == (bodyop & 0xC1F8)) {
+		/* MOVE (Am)+,(An)+ */
+		srcreg = (bodyop & 7) + 8;
+		if (srcreg == dstreg) {
+			return;
+		}
+	} else if (0x00C0 == (bodyop & 0xC1F8)) {
+		/* MOVE Dm,(An)+ */
+		srcreg = bodyop & 7;
+		if (srcreg == reg) {
+			/* storing the loop counter */
+			return;
+		}
+	} else if (0x4218 == (bodyop & 0xFF38)) {
+		/* CLR (An)+ */
+		srcreg = 0;
+		dstreg = (bodyop & 7) + 8;
+	} else {
+		return;
+	}
 
-	VFLG = CFLG = 0;
-	ZFLG = (src == 0);
-	NFLG = ui5r_MSBisSet(src);
-	SetDstValue(DstAddr, src);
-}
+	if (0x4000 == (bodyop & 0xF000)) {
+		switch ((bodyop >> 6) & 3) {
+			case 0: sz = 1; break;
+			case 1: sz = 2; break;
+			case 2: sz = 4; break;
+			default: return;
+		}
+	} else {
+		switch ((bodyop >> 12) & 3) {
+			case 1: sz = 1; break;
+			case 3: sz = 2; break;
+			case 2: sz = 4; break;
+			default: return;
+		}
+	}
 
-LOCALPROC DoCodeMoveA(void) /* MOVE */
-{
-	ArgAddrT SrcAddr;
-	ui5r src;
+	if ((1 == sz) && ((15 == dstreg) || (15 == srcreg))) {
+		/* (A7)+ steps by 2 for bytes */
+		return;
+	}
 
-	SrcAddr = DecodeSrc();
-	src = GetSrcValue(SrcAddr);
-	m68k_areg(rg9) = src;
-}
+	/*
+		Each iteration costs what DecodeNextInstruction charges
+		for the body and the DBF, and an iteration is only run
+		if the cycles are not used up before the body and
+		before the DBF, just like the main loop. Stop short of
+		the final iteration, where the DBF falls through.
+	*/
+	BodyCycles = GetDcoCycles(&regs.disp_table[bodyop]);
+	IterCycles = BodyCycles + GetDcoCycles(&regs.CurDecOp)
+#if WantCloserCyc
+		+ (10 * kCycleScale + 2 * RdAvgXtraCyc)
+#endif
+		;
+	BcSettle();
+	if (regs.MaxCyclesToGo <= BodyCycles) {
+		return;
+	}
+	n = (regs.MaxCyclesToGo - BodyCycles - 1) / IterCycles + 1;
+	if (n > (m68k_dreg(reg) & 0xFFFF)) {
+		n = m68k_dreg(reg) & 0xFFFF;
+	}
+	if (0 == n) {
+		return;
+	}
+	len = n * sz;
 
-LOCALPROCUSEDONCE DoCodeMoveQ(void)
-{
-	/* MoveQ 0111ddd0nnnnnnnn */
-	ui5r src = ui5r_FromSByte(regs.opcode);
-	ui5r dstreg = rg9;
-	VFLG = CFLG = 0;
-	ZFLG = (src == 0);
-	NFLG = ui5r_MSBisSet(src);
+#if WantWordSwappedMem
+	if ((1 == sz) && (srcreg >= 8)
+		&& (0 != (1 & (regs.regs[dstreg] | regs.regs[srcreg] | len))))
+	{
+		/*
+			copying real bytes only gives the same result
+			for whole words of emulated memory.
+		*/
+		return;
+	}
+#endif
+
+	pd = DBFAccelMemPtr((1 == sz) ? &regs.MATCwrB : &regs.MATCwrW,
+		regs.regs[dstreg], len, sz);
+	if ((nullpr == pd)
+		|| ((pd < looptop + 6) && (looptop < pd + len)))
+	{
+		return;
+	}
+	DrWriteNtfy(pd, len);
+
+	if (srcreg >= 8) {
+		ps = DBFAccelMemPtr((1 == sz) ? &regs.MATCrdB : &regs.MATCrdW,
+			regs.regs[srcreg], len, sz);
+		if (nullpr == ps) {
+			return;
+		}
+		if ((pd > ps) && (pd < ps + len)) {
+			/*
+				Overlapping, destination ahead. Copying bytes
+				forward gives the same result as copying
+				elements forward only if the destination is at
+				least one element ahead.
+			*/
+			ui5r i;
+
+			if (pd < ps + sz) {
+				return;
+			}
+			for (i = 0; i < len; ++i) {
+				pd[i] = ps[i];
+			}
+			v = DBFAccelGetMem(ps + len - sz, sz);
+		} else {
+			v = DBFAccelGetMem(ps + len - sz, sz);
+			if ((pd < ps) && (pd + len > ps)) {
+				ui5r i;
+
+				for (i = 0; i < len; ++i) {
+					pd[i] = ps[i];
+				}
+			} else {
+				MyMoveBytes((anyp)ps, (anyp)pd, len);
+			}
+		}
+		regs.regs[srcreg] += len;
+	} else {
+		ui5r i;
+		ui3p p = pd;
+
+		v = (0 == (bodyop & 0xC000)) ? m68k_dreg(srcreg) : 0;
+		switch (sz) {
+			case 1:
+				v = ui5r_FromSByte(v);
+				for (i = 0; i < n; ++i) {
+					do_put_vmem_byte(p, v);
+					p += 1;
+				}
+				break;
+			case 2:
+				v = ui5r_FromSWord(v);
+				for (i = 0; i < n; ++i) {
+					do_put_vmem_word(p, v);
+					p += 2;
+				}
+				break;
+			case 4:
+			default:
+				v = ui5r_FromSLong(v);
+				for (i = 0; i < n; ++i) {
+					do_put_vmem_long(p, v);
+					p += 4;
+				}
+				break;
+		}
+	}
+#if EnableScreenDirtyRows
+	ScreenDirtyNtfy(pd, len);
+#endif
+#if WantBlockCache
+	m68k_MemWriteNtfy(pd, len);
+#endif
+	regs.regs[dstreg] += len;
+
+	SetCCRforLogic(v);
+	m68k_dreg(reg) = (m68k_dreg(reg) & ~ 0xffff)
+		| ((m68k_dreg(reg) - n) & 0xffff);
+	regs.MaxCyclesToGo -= n * IterCycles;
+#if WantInstrCount
+	regs.InstrCount += 2 * n;
+#endif
+#if WantDumpTable
+	DumpTable[GetDcoMainClas(&regs.disp_table[bodyop])] += n;
+	DumpTable[GetDcoMainClas(&regs.CurDecOp)] += n;
+#endif
+}
+#endif
+
+LOCALPROCUSEDONCE DoCodeDBcc(void)
+{
+	/* DBcc 0101cccc11001ddd */
+
+	ui5r dstvalue;
+#if FastRelativeJump
+	ui3p srcvalue = regs.pc_p;
+#else
+	ui5r srcvalue = m68k_getpc();
+#endif
+
+	si5r disp = (si4b)(ui4b)nextiword();
+
+	srcvalue += disp;
+	if (cctrue()) {
+#if WantCloserCyc
+		regs.MaxCyclesToGo -= (12 * kCycleScale + 2 * RdAvgXtraCyc);
+#endif
+	} else {
+		dstvalue = ui5r_FromSWord(m68k_dreg(reg));
+		--dstvalue;
+		m68k_dreg(reg) = (m68k_dreg(reg) & ~ 0xffff)
+			| ((dstvalue) & 0xffff);
+		if ((si5b)dstvalue == -1) {
+#if WantCloserCyc
+			regs.MaxCyclesToGo -= (14 * kCycleScale + 3 * RdAvgXtraCyc);
+#endif
+		} else {
+#if WantCloserCyc
+			regs.MaxCyclesToGo -= (10 * kCycleScale + 2 * RdAvgXtraCyc);
+#endif
+#if FastRelativeJump
+			m68k_setpc_p(srcvalue);
+#else
+			m68k_setpc(srcvalue);
+#endif
+#if WantDBFAccel
+			if ((0x51C8 == (regs.opcode & 0xFFF8)) && (-4 == disp)) {
+				DBFLoopAccel(srcvalue);
+			}
+#endif
+		}
+	}
+}
+
+LOCALPROCUSEDONCE DoCodeSwap(void)
+{
+	/* Swap 0100100001000rrr */
+	ui5r srcreg = reg;
+	ui5r src = m68k_dreg(srcreg);
+	ui5r dst = ui5r_FromSLong(((src >> 16) & 0xFFFF)
+		| ((src & 0xFFFF) << 16));
+	SetCCRforLogic(dst);
+	m68k_dreg(srcreg) = dst;
+}
+
+LOCALPROCUSEDONCE DoCodeMove(void)
+{
+	ArgAddrT SrcAddr = DecodeSrc();
+	ui5r src = GetSrcValue(SrcAddr);
+	ArgAddrT DstAddr = DecodeDst();
+
+	SetCCRforLogic(src);
+	SetDstValue(DstAddr, src);
+}
+
+LOCALPROC DoCodeMoveA(void) /* MOVE */
+{
+	ArgAddrT SrcAddr;
+	ui5r src;
+
+	SrcAddr = DecodeSrc();
+	src = GetSrcValue(SrcAddr);
+	m68k_areg(rg9) = src;
+}
+
+LOCALPROCUSEDONCE DoCodeMoveQ(void)
+{
+	/* MoveQ 0111ddd0nnnnnnnn */
+	ui5r src = ui5r_FromSByte(regs.opcode);
+	ui5r dstreg = rg9;
+	SetCCRforLogic(src);
 	m68k_dreg(dstreg) = src;
 }
 
+/*
+	MOVE and CMP with the addressing modes fixed at compile time,
+	for the forms that are executed most often. M68KITAB picks
+	these instead of the generic kinds when WantSpecializedOps.
+*/
+
+LOCALPROC AlwaysInline DoCodeMoveK(ui3r samd, ui3r sargk,
+	ui3r damd, ui3r dargk)
+{
+	ArgAddrT SrcAddr = DecodeAMd(regs.CurDecOp.B, samd);
+	ui5r src = GetArgkValue(sargk, SrcAddr);
+	ArgAddrT DstAddr = DecodeAMd(regs.CurDecOp.A, damd);
+
+	SetCCRforLogic(src);
+	SetArgkValue(dargk, DstAddr, src);
+}
+
+LOCALPROCUSEDONCE DoCodeMoveLRgRg(void)
+{
+	DoCodeMoveK(kAMdReg, kArgkRegL, kAMdReg, kArgkRegL);
+}
+
+LOCALPROCUSEDONCE DoCodeMoveLRgAPI(void)
+{
+	DoCodeMoveK(kAMdReg, kArgkRegL, kAMdAPosIncL, kArgkMemL);
+}
+
+LOCALPROCUSEDONCE DoCodeMoveLRgAPD(void)
+{
+	DoCodeMoveK(kAMdReg, kArgkRegL, kAMdAPreDecL, kArgkMemL);
+}
+
+LOCALPROCUSEDONCE DoCodeMoveLRgAD(void)
+{
+	DoCodeMoveK(kAMdReg, kArgkRegL, kAMdADisp, kArgkMemL);
+}
+
+LOCALPROCUSEDONCE DoCodeMoveLARg(void)
+{
+	DoCodeMoveK(kAMdIndirect, kArgkMemL, kAMdReg, kArgkRegL);
+}
+
+LOCALPROCUSEDONCE DoCodeMoveLAPIRg(void)
+{
+	DoCodeMoveK(kAMdAPosIncL, kArgkMemL, kAMdReg, kArgkRegL);
+}
+
+LOCALPROCUSEDONCE DoCodeMoveLADRg(void)
+{
+	DoCodeMoveK(kAMdADisp, kArgkMemL, kAMdReg, kArgkRegL);
+}
+
+LOCALPROCUSEDONCE DoCodeMoveWRgRg(void)
+{
+	DoCodeMoveK(kAMdReg, kArgkRegW, kAMdReg, kArgkRegW);
+}
+
+LOCALPROCUSEDONCE DoCodeMoveWARg(void)
+{
+	DoCodeMoveK(kAMdIndirect, kArgkMemW, kAMdReg, kArgkRegW);
+}
+
+LOCALPROCUSEDONCE DoCodeMoveWAPIRg(void)
+{
+	DoCodeMoveK(kAMdAPosIncW, kArgkMemW, kAMdReg, kArgkRegW);
+}
+
+LOCALPROCUSEDONCE DoCodeMoveWADRg(void)
+{
+	DoCodeMoveK(kAMdADisp, kArgkMemW, kAMdReg, kArgkRegW);
+}
+
+LOCALPROC AlwaysInline DoCodeCmpK(ui3r samd, ui3r sargk, ui3r dargk,
+	ui3r sz)
+{
+	ArgAddrT SrcAddr = DecodeAMd(regs.CurDecOp.B, samd);
+	ui5r srcvalue = GetArgkValue(sargk, SrcAddr);
+	ArgAddrT DstAddr = DecodeAMd(regs.CurDecOp.A, kAMdReg);
+	ui5r dstvalue = GetArgkValue(dargk, DstAddr);
+
+	switch (sz) {
+		case 1:
+			ALU_CmpB(srcvalue, dstvalue);
+			break;
+		case 2:
+			ALU_CmpW(srcvalue, dstvalue);
+			break;
+		case 4:
+		default:
+			ALU_CmpL(srcvalue, dstvalue);
+			break;
+	}
+}
+
+LOCALPROCUSEDONCE DoCodeCmpBImRg(void)
+{
+	DoCodeCmpK(kAMdImmedB, kArgkCnst, kArgkRegB, 1);
+}
+
+LOCALPROCUSEDONCE DoCodeCmpWImRg(void)
+{
+	DoCodeCmpK(kAMdImmedW, kArgkCnst, kArgkRegW, 2);
+}
+
+LOCALPROCUSEDONCE DoCodeCmpLImRg(void)
+{
+	DoCodeCmpK(kAMdImmedL, kArgkCnst, kArgkRegL, 4);
+}
+
+LOCALPROCUSEDONCE DoCodeCmpLRgRg(void)
+{
+	DoCodeCmpK(kAMdReg, kArgkRegL, kArgkRegL, 4);
+}
+
 LOCALPROCUSEDONCE DoCodeAddB(void)
 {
 	ui5r dstvalue = DecodeSrcDstGet();
@@ -1719,7 +2949,7 @@ LOCALPROCUSEDONCE DoCodeBsrB(void)
 	m68k_areg(7) -= 4;
 	put_long(m68k_areg(7), m68k_getpc());
 #if FastRelativeJump
-	regs.pc_p = s;
+	m68k_setpc_p(s);
 #else
 	m68k_setpc(s);
 #endif
@@ -1738,7 +2968,7 @@ LOCALPROCUSEDONCE DoCodeBsrW(void)
 	m68k_areg(7) -= 4;
 	put_long(m68k_areg(7), m68k_getpc());
 #if FastRelativeJump
-	regs.pc_p = s;
+	m68k_setpc_p(s);
 #else
 	m68k_setpc(s);
 #endif
@@ -1760,7 +2990,7 @@ LOCALPROCUSEDONCE DoCodeBsrL(void)
 	m68k_areg(7) -= 4;
 	put_long(m68k_areg(7), m68k_getpc());
 #if FastRelativeJump
-	regs.pc_p = s;
+	m68k_setpc_p(s);
 #else
 	m68k_setpc(s);
 #endif
@@ -1879,6 +3109,13 @@ LOCALPROCUSEDONCE DoCodeAddA(void)
 	SetDstArgValue(dstvalue);
 }
 
+LOCALPROCUSEDONCE DoCodeAddQA(void)
+{
+	/* AddQA 0101nnn0ss001rrr */
+	regs.regs[GetDcoDstArgDat(&regs.CurDecOp)] +=
+		GetDcoSrcArgDat(&regs.CurDecOp);
+}
+
 LOCALPROCUSEDONCE DoCodeSubA(void)
 {
 	ui5r dstvalue = DecodeSrcDstGet();
@@ -1887,6 +3124,13 @@ LOCALPROCUSEDONCE DoCodeSubA(void)
 	SetDstArgValue(dstvalue);
 }
 
+LOCALPROCUSEDONCE DoCodeSubQA(void)
+{
+	/* SubQA 0101nnn1ss001rrr */
+	regs.regs[GetDcoDstArgDat(&regs.CurDecOp)] -=
+		GetDcoSrcArgDat(&regs.CurDecOp);
+}
+
 LOCALPROCUSEDONCE DoCodeCmpA(void)
 {
 	ui5r dstvalue = DecodeSrcDstGet();
@@ -2449,9 +3693,7 @@ LOCALPROCUSEDONCE DoCodeAnd(void)
 			don't need to extend, since excess high
 			bits all the same as desired high bit.
 		*/
-	VFLG = CFLG = 0;
-	ZFLG = (dstvalue == 0);
-	NFLG = ui5r_MSBisSet(dstvalue);
+	SetCCRforLogic(dstvalue);
 
 	SetDstArgValue(dstvalue);
 }
@@ -2466,9 +3708,7 @@ LOCALPROCUSEDONCE DoCodeOr(void)
 			don't need to extend, since excess high
 			bits all the same as desired high bit.
 		*/
-	VFLG = CFLG = 0;
-	ZFLG = (dstvalue == 0);
-	NFLG = ui5r_MSBisSet(dstvalue);
+	SetCCRforLogic(dstvalue);
 
 	SetDstArgValue(dstvalue);
 }
@@ -2484,9 +3724,7 @@ LOCALPROCUSEDONCE DoCodeEor(void)
 			don't need to extend, since excess high
 			bits all the same as desired high bit.
 		*/
-	VFLG = CFLG = 0;
-	ZFLG = (dstvalue == 0);
-	NFLG = ui5r_MSBisSet(dstvalue);
+	SetCCRforLogic(dstvalue);
 
 	SetDstArgValue(dstvalue);
 }
@@ -2497,9 +3735,7 @@ LOCALPROCUSEDONCE DoCodeNot(void)
 	ui5r dstvalue = DecodeDstGet();
 
 	dstvalue = ~ dstvalue;
-	ZFLG = (dstvalue == 0);
-	NFLG = ui5r_MSBisSet(dstvalue);
-	VFLG = CFLG = 0;
+	SetCCRforLogic(dstvalue);
 
 	SetDstArgValue(dstvalue);
 }
@@ -2527,9 +3763,7 @@ LOCALPROCUSEDONCE DoCodeEXTL(void)
 	ui5r srcreg = reg;
 	ui5r src = m68k_dreg(srcreg);
 	ui5r dst = ui5r_FromSWord(src);
-	VFLG = CFLG = 0;
-	ZFLG = (dst == 0);
-	NFLG = ui5r_MSBisSet(dst);
+	SetCCRforLogic(dst);
 	m68k_dreg(srcreg) = dst;
 }
 
@@ -2539,9 +3773,7 @@ LOCALPROCUSEDONCE DoCodeEXTW(void)
 	ui5r srcreg = reg;
 	ui5r src = m68k_dreg(srcreg);
 	ui5r dst = ui5r_FromSByte(src);
-	VFLG = CFLG = 0;
-	ZFLG = (dst == 0);
-	NFLG = ui5r_MSBisSet(dst);
+	SetCCRforLogic(dst);
 	m68k_dreg(srcreg) = (m68k_dreg(srcreg) & ~ 0xffff) | (dst & 0xffff);
 }
 
@@ -2604,9 +3836,7 @@ LOCALPROCUSEDONCE DoCodeMulU(void)
 		}
 	}
 #endif
-	VFLG = CFLG = 0;
-	ZFLG = (dstvalue == 0);
-	NFLG = ui5r_MSBisSet(dstvalue);
+	SetCCRforLogic(dstvalue);
 	regs.regs[rg9] = dstvalue;
 }
 
@@ -2633,9 +3863,7 @@ LOCALPROCUSEDONCE DoCodeMulS(void)
 		}
 	}
 #endif
-	VFLG = CFLG = 0;
-	ZFLG = (dstvalue == 0);
-	NFLG = ui5r_MSBisSet(dstvalue);
+	SetCCRforLogic(dstvalue);
 	regs.regs[rg9] = dstvalue;
 }
 
@@ -3347,9 +4575,7 @@ LOCALPROCUSEDONCE DoCodeTas(void)
 	dstvalue = GetArgValue();
 
 	{
-		ZFLG = (dstvalue == 0);
-		NFLG = ui5r_MSBisSet(dstvalue);
-		VFLG = CFLG = 0;
+		SetCCRforLogic(dstvalue);
 		dstvalue |= 0x80;
 	}
 	SetArgValue(dstvalue);
@@ -3444,8 +4670,17 @@ LOCALPROCUSEDONCE DoCodeCallMorRtm(void)
 
 LOCALPROC m68k_setstopped(void)
 {
+#if WantIdleSkip
+	/*
+		m68k_go_nCycles idles until an exception,
+		normally an interrupt.
+	*/
+	regs.stopped = trueblnr;
+	NeedToGetOut();
+#else
 	/* not implemented. doesn't seemed to be used on Mac Plus */
 	Exception(4); /* fake an illegal instruction */
+#endif
 }
 
 LOCALPROCUSEDONCE DoCodeStop(void)
@@ -3465,6 +4700,7 @@ LOCALPROCUSEDONCE DoCodeReset(void)
 	if (! regs.s) {
 		DoPrivilegeViolation();
 	} else {
+		DrDeviceNtfy();
 		customreset();
 	}
 }
@@ -3476,9 +4712,7 @@ LOCALPROCUSEDONCE DoCodeEXTBL(void)
 	ui5r srcreg = reg;
 	ui5r src = m68k_dreg(srcreg);
 	ui5r dst = ui5r_FromSByte(src);
-	VFLG = CFLG = 0;
-	ZFLG = (dst == 0);
-	NFLG = ui5r_MSBisSet(dst);
+	SetCCRforLogic(dst);
 	m68k_dreg(srcreg) = dst;
 }
 #endif
@@ -4444,8 +5678,6 @@ LOCALPROC DoBitField(void)
 #endif
 
 #if WantDumpTable
-LOCALVAR ui5b DumpTable[kNumIKinds];
-
 LOCALPROC InitDumpTable(void)
 {
 	si5b i;
@@ -4472,453 +5704,1200 @@ GLOBALPROC DoDumpTable(void)
 }
 #endif
 
-LOCALPROC m68k_go_MaxCycles(void)
+LOCALFUNC MayInline void FetchNextInstruction(void)
 {
-	/*
-		Main loop of emulator.
-
-		Always execute at least one instruction,
-		even if regs.MaxInstructionsToGo == 0.
-		Needed for trace flag to work.
-	*/
+#if WantDisasm
+	DisasmOneOrSave(m68k_getpc());
+#endif
 
-	do {
+	regs.opcode = nextiword();
+}
 
-#if WantDisasm
-		DisasmOneOrSave(m68k_getpc());
+LOCALFUNC MayInline void DecodeFetchedInstruction(void)
+{
+	regs.CurDecOp = regs.disp_table[regs.opcode];
+#if WantDumpTable
+	DumpTable[GetDcoMainClas(&regs.CurDecOp)] ++;
 #endif
+#if WantInstrCount
+	regs.InstrCount++;
+#endif
+	regs.MaxCyclesToGo -= GetDcoCycles(&regs.CurDecOp);
+}
+
+LOCALFUNC MayInline void DecodeNextInstruction(void)
+{
+	FetchNextInstruction();
+	DecodeFetchedInstruction();
+}
+
+#if WantBlockCache
+
+LOCALFUNC ui5b *BcPageGenP(ui3p p)
+{
+	uimr BcOffset = (uimr)p - (uimr)RAM;
+
+	if (BcOffset < kRAM_Size) {
+		return &BcPageGen[BcOffset >> ln2BcPageSz];
+	} else if ((uimr)p - (uimr)ROM < kROM_Size) {
+		return &BcROMGen[0];
+	} else {
+		return nullpr;
+	}
+}
 
-		regs.opcode = nextiword();
+#define BcValid(b) \
+	((*(b)->GenP == (b)->Gen) && ((b)->GenP[1] == (b)->Gen2))
 
-		regs.CurDecOp = regs.disp_table[regs.opcode];
+LOCALFUNC MayInline void *BcFetch(BcInstr *p)
+{
+	/* FetchNextInstruction and DecodeFetchedInstruction, from p */
+	regs.BcNext = p + 1;
+	regs.CurDecOp = p->DecOp;
+	regs.opcode = p->opcode;
+	regs.BcExtP = p->Ext;
+	regs.pc_p += 2;
 #if WantDumpTable
-		DumpTable[GetDcoMainClas(&regs.CurDecOp)] ++;
+	DumpTable[GetDcoMainClas(&regs.CurDecOp)] ++;
 #endif
-		regs.MaxCyclesToGo -= GetDcoCycles(&regs.CurDecOp);
+#if WantInstrCount
+	regs.InstrCount++;
+#endif
+	return p->Handler;
+}
 
-		switch (GetDcoMainClas(&regs.CurDecOp)) {
-			case kIKindTst :
-				DoCodeTst();
-				break;
-			case kIKindCmpB :
-				DoCodeCmpB();
-				break;
-			case kIKindCmpW :
-				DoCodeCmpW();
-				break;
-			case kIKindCmpL :
-				DoCodeCmpL();
-				break;
-			case kIKindBccB :
-				DoCodeBccB();
-				break;
-			case kIKindBccW :
-				DoCodeBccW();
-				break;
+LOCALPROC BcRecordEnd(void)
+{
+	BcBlock *b = BcRec;
+	si5r Limit = 0;
+	ui5r i = b->n;
+
+	if (0 == i) {
+		BcStart[b - BcBlocks] = nullpr;
+	} else {
+		b->Instr[i].pc_p = nullpr;
+		b->Instr[i].Limit = 0;
+		do {
+			--i;
+			Limit -= GetDcoCycles(&b->Instr[i].DecOp);
+			b->Instr[i].Limit = Limit;
+		} while (0 != i);
+	}
+	BcRec = nullpr;
+	BcRecExtP = nullpr;
+}
+
+LOCALPROC BcRecordNext(void)
+{
+	/* the instruction last recorded is done, continue or end */
+	BcBlock *b = BcRec;
+
+	if (! BcRecBad) {
+		++b->n;
+	}
+	if (! BcValid(b)) {
+		/* it wrote to its own code */
+		b->n = 0;
+		BcRecordEnd();
+	} else if (BcRecBad || (b->n >= kBcMaxInstrs)
+		|| (BcPageGenP(regs.pc_p) != b->GenP))
+	{
+		BcRecordEnd();
+	}
+}
+
+LOCALPROC BcRecordStart(BcBlock *b, ui5b *GenP)
+{
+	BcStart[b - BcBlocks] = regs.pc_p;
+	b->GenP = GenP;
+	b->Gen = GenP[0];
+	b->Gen2 = GenP[1];
+	b->n = 0;
+	if (b == BcCurB) {
+		BcResume = &BcIdle;
+	}
+	BcRec = b;
+}
+
+/*
+	Where the next instruction isn't the record expected, or the
+	cycles run out: settle the cycles charged ahead, then resume
+	the block left, enter the block cached for the pc, or decode
+	the instruction the usual way, recording it if a block is
+	being recorded. Returns the handler to go to, or nullpr to
+	leave the main loop, which Force prevents.
+*/
+LOCALFUNC MayNotInline void *BcMiss(void * const *DispatchTab,
+	blnr Force)
+{
+	BcInstr *p;
+	BcBlock *b;
+	ui5b *GenP;
+	void *Handler;
+	uimr i;
+
+	BcSettle();
+	regs.BcExtP = nullpr;
+	if (nullpr != BcRec) {
+		BcRecordNext();
+	}
+	if ((regs.MaxCyclesToGo <= 0) && ! Force) {
+		if (nullpr != BcRec) {
+			BcRecordEnd();
+		}
+		return nullpr;
+	}
+
+	if (nullpr == BcRec) {
+		p = BcResume;
+		if ((p->pc_p == regs.pc_p) && BcValid(BcCurB)) {
+			regs.MaxCyclesToGo += p->Limit;
+			return BcFetch(p);
+		}
+
+		i = (((uimr)regs.pc_p >> 1)
+			^ ((uimr)regs.pc_p >> (1 + ln2BcNumBlocks)))
+			& (kBcNumBlocks - 1);
+		b = &BcBlocks[i];
+		if (BcStart[i] == regs.pc_p) {
+			if (BcValid(b)) {
+				BcCurB = b;
+				regs.BcGenP = b->GenP;
+				regs.MaxCyclesToGo += b->Instr[0].Limit;
+				return BcFetch(&b->Instr[0]);
+			}
+			if (b == BcCurB) {
+				BcResume = &BcIdle;
+			}
+			BcStart[i] = nullpr;
+		}
+		if (BcSeen[i] != regs.pc_p) {
+			BcSeen[i] = regs.pc_p;
+		} else if (nullpr != (GenP = BcPageGenP(regs.pc_p))) {
+			BcRecordStart(b, GenP);
+		}
+	}
+
+	p = (nullpr == BcRec) ? nullpr : &BcRec->Instr[BcRec->n];
+	if (nullpr != p) {
+		p->pc_p = regs.pc_p;
+	}
+	DecodeNextInstruction();
+	Handler = DispatchTab[GetDcoMainClas(&regs.CurDecOp)];
+	if (nullpr != p) {
+		p->DecOp = regs.CurDecOp;
+		p->opcode = regs.opcode;
+		p->Handler = Handler;
+		BcRecExtP = p->Ext;
+		BcRecExtEnd = p->Ext + kBcMaxExt;
+		BcRecBad = falseblnr;
+	}
+	return Handler;
+}
+
+LOCALPROC BcFlush(void)
+{
+	int i;
+
+	for (i = 0; i < kBcNumBlocks; ++i) {
+		BcStart[i] = nullpr;
+		BcSeen[i] = nullpr;
+	}
+	regs.BcNext = &BcIdle;
+	regs.BcExtP = nullpr;
+	regs.BcGenP = nullpr;
+	BcResume = &BcIdle;
+	BcRec = nullpr;
+	BcRecExtP = nullpr;
+}
+
+GLOBALPROC m68k_MemWriteNtfy(ui3p p, ui5r L)
+{
+	/* for writes to RAM that don't go through put_byte and so on */
+	uimr BcOffset = (uimr)p - (uimr)RAM;
+	uimr BcEnd;
+
+	if ((0 != L) && (BcOffset < kRAM_Size)) {
+		BcEnd = BcOffset + L - 1;
+		if (BcEnd >= kRAM_Size) {
+			BcEnd = kRAM_Size - 1;
+		}
+		BcOffset >>= ln2BcPageSz;
+		BcEnd >>= ln2BcPageSz;
+		if ((uimr)regs.BcGenP + sizeof(ui5b)
+			- (uimr)&BcPageGen[BcOffset]
+			<= (BcEnd - BcOffset + 1) * sizeof(ui5b))
+		{
+			/* the running block may have changed */
+			BcSettle();
+		}
+		for (; BcOffset <= BcEnd; ++BcOffset) {
+			++BcPageGen[BcOffset];
+		}
+	}
+}
+
+#endif
+
+#if WantThreadedDispatch
+
+/*
+	Threaded code dispatch, using the gcc "labels as values"
+	extension. Instead of every instruction going back through
+	the single indirect branch of the switch, each handler
+	decodes the next instruction and jumps to its handler
+	itself, so the host branch predictor gets one indirect
+	branch per handler to learn from. The cycle accounting
+	is the same as for the switch, it is all done in
+	DecodeNextInstruction.
+*/
+
+#define DispatchCase(k) Label_##k
+#if WantBlockCache
+#define DispatchBreak \
+	{ \
+		BcInstr *BcP = regs.BcNext; \
+		if ((BcP->pc_p == regs.pc_p) \
+			&& (regs.MaxCyclesToGo > BcP->Limit)) \
+		{ \
+			goto *BcFetch(BcP); \
+		} \
+	} \
+	if (nullpr != (BcHandler = BcMiss(DispatchTab, falseblnr))) { \
+		goto *BcHandler; \
+	} \
+	break
+#else
+#define DispatchBreak \
+	if (regs.MaxCyclesToGo > 0) { \
+		DecodeNextInstruction(); \
+		goto *DispatchTab[GetDcoMainClas(&regs.CurDecOp)]; \
+	} \
+	break
+#endif
+
+#if WantFusedOps
+/*
+	Instruction fusion. Some instructions are nearly always
+	followed by the same few others (TST or CMP by a Bcc,
+	LINK by MOVEM, MOVEM by UNLK, UNLK by RTS). FuseTailOf
+	lists these pairs. At the end of a head instruction,
+	DispatchNext goes to the code for its tail, which fetches
+	the next opcode and compares it with the expected one.
+	If it matches, the tail is run without looking it up in
+	disp_table or going through DispatchTab, and is charged
+	the cycles FuseSetup looked up for it beforehand. A Bcc
+	after a TST tests its condition straight from the value
+	tested, without working out the flags. The cycle check
+	is the same as in DispatchBreak, so timing and flags are
+	exactly as if the instructions ran separately.
+*/
+
+enum {
+	kFuseNone,
+	kFuseBccAfterTst,
+	kFuseBccAfterCmp,
+	kFuseMOVEMAfterLink,
+	kFuseUnlkAfterMOVEM,
+	kFuseRtsAfterUnlk,
+
+	kNumFuse
+};
+
+/*
+	The tail expected after each head kind, kFuseNone for
+	most. Only read with constant indexes, so a head's check
+	is compiled in or left out.
+*/
+LOCALVAR const ui3b FuseTailOf[kNumIKinds] = {
+	[kIKindTst] = kFuseBccAfterTst,
+	[kIKindCmpB] = kFuseBccAfterCmp,
+	[kIKindCmpW] = kFuseBccAfterCmp,
+	[kIKindCmpL] = kFuseBccAfterCmp,
+	[kIKindCmpA] = kFuseBccAfterCmp,
+	[kIKindCmpBImRg] = kFuseBccAfterCmp,
+	[kIKindCmpWImRg] = kFuseBccAfterCmp,
+	[kIKindCmpLImRg] = kFuseBccAfterCmp,
+	[kIKindCmpLRgRg] = kFuseBccAfterCmp,
+	[kIKindLinkA6] = kFuseMOVEMAfterLink,
+	[kIKindMOVEMApRL] = kFuseUnlkAfterMOVEM,
+	[kIKindUnlkA6] = kFuseRtsAfterUnlk
+};
+
+/*
+	The tails, besides Bcc with a condition other than T or
+	F (BRA and BSR) and a displacement other than -1.
+*/
+#define kFuseOpMOVEMRmMLSP 0x48E7 /* MOVEM.L regs, -(A7) */
+#define kFuseOpUnlkA6 0x4E5E
+#define kFuseOpRts 0x4E75
+
+#define FuseIsBcc(op) ((0x6000 == ((op) & 0xF000)) \
+	&& (0 != ((op) & 0x0E00)) && (0xFF != ((op) & 0xFF)))
+
+LOCALVAR si5r FuseBccBCycles;
+LOCALVAR si5r FuseBccWCycles;
+LOCALVAR si5r FuseMOVEMCycles;
+LOCALVAR si5r FuseUnlkCycles;
+LOCALVAR si5r FuseRtsCycles;
+
+LOCALPROC FuseSetup(void)
+{
+	/* called whenever disp_table is filled in */
+	FuseBccBCycles = GetDcoCycles(&regs.disp_table[0x6602]);
+	FuseBccWCycles = GetDcoCycles(&regs.disp_table[0x6600]);
+	FuseMOVEMCycles = GetDcoCycles(&regs.disp_table[kFuseOpMOVEMRmMLSP]);
+	FuseUnlkCycles = GetDcoCycles(&regs.disp_table[kFuseOpUnlkA6]);
+	FuseRtsCycles = GetDcoCycles(&regs.disp_table[kFuseOpRts]);
+
+#if ExtraAbnormalReports
+	{
+		ui5r op;
+
+		for (op = 0x6000; op <= 0x6FFF; ++op) {
+			if (FuseIsBcc(op)) {
+				DecOpR *p = &regs.disp_table[op];
+
+				if ((GetDcoMainClas(p) != ((0 != (op & 0xFF))
+						? kIKindBccB : kIKindBccW))
+					|| (GetDcoCycles(p) != ((0 != (op & 0xFF))
+						? FuseBccBCycles : FuseBccWCycles)))
+				{
+					ReportAbnormal("fused Bcc differs");
+				}
+			}
+		}
+		if ((GetDcoMainClas(&regs.disp_table[kFuseOpMOVEMRmMLSP])
+				!= kIKindMOVEMRmML)
+			|| (GetDcoMainClas(&regs.disp_table[kFuseOpUnlkA6])
+				!= kIKindUnlkA6)
+			|| (GetDcoMainClas(&regs.disp_table[kFuseOpRts])
+				!= kIKindRts))
+		{
+			ReportAbnormal("fused tail differs");
+		}
+	}
+#endif
+}
+
+#if WantFuseCounts && dbglog_HAVE
+LOCALVAR ui5r FuseHits[kNumFuse];
+
+LOCALVAR char *FuseNames[kNumFuse] = {
+	"",
+	"fused TST Bcc",
+	"fused CMP Bcc",
+	"fused LINK MOVEM",
+	"fused MOVEM UNLK",
+	"fused UNLK RTS"
+};
+
+GLOBALPROC m68k_LogFuseCounts(void)
+{
+	int i;
+
+	for (i = kFuseNone + 1; i < kNumFuse; ++i) {
+		dbglog_writelnNum(FuseNames[i], FuseHits[i]);
+		FuseHits[i] = 0;
+	}
+}
+
+#define FuseHitNtfy(f) (++FuseHits[f])
+#else
+#define FuseHitNtfy(f)
+#endif
+
+LOCALFUNC MayInline void FuseCharge(ui3r f, ui3r k, si5r cycles)
+{
+	/* DecodeFetchedInstruction, for a fused tail of kind k */
+	UnusedParam(f);
+	UnusedParam(k);
+	FuseHitNtfy(f);
+#if WantDumpTable
+	DumpTable[k] ++;
+#endif
+#if WantInstrCount
+	regs.InstrCount++;
+#endif
+	regs.MaxCyclesToGo -= cycles;
+}
+
+#if WantLazyFlags
+LOCALFUNC MayInline blnr cctrueLogic(ui5r v)
+{
+	/*
+		cctrue for the flags SetCCRforLogic(v) sets,
+		with V and C clear.
+	*/
+	int cc = (regs.opcode >> 8) & 15;
+
+	return (cctrue_tab[cc] >> ((ui5r_MSBisSet(v) ? 8 : 0)
+		| ((0 == v) ? 4 : 0))) & 1;
+}
+
+#define cctrueAfterTst() cctrueLogic(regs.LazyDst)
+#else
+#define cctrueAfterTst() cctrue()
+#endif
+
+#define DispatchNext(k) \
+	if (regs.MaxCyclesToGo > 0) { \
+		switch (FuseTailOf[k]) { \
+			case kFuseBccAfterTst: goto Fuse_BccAfterTst; \
+			case kFuseBccAfterCmp: goto Fuse_BccAfterCmp; \
+			case kFuseMOVEMAfterLink: goto Fuse_MOVEMAfterLink; \
+			case kFuseUnlkAfterMOVEM: goto Fuse_UnlkAfterMOVEM; \
+			case kFuseRtsAfterUnlk: goto Fuse_RtsAfterUnlk; \
+			default: break; \
+		} \
+		DecodeNextInstruction(); \
+		goto *DispatchTab[GetDcoMainClas(&regs.CurDecOp)]; \
+	} \
+	break
+
+#define DispatchFetched \
+	DecodeFetchedInstruction(); \
+	goto *DispatchTab[GetDcoMainClas(&regs.CurDecOp)]
+#else
+#define DispatchNext(k) DispatchBreak
+#endif
+
+#else
+
+#define DispatchCase(k) case k
+#define DispatchBreak break
+#define DispatchNext(k) DispatchBreak
+
+#endif
+
+LOCALPROC m68k_go_MaxCycles(void)
+{
+	/*
+		Main loop of emulator.
+
+		Always execute at least one instruction,
+		even if regs.MaxInstructionsToGo == 0.
+		Needed for trace flag to work.
+	*/
+
+#if WantThreadedDispatch
+	/*
+		Indexed by kind rather than listed in order, so adding
+		or reordering kinds in M68KITAB.h can't shift entries.
+	*/
+	static void * const DispatchTab[kNumIKinds] = {
+		[kIKindTst] = &&Label_kIKindTst,
+		[kIKindCmpB] = &&Label_kIKindCmpB,
+		[kIKindCmpW] = &&Label_kIKindCmpW,
+		[kIKindCmpL] = &&Label_kIKindCmpL,
+		[kIKindBccB] = &&Label_kIKindBccB,
+		[kIKindBccW] = &&Label_kIKindBccW,
+		[kIKindBraB] = &&Label_kIKindBraB,
+		[kIKindBraW] = &&Label_kIKindBraW,
+		[kIKindDBcc] = &&Label_kIKindDBcc,
+		[kIKindDBF] = &&Label_kIKindDBF,
+		[kIKindSwap] = &&Label_kIKindSwap,
+		[kIKindMoveL] = &&Label_kIKindMoveL,
+		[kIKindMoveW] = &&Label_kIKindMoveW,
+		[kIKindMoveB] = &&Label_kIKindMoveB,
+		[kIKindMoveAL] = &&Label_kIKindMoveAL,
+		[kIKindMoveAW] = &&Label_kIKindMoveAW,
+		[kIKindMoveQ] = &&Label_kIKindMoveQ,
+		[kIKindAddB] = &&Label_kIKindAddB,
+		[kIKindAddW] = &&Label_kIKindAddW,
+		[kIKindAddL] = &&Label_kIKindAddL,
+		[kIKindSubB] = &&Label_kIKindSubB,
+		[kIKindSubW] = &&Label_kIKindSubW,
+		[kIKindSubL] = &&Label_kIKindSubL,
+		[kIKindLea] = &&Label_kIKindLea,
+		[kIKindPEA] = &&Label_kIKindPEA,
+		[kIKindA] = &&Label_kIKindA,
+		[kIKindBsrB] = &&Label_kIKindBsrB,
+		[kIKindBsrW] = &&Label_kIKindBsrW,
+		[kIKindJsr] = &&Label_kIKindJsr,
+		[kIKindLinkA6] = &&Label_kIKindLinkA6,
+		[kIKindMOVEMRmML] = &&Label_kIKindMOVEMRmML,
+		[kIKindMOVEMApRL] = &&Label_kIKindMOVEMApRL,
+		[kIKindUnlkA6] = &&Label_kIKindUnlkA6,
+		[kIKindRts] = &&Label_kIKindRts,
+		[kIKindJmp] = &&Label_kIKindJmp,
+		[kIKindClr] = &&Label_kIKindClr,
+		[kIKindAddA] = &&Label_kIKindAddA,
+		[kIKindAddQA] = &&Label_kIKindAddQA,
+		[kIKindSubA] = &&Label_kIKindSubA,
+		[kIKindSubQA] = &&Label_kIKindSubQA,
+		[kIKindCmpA] = &&Label_kIKindCmpA,
+		[kIKindAddXB] = &&Label_kIKindAddXB,
+		[kIKindAddXW] = &&Label_kIKindAddXW,
+		[kIKindAddXL] = &&Label_kIKindAddXL,
+		[kIKindSubXB] = &&Label_kIKindSubXB,
+		[kIKindSubXW] = &&Label_kIKindSubXW,
+		[kIKindSubXL] = &&Label_kIKindSubXL,
+		[kIKindRolopNM] = &&Label_kIKindRolopNM,
+		[kIKindRolopND] = &&Label_kIKindRolopND,
+		[kIKindRolopDD] = &&Label_kIKindRolopDD,
+		[kIKindBitOpDD] = &&Label_kIKindBitOpDD,
+		[kIKindBitOpDM] = &&Label_kIKindBitOpDM,
+		[kIKindBitOpND] = &&Label_kIKindBitOpND,
+		[kIKindBitOpNM] = &&Label_kIKindBitOpNM,
+		[kIKindAndI] = &&Label_kIKindAndI,
+		[kIKindAndEaD] = &&Label_kIKindAndEaD,
+		[kIKindAndDEa] = &&Label_kIKindAndDEa,
+		[kIKindOrI] = &&Label_kIKindOrI,
+		[kIKindOrDEa] = &&Label_kIKindOrDEa,
+		[kIKindOrEaD] = &&Label_kIKindOrEaD,
+		[kIKindEor] = &&Label_kIKindEor,
+		[kIKindEorI] = &&Label_kIKindEorI,
+		[kIKindNot] = &&Label_kIKindNot,
+		[kIKindScc] = &&Label_kIKindScc,
+		[kIKindNegXB] = &&Label_kIKindNegXB,
+		[kIKindNegXW] = &&Label_kIKindNegXW,
+		[kIKindNegXL] = &&Label_kIKindNegXL,
+		[kIKindNegB] = &&Label_kIKindNegB,
+		[kIKindNegW] = &&Label_kIKindNegW,
+		[kIKindNegL] = &&Label_kIKindNegL,
+		[kIKindEXTW] = &&Label_kIKindEXTW,
+		[kIKindEXTL] = &&Label_kIKindEXTL,
+		[kIKindMulU] = &&Label_kIKindMulU,
+		[kIKindMulS] = &&Label_kIKindMulS,
+		[kIKindDivU] = &&Label_kIKindDivU,
+		[kIKindDivS] = &&Label_kIKindDivS,
+		[kIKindExgdd] = &&Label_kIKindExgdd,
+		[kIKindExgaa] = &&Label_kIKindExgaa,
+		[kIKindExgda] = &&Label_kIKindExgda,
+		[kIKindMoveCCREa] = &&Label_kIKindMoveCCREa,
+		[kIKindMoveEaCCR] = &&Label_kIKindMoveEaCCR,
+		[kIKindMoveSREa] = &&Label_kIKindMoveSREa,
+		[kIKindMoveEaSR] = &&Label_kIKindMoveEaSR,
+		[kIKindBinOpStatusCCR] = &&Label_kIKindBinOpStatusCCR,
+		[kIKindMOVEMApRW] = &&Label_kIKindMOVEMApRW,
+		[kIKindMOVEMRmMW] = &&Label_kIKindMOVEMRmMW,
+		[kIKindMOVEMrm] = &&Label_kIKindMOVEMrm,
+		[kIKindMOVEMmr] = &&Label_kIKindMOVEMmr,
+		[kIKindAbcdr] = &&Label_kIKindAbcdr,
+		[kIKindAbcdm] = &&Label_kIKindAbcdm,
+		[kIKindSbcdr] = &&Label_kIKindSbcdr,
+		[kIKindSbcdm] = &&Label_kIKindSbcdm,
+		[kIKindNbcd] = &&Label_kIKindNbcd,
+		[kIKindRte] = &&Label_kIKindRte,
+		[kIKindNop] = &&Label_kIKindNop,
+		[kIKindMoveP] = &&Label_kIKindMoveP,
+		[kIKindIllegal] = &&Label_kIKindIllegal,
+		[kIKindChkW] = &&Label_kIKindChkW,
+		[kIKindTrap] = &&Label_kIKindTrap,
+		[kIKindTrapV] = &&Label_kIKindTrapV,
+		[kIKindRtr] = &&Label_kIKindRtr,
+		[kIKindLink] = &&Label_kIKindLink,
+		[kIKindUnlk] = &&Label_kIKindUnlk,
+		[kIKindMoveRUSP] = &&Label_kIKindMoveRUSP,
+		[kIKindMoveUSPR] = &&Label_kIKindMoveUSPR,
+		[kIKindTas] = &&Label_kIKindTas,
+		[kIKindF] = &&Label_kIKindF,
+		[kIKindCallMorRtm] = &&Label_kIKindCallMorRtm,
+		[kIKindStop] = &&Label_kIKindStop,
+		[kIKindReset] = &&Label_kIKindReset,
+		[kIKindMoveLRgRg] = &&Label_kIKindMoveLRgRg,
+		[kIKindMoveLRgAPI] = &&Label_kIKindMoveLRgAPI,
+		[kIKindMoveLRgAPD] = &&Label_kIKindMoveLRgAPD,
+		[kIKindMoveLRgAD] = &&Label_kIKindMoveLRgAD,
+		[kIKindMoveLARg] = &&Label_kIKindMoveLARg,
+		[kIKindMoveLAPIRg] = &&Label_kIKindMoveLAPIRg,
+		[kIKindMoveLADRg] = &&Label_kIKindMoveLADRg,
+		[kIKindMoveWRgRg] = &&Label_kIKindMoveWRgRg,
+		[kIKindMoveWARg] = &&Label_kIKindMoveWARg,
+		[kIKindMoveWAPIRg] = &&Label_kIKindMoveWAPIRg,
+		[kIKindMoveWADRg] = &&Label_kIKindMoveWADRg,
+		[kIKindCmpBImRg] = &&Label_kIKindCmpBImRg,
+		[kIKindCmpWImRg] = &&Label_kIKindCmpWImRg,
+		[kIKindCmpLImRg] = &&Label_kIKindCmpLImRg,
+		[kIKindCmpLRgRg] = &&Label_kIKindCmpLRgRg,
 #if Use68020
-			case kIKindBccL :
+		[kIKindBraL] = &&Label_kIKindBraL,
+		[kIKindBccL] = &&Label_kIKindBccL,
+		[kIKindBsrL] = &&Label_kIKindBsrL,
+		[kIKindEXTBL] = &&Label_kIKindEXTBL,
+		[kIKindTRAPcc] = &&Label_kIKindTRAPcc,
+		[kIKindChkL] = &&Label_kIKindChkL,
+		[kIKindBkpt] = &&Label_kIKindBkpt,
+		[kIKindDivL] = &&Label_kIKindDivL,
+		[kIKindMulL] = &&Label_kIKindMulL,
+		[kIKindRtd] = &&Label_kIKindRtd,
+		[kIKindMoveC] = &&Label_kIKindMoveC,
+		[kIKindLinkL] = &&Label_kIKindLinkL,
+		[kIKindPack] = &&Label_kIKindPack,
+		[kIKindUnpk] = &&Label_kIKindUnpk,
+		[kIKindCHK2orCMP2] = &&Label_kIKindCHK2orCMP2,
+		[kIKindCAS2] = &&Label_kIKindCAS2,
+		[kIKindCAS] = &&Label_kIKindCAS,
+		[kIKindMoveS] = &&Label_kIKindMoveS,
+		[kIKindBitField] = &&Label_kIKindBitField,
+#endif
+	};
+#if WantBlockCache
+	void *BcHandler;
+#endif
+#endif
+
+	do {
+#if WantBlockCache
+		goto *BcMiss(DispatchTab, trueblnr);
+#else
+		DecodeNextInstruction();
+
+#if WantThreadedDispatch
+		goto *DispatchTab[GetDcoMainClas(&regs.CurDecOp)];
+#endif
+#endif
+
+		switch (GetDcoMainClas(&regs.CurDecOp)) {
+			DispatchCase(kIKindTst) :
+				DoCodeTst();
+				DispatchNext(kIKindTst);
+			DispatchCase(kIKindCmpB) :
+				DoCodeCmpB();
+				DispatchNext(kIKindCmpB);
+			DispatchCase(kIKindCmpW) :
+				DoCodeCmpW();
+				DispatchNext(kIKindCmpW);
+			DispatchCase(kIKindCmpL) :
+				DoCodeCmpL();
+				DispatchNext(kIKindCmpL);
+			DispatchCase(kIKindBccB) :
+				DoCodeBccB();
+				DispatchNext(kIKindBccB);
+			DispatchCase(kIKindBccW) :
+				DoCodeBccW();
+				DispatchNext(kIKindBccW);
+#if Use68020
+			DispatchCase(kIKindBccL) :
 				DoCodeBccL();
-				break;
+				DispatchNext(kIKindBccL);
 #endif
-			case kIKindBraB :
+			DispatchCase(kIKindBraB) :
 				DoCodeBraB();
-				break;
-			case kIKindBraW :
+				DispatchNext(kIKindBraB);
+			DispatchCase(kIKindBraW) :
 				DoCodeBraW();
-				break;
+				DispatchNext(kIKindBraW);
 #if Use68020
-			case kIKindBraL :
+			DispatchCase(kIKindBraL) :
 				DoCodeBraL();
-				break;
+				DispatchNext(kIKindBraL);
 #endif
-			case kIKindDBcc :
+			DispatchCase(kIKindDBcc) :
 				DoCodeDBcc();
-				break;
-			case kIKindDBF :
+				DispatchNext(kIKindDBcc);
+			DispatchCase(kIKindDBF) :
 				DoCodeDBcc();
-				break;
-			case kIKindSwap :
+				DispatchNext(kIKindDBF);
+			DispatchCase(kIKindSwap) :
 				DoCodeSwap();
-				break;
-			case kIKindMoveL :
+				DispatchNext(kIKindSwap);
+			DispatchCase(kIKindMoveL) :
 				DoCodeMove();
-				break;
-			case kIKindMoveW :
+				DispatchNext(kIKindMoveL);
+			DispatchCase(kIKindMoveW) :
 				DoCodeMove();
-				break;
-			case kIKindMoveB :
+				DispatchNext(kIKindMoveW);
+			DispatchCase(kIKindMoveB) :
 				DoCodeMove();
-				break;
-			case kIKindMoveAL :
+				DispatchNext(kIKindMoveB);
+			DispatchCase(kIKindMoveAL) :
 				DoCodeMoveA();
-				break;
-			case kIKindMoveAW :
+				DispatchNext(kIKindMoveAL);
+			DispatchCase(kIKindMoveAW) :
 				DoCodeMoveA();
-				break;
-			case kIKindMoveQ:
+				DispatchNext(kIKindMoveAW);
+			DispatchCase(kIKindMoveQ) :
 				DoCodeMoveQ();
-				break;
-			case kIKindAddB :
+				DispatchNext(kIKindMoveQ);
+			DispatchCase(kIKindAddB) :
 				DoCodeAddB();
-				break;
-			case kIKindAddW :
+				DispatchNext(kIKindAddB);
+			DispatchCase(kIKindAddW) :
 				DoCodeAddW();
-				break;
-			case kIKindAddL :
+				DispatchNext(kIKindAddW);
+			DispatchCase(kIKindAddL) :
 				DoCodeAddL();
-				break;
-			case kIKindSubB :
+				DispatchNext(kIKindAddL);
+			DispatchCase(kIKindSubB) :
 				DoCodeSubB();
-				break;
-			case kIKindSubW :
+				DispatchNext(kIKindSubB);
+			DispatchCase(kIKindSubW) :
 				DoCodeSubW();
-				break;
-			case kIKindSubL :
+				DispatchNext(kIKindSubW);
+			DispatchCase(kIKindSubL) :
 				DoCodeSubL();
-				break;
-			case kIKindLea :
+				DispatchNext(kIKindSubL);
+			DispatchCase(kIKindLea) :
 				DoCodeLea();
-				break;
-			case kIKindPEA :
+				DispatchNext(kIKindLea);
+			DispatchCase(kIKindPEA) :
 				DoCodePEA();
-				break;
-			case kIKindA :
+				DispatchNext(kIKindPEA);
+			DispatchCase(kIKindA) :
 				DoCodeA();
-				break;
-			case kIKindBsrB :
+				DispatchNext(kIKindA);
+			DispatchCase(kIKindBsrB) :
 				DoCodeBsrB();
-				break;
-			case kIKindBsrW :
+				DispatchNext(kIKindBsrB);
+			DispatchCase(kIKindBsrW) :
 				DoCodeBsrW();
-				break;
+				DispatchNext(kIKindBsrW);
 #if Use68020
-			case kIKindBsrL :
+			DispatchCase(kIKindBsrL) :
 				DoCodeBsrL();
-				break;
+				DispatchNext(kIKindBsrL);
 #endif
-			case kIKindJsr :
+			DispatchCase(kIKindJsr) :
 				DoCodeJsr();
-				break;
-			case kIKindLinkA6 :
+				DispatchNext(kIKindJsr);
+			DispatchCase(kIKindLinkA6) :
 				DoCodeLinkA6();
-				break;
-			case kIKindMOVEMRmML :
+				DispatchNext(kIKindLinkA6);
+			DispatchCase(kIKindMOVEMRmML) :
 				DoCodeMOVEMRmML();
-				break;
-			case kIKindMOVEMApRL :
+				DispatchNext(kIKindMOVEMRmML);
+			DispatchCase(kIKindMOVEMApRL) :
 				DoCodeMOVEMApRL();
-				break;
-			case kIKindUnlkA6 :
+				DispatchNext(kIKindMOVEMApRL);
+			DispatchCase(kIKindUnlkA6) :
 				DoCodeUnlkA6();
-				break;
-			case kIKindRts :
+				DispatchNext(kIKindUnlkA6);
+			DispatchCase(kIKindRts) :
 				DoCodeRts();
-				break;
-			case kIKindJmp :
+				DispatchNext(kIKindRts);
+			DispatchCase(kIKindJmp) :
 				DoCodeJmp();
-				break;
-			case kIKindClr :
+				DispatchNext(kIKindJmp);
+			DispatchCase(kIKindClr) :
 				DoCodeClr();
-				break;
-			case kIKindAddA :
-				DoCodeAddA();
-				break;
-			case kIKindAddQA :
+				DispatchNext(kIKindClr);
+			DispatchCase(kIKindAddA) :
 				DoCodeAddA();
-				/* DoCodeAddQA(); */
-				break;
-			case kIKindSubA :
-				DoCodeSubA();
-				break;
-			case kIKindSubQA :
+				DispatchNext(kIKindAddA);
+			DispatchCase(kIKindAddQA) :
+				DoCodeAddQA();
+				DispatchNext(kIKindAddQA);
+			DispatchCase(kIKindSubA) :
 				DoCodeSubA();
-				/* DoCodeSubQA(); */
-				break;
-			case kIKindCmpA :
+				DispatchNext(kIKindSubA);
+			DispatchCase(kIKindSubQA) :
+				DoCodeSubQA();
+				DispatchNext(kIKindSubQA);
+			DispatchCase(kIKindCmpA) :
 				DoCodeCmpA();
-				break;
-			case kIKindAddXB :
+				DispatchNext(kIKindCmpA);
+			DispatchCase(kIKindAddXB) :
 				DoCodeAddXB();
-				break;
-			case kIKindAddXW :
+				DispatchNext(kIKindAddXB);
+			DispatchCase(kIKindAddXW) :
 				DoCodeAddXW();
-				break;
-			case kIKindAddXL :
+				DispatchNext(kIKindAddXW);
+			DispatchCase(kIKindAddXL) :
 				DoCodeAddXL();
-				break;
-			case kIKindSubXB :
+				DispatchNext(kIKindAddXL);
+			DispatchCase(kIKindSubXB) :
 				DoCodeSubXB();
-				break;
-			case kIKindSubXW :
+				DispatchNext(kIKindSubXB);
+			DispatchCase(kIKindSubXW) :
 				DoCodeSubXW();
-				break;
-			case kIKindSubXL :
+				DispatchNext(kIKindSubXW);
+			DispatchCase(kIKindSubXL) :
 				DoCodeSubXL();
-				break;
+				DispatchNext(kIKindSubXL);
 
-			case kIKindRolopNM :
+			DispatchCase(kIKindRolopNM) :
 				DoCodeRolopNM();
-				break;
-			case kIKindRolopND :
+				DispatchNext(kIKindRolopNM);
+			DispatchCase(kIKindRolopND) :
 				DoCodeRolopND();
-				break;
-			case kIKindRolopDD :
+				DispatchNext(kIKindRolopND);
+			DispatchCase(kIKindRolopDD) :
 				DoCodeRolopDD();
-				break;
-			case kIKindBitOpDD :
+				DispatchNext(kIKindRolopDD);
+			DispatchCase(kIKindBitOpDD) :
 				DoCodeBitOpDD();
-				break;
-			case kIKindBitOpDM :
+				DispatchNext(kIKindBitOpDD);
+			DispatchCase(kIKindBitOpDM) :
 				DoCodeBitOpDM();
-				break;
-			case kIKindBitOpND :
+				DispatchNext(kIKindBitOpDM);
+			DispatchCase(kIKindBitOpND) :
 				DoCodeBitOpND();
-				break;
-			case kIKindBitOpNM :
+				DispatchNext(kIKindBitOpND);
+			DispatchCase(kIKindBitOpNM) :
 				DoCodeBitOpNM();
-				break;
+				DispatchNext(kIKindBitOpNM);
 
-			case kIKindAndI :
+			DispatchCase(kIKindAndI) :
 				DoCodeAnd();
 				/* DoCodeAndI(); */
-				break;
-			case kIKindAndEaD :
+				DispatchNext(kIKindAndI);
+			DispatchCase(kIKindAndEaD) :
 				DoCodeAnd();
 				/* DoCodeAndEaD(); */
-				break;
-			case kIKindAndDEa :
+				DispatchNext(kIKindAndEaD);
+			DispatchCase(kIKindAndDEa) :
 				DoCodeAnd();
 				/* DoCodeAndDEa(); */
-				break;
-			case kIKindOrI :
+				DispatchNext(kIKindAndDEa);
+			DispatchCase(kIKindOrI) :
 				DoCodeOr();
-				break;
-			case kIKindOrEaD :
+				DispatchNext(kIKindOrI);
+			DispatchCase(kIKindOrEaD) :
 				/* DoCodeOrEaD(); */
 				DoCodeOr();
-				break;
-			case kIKindOrDEa :
+				DispatchNext(kIKindOrEaD);
+			DispatchCase(kIKindOrDEa) :
 				/* DoCodeOrDEa(); */
 				DoCodeOr();
-				break;
-			case kIKindEor :
+				DispatchNext(kIKindOrDEa);
+			DispatchCase(kIKindEor) :
 				DoCodeEor();
-				break;
-			case kIKindEorI :
+				DispatchNext(kIKindEor);
+			DispatchCase(kIKindEorI) :
 				DoCodeEor();
-				break;
-			case kIKindNot :
+				DispatchNext(kIKindEorI);
+			DispatchCase(kIKindNot) :
 				DoCodeNot();
-				break;
+				DispatchNext(kIKindNot);
 
-			case kIKindScc :
+			DispatchCase(kIKindScc) :
 				DoCodeScc();
-				break;
-			case kIKindEXTL :
+				DispatchNext(kIKindScc);
+			DispatchCase(kIKindEXTL) :
 				DoCodeEXTL();
-				break;
-			case kIKindEXTW :
+				DispatchNext(kIKindEXTL);
+			DispatchCase(kIKindEXTW) :
 				DoCodeEXTW();
-				break;
-			case kIKindNegB :
+				DispatchNext(kIKindEXTW);
+			DispatchCase(kIKindNegB) :
 				DoCodeNegB();
-				break;
-			case kIKindNegW :
+				DispatchNext(kIKindNegB);
+			DispatchCase(kIKindNegW) :
 				DoCodeNegW();
-				break;
-			case kIKindNegL :
+				DispatchNext(kIKindNegW);
+			DispatchCase(kIKindNegL) :
 				DoCodeNegL();
-				break;
-			case kIKindNegXB :
+				DispatchNext(kIKindNegL);
+			DispatchCase(kIKindNegXB) :
 				DoCodeNegXB();
-				break;
-			case kIKindNegXW :
+				DispatchNext(kIKindNegXB);
+			DispatchCase(kIKindNegXW) :
 				DoCodeNegXW();
-				break;
-			case kIKindNegXL :
+				DispatchNext(kIKindNegXW);
+			DispatchCase(kIKindNegXL) :
 				DoCodeNegXL();
-				break;
+				DispatchNext(kIKindNegXL);
 
-			case kIKindMulU :
+			DispatchCase(kIKindMulU) :
 				DoCodeMulU();
-				break;
-			case kIKindMulS :
+				DispatchNext(kIKindMulU);
+			DispatchCase(kIKindMulS) :
 				DoCodeMulS();
-				break;
-			case kIKindDivU :
+				DispatchNext(kIKindMulS);
+			DispatchCase(kIKindDivU) :
 				DoCodeDivU();
-				break;
-			case kIKindDivS :
+				DispatchNext(kIKindDivU);
+			DispatchCase(kIKindDivS) :
 				DoCodeDivS();
-				break;
-			case kIKindExgdd :
+				DispatchNext(kIKindDivS);
+			DispatchCase(kIKindExgdd) :
 				DoCodeExgdd();
-				break;
-			case kIKindExgaa :
+				DispatchNext(kIKindExgdd);
+			DispatchCase(kIKindExgaa) :
 				DoCodeExgaa();
-				break;
-			case kIKindExgda :
+				DispatchNext(kIKindExgaa);
+			DispatchCase(kIKindExgda) :
 				DoCodeExgda();
-				break;
+				DispatchNext(kIKindExgda);
 
-			case kIKindMoveCCREa :
+			DispatchCase(kIKindMoveCCREa) :
 				DoCodeMoveCCREa();
-				break;
-			case kIKindMoveEaCCR :
+				DispatchNext(kIKindMoveCCREa);
+			DispatchCase(kIKindMoveEaCCR) :
 				DoCodeMoveEaCR();
-				break;
-			case kIKindMoveSREa :
+				DispatchNext(kIKindMoveEaCCR);
+			DispatchCase(kIKindMoveSREa) :
 				DoCodeMoveSREa();
-				break;
-			case kIKindMoveEaSR :
+				DispatchNext(kIKindMoveSREa);
+			DispatchCase(kIKindMoveEaSR) :
 				DoCodeMoveEaSR();
-				break;
-			case kIKindBinOpStatusCCR :
+				DispatchNext(kIKindMoveEaSR);
+			DispatchCase(kIKindBinOpStatusCCR) :
 				DoBinOpStatusCCR();
-				break;
+				DispatchNext(kIKindBinOpStatusCCR);
 
-			case kIKindMOVEMApRW :
+			DispatchCase(kIKindMOVEMApRW) :
 				DoCodeMOVEMApRW();
-				break;
-			case kIKindMOVEMRmMW :
+				DispatchNext(kIKindMOVEMApRW);
+			DispatchCase(kIKindMOVEMRmMW) :
 				DoCodeMOVEMRmMW();
-				break;
-			case kIKindMOVEMrm :
+				DispatchNext(kIKindMOVEMRmMW);
+			DispatchCase(kIKindMOVEMrm) :
 				DoCodeMOVEMrm();
-				break;
-			case kIKindMOVEMmr :
+				DispatchNext(kIKindMOVEMrm);
+			DispatchCase(kIKindMOVEMmr) :
 				DoCodeMOVEMmr();
-				break;
+				DispatchNext(kIKindMOVEMmr);
 
-			case kIKindAbcdr :
+			DispatchCase(kIKindAbcdr) :
 				DoCodeAbcdr();
-				break;
-			case kIKindAbcdm :
+				DispatchNext(kIKindAbcdr);
+			DispatchCase(kIKindAbcdm) :
 				DoCodeAbcdm();
-				break;
-			case kIKindSbcdr :
+				DispatchNext(kIKindAbcdm);
+			DispatchCase(kIKindSbcdr) :
 				DoCodeSbcdr();
-				break;
-			case kIKindSbcdm :
+				DispatchNext(kIKindSbcdr);
+			DispatchCase(kIKindSbcdm) :
 				DoCodeSbcdm();
-				break;
-			case kIKindNbcd :
+				DispatchNext(kIKindSbcdm);
+			DispatchCase(kIKindNbcd) :
 				DoCodeNbcd();
-				break;
+				DispatchNext(kIKindNbcd);
 
-			case kIKindRte :
+			DispatchCase(kIKindRte) :
 				DoCodeRte();
-				break;
-			case kIKindNop :
+				DispatchNext(kIKindRte);
+			DispatchCase(kIKindNop) :
 				DoCodeNop();
-				break;
-			case kIKindMoveP :
+				DispatchNext(kIKindNop);
+			DispatchCase(kIKindMoveP) :
 				DoCodeMoveP();
-				break;
-			case kIKindIllegal :
+				DispatchNext(kIKindMoveP);
+			DispatchCase(kIKindIllegal) :
 				op_illg();
-				break;
+				DispatchNext(kIKindIllegal);
 
-			case kIKindChkW :
+			DispatchCase(kIKindChkW) :
 				DoCodeChkW();
-				break;
-			case kIKindTrap :
+				DispatchNext(kIKindChkW);
+			DispatchCase(kIKindTrap) :
 				DoCodeTrap();
-				break;
-			case kIKindTrapV :
+				DispatchNext(kIKindTrap);
+			DispatchCase(kIKindTrapV) :
 				DoCodeTrapV();
-				break;
-			case kIKindRtr :
+				DispatchNext(kIKindTrapV);
+			DispatchCase(kIKindRtr) :
 				DoCodeRtr();
-				break;
-			case kIKindLink :
+				DispatchNext(kIKindRtr);
+			DispatchCase(kIKindLink) :
 				DoCodeLink();
-				break;
-			case kIKindUnlk :
+				DispatchNext(kIKindLink);
+			DispatchCase(kIKindUnlk) :
 				DoCodeUnlk();
-				break;
-			case kIKindMoveRUSP :
+				DispatchNext(kIKindUnlk);
+			DispatchCase(kIKindMoveRUSP) :
 				DoCodeMoveRUSP();
-				break;
-			case kIKindMoveUSPR :
+				DispatchNext(kIKindMoveRUSP);
+			DispatchCase(kIKindMoveUSPR) :
 				DoCodeMoveUSPR();
-				break;
-			case kIKindTas :
+				DispatchNext(kIKindMoveUSPR);
+			DispatchCase(kIKindTas) :
 				DoCodeTas();
-				break;
-			case kIKindF :
+				DispatchNext(kIKindTas);
+			DispatchCase(kIKindF) :
 				DoCodeF();
-				break;
-			case kIKindCallMorRtm :
+				DispatchNext(kIKindF);
+			DispatchCase(kIKindCallMorRtm) :
 				DoCodeCallMorRtm();
-				break;
-			case kIKindStop :
+				DispatchNext(kIKindCallMorRtm);
+			DispatchCase(kIKindStop) :
 				DoCodeStop();
-				break;
-			case kIKindReset :
+				DispatchNext(kIKindStop);
+			DispatchCase(kIKindReset) :
 				DoCodeReset();
-				break;
+				DispatchNext(kIKindReset);
+			DispatchCase(kIKindMoveLRgRg) :
+				DoCodeMoveLRgRg();
+				DispatchNext(kIKindMoveLRgRg);
+			DispatchCase(kIKindMoveLRgAPI) :
+				DoCodeMoveLRgAPI();
+				DispatchNext(kIKindMoveLRgAPI);
+			DispatchCase(kIKindMoveLRgAPD) :
+				DoCodeMoveLRgAPD();
+				DispatchNext(kIKindMoveLRgAPD);
+			DispatchCase(kIKindMoveLRgAD) :
+				DoCodeMoveLRgAD();
+				DispatchNext(kIKindMoveLRgAD);
+			DispatchCase(kIKindMoveLARg) :
+				DoCodeMoveLARg();
+				DispatchNext(kIKindMoveLARg);
+			DispatchCase(kIKindMoveLAPIRg) :
+				DoCodeMoveLAPIRg();
+				DispatchNext(kIKindMoveLAPIRg);
+			DispatchCase(kIKindMoveLADRg) :
+				DoCodeMoveLADRg();
+				DispatchNext(kIKindMoveLADRg);
+			DispatchCase(kIKindMoveWRgRg) :
+				DoCodeMoveWRgRg();
+				DispatchNext(kIKindMoveWRgRg);
+			DispatchCase(kIKindMoveWARg) :
+				DoCodeMoveWARg();
+				DispatchNext(kIKindMoveWARg);
+			DispatchCase(kIKindMoveWAPIRg) :
+				DoCodeMoveWAPIRg();
+				DispatchNext(kIKindMoveWAPIRg);
+			DispatchCase(kIKindMoveWADRg) :
+				DoCodeMoveWADRg();
+				DispatchNext(kIKindMoveWADRg);
+			DispatchCase(kIKindCmpBImRg) :
+				DoCodeCmpBImRg();
+				DispatchNext(kIKindCmpBImRg);
+			DispatchCase(kIKindCmpWImRg) :
+				DoCodeCmpWImRg();
+				DispatchNext(kIKindCmpWImRg);
+			DispatchCase(kIKindCmpLImRg) :
+				DoCodeCmpLImRg();
+				DispatchNext(kIKindCmpLImRg);
+			DispatchCase(kIKindCmpLRgRg) :
+				DoCodeCmpLRgRg();
+				DispatchNext(kIKindCmpLRgRg);
 #if Use68020
-			case kIKindEXTBL :
+			DispatchCase(kIKindEXTBL) :
 				DoCodeEXTBL();
-				break;
-			case kIKindTRAPcc :
+				DispatchNext(kIKindEXTBL);
+			DispatchCase(kIKindTRAPcc) :
 				DoCodeTRAPcc();
-				break;
-			case kIKindChkL :
+				DispatchNext(kIKindTRAPcc);
+			DispatchCase(kIKindChkL) :
 				DoCodeChkL();
-				break;
-			case kIKindBkpt :
+				DispatchNext(kIKindChkL);
+			DispatchCase(kIKindBkpt) :
 				DoCodeBkpt();
-				break;
-			case kIKindDivL :
+				DispatchNext(kIKindBkpt);
+			DispatchCase(kIKindDivL) :
 				DoCodeDivL();
-				break;
-			case kIKindMulL :
+				DispatchNext(kIKindDivL);
+			DispatchCase(kIKindMulL) :
 				DoCodeMulL();
-				break;
-			case kIKindRtd :
+				DispatchNext(kIKindMulL);
+			DispatchCase(kIKindRtd) :
 				DoCodeRtd();
-				break;
-			case kIKindMoveC :
+				DispatchNext(kIKindRtd);
+			DispatchCase(kIKindMoveC) :
 				DoCodeMoveC();
-				break;
-			case kIKindLinkL :
+				DispatchNext(kIKindMoveC);
+			DispatchCase(kIKindLinkL) :
 				DoCodeLinkL();
-				break;
-			case kIKindPack :
+				DispatchNext(kIKindLinkL);
+			DispatchCase(kIKindPack) :
 				DoCodePack();
-				break;
-			case kIKindUnpk :
+				DispatchNext(kIKindPack);
+			DispatchCase(kIKindUnpk) :
 				DoCodeUnpk();
-				break;
-			case kIKindCHK2orCMP2 :
+				DispatchNext(kIKindUnpk);
+			DispatchCase(kIKindCHK2orCMP2) :
 				DoCHK2orCMP2();
-				break;
-			case kIKindCAS2 :
+				DispatchNext(kIKindCHK2orCMP2);
+			DispatchCase(kIKindCAS2) :
 				DoCAS2();
-				break;
-			case kIKindCAS :
+				DispatchNext(kIKindCAS2);
+			DispatchCase(kIKindCAS) :
 				DoCAS();
-				break;
-			case kIKindMoveS :
+				DispatchNext(kIKindCAS);
+			DispatchCase(kIKindMoveS) :
 				DoMOVES();
-				break;
-			case kIKindBitField :
+				DispatchNext(kIKindMoveS);
+			DispatchCase(kIKindBitField) :
 				DoBitField();
-				break;
+				DispatchNext(kIKindBitField);
+#endif
+
+#if WantFusedOps
+			/* the fused tails, see FuseTailOf */
+			Fuse_BccAfterTst:
+				FetchNextInstruction();
+				if (FuseIsBcc(regs.opcode)) {
+					if (0 != (regs.opcode & 0xFF)) {
+						FuseCharge(kFuseBccAfterTst, kIKindBccB,
+							FuseBccBCycles);
+						DoBccB(cctrueAfterTst());
+					} else {
+						FuseCharge(kFuseBccAfterTst, kIKindBccW,
+							FuseBccWCycles);
+						DoBccW(cctrueAfterTst());
+					}
+					DispatchBreak;
+				}
+				DispatchFetched;
+			Fuse_BccAfterCmp:
+				FetchNextInstruction();
+				if (FuseIsBcc(regs.opcode)) {
+					if (0 != (regs.opcode & 0xFF)) {
+						FuseCharge(kFuseBccAfterCmp, kIKindBccB,
+							FuseBccBCycles);
+						DoBccB(cctrue());
+					} else {
+						FuseCharge(kFuseBccAfterCmp, kIKindBccW,
+							FuseBccWCycles);
+						DoBccW(cctrue());
+					}
+					DispatchBreak;
+				}
+				DispatchFetched;
+			Fuse_MOVEMAfterLink:
+				FetchNextInstruction();
+				if (kFuseOpMOVEMRmMLSP == regs.opcode) {
+					FuseCharge(kFuseMOVEMAfterLink, kIKindMOVEMRmML,
+						FuseMOVEMCycles);
+					goto Label_kIKindMOVEMRmML;
+				}
+				DispatchFetched;
+			Fuse_UnlkAfterMOVEM:
+				FetchNextInstruction();
+				if (kFuseOpUnlkA6 == regs.opcode) {
+					FuseCharge(kFuseUnlkAfterMOVEM, kIKindUnlkA6,
+						FuseUnlkCycles);
+					goto Label_kIKindUnlkA6;
+				}
+				DispatchFetched;
+			Fuse_RtsAfterUnlk:
+				FetchNextInstruction();
+				if (kFuseOpRts == regs.opcode) {
+					FuseCharge(kFuseRtsAfterUnlk, kIKindRts,
+						FuseRtsCycles);
+					goto Label_kIKindRts;
+				}
+				DispatchFetched;
 #endif
 		}
 	} while (regs.MaxCyclesToGo > 0);
 }
 
+#if EnableDynarec
+#include "DYNAREC.h"
+#endif
+
+/*
+	Outside of the cpu, cycles are counted at the base clock
+	rate, which the rest of the machine is timed by. With
+	EnableClockMult, the cpu's own counts are in units that
+	are 1 << ClockShift times shorter, so the emulated 68000
+	runs that much faster relative to everything else.
+*/
+
+#if EnableClockMult
+#define CpuCyclesToBase(n) \
+	(((n) + (1 << regs.ClockShift) - 1) >> regs.ClockShift)
+	/* round up, so the cpu never appears to be ahead */
+#define BaseCyclesToCpu(n) ((n) << regs.ClockShift)
+#else
+#define CpuCyclesToBase(n) (n)
+#define BaseCyclesToCpu(n) (n)
+#endif
+
 GLOBALFUNC si5r GetCyclesRemaining(void)
 {
-	return regs.MoreCyclesToGo + regs.MaxCyclesToGo;
+	BcSettle();
+	return CpuCyclesToBase(regs.MoreCyclesToGo + regs.MaxCyclesToGo);
 }
 
 GLOBALPROC SetCyclesRemaining(si5r n)
 {
+	n = BaseCyclesToCpu(n);
+	BcSettle();
 	if (regs.MaxCyclesToGo >= n) {
 		regs.MoreCyclesToGo = 0;
 		regs.MaxCyclesToGo = n;
@@ -4927,6 +6906,16 @@ GLOBALPROC SetCyclesRemaining(si5r n)
 	}
 }
 
+#if WantInstrCount
+GLOBALFUNC ui5r m68k_TakeInstrCount(void)
+{
+	ui5r v = regs.InstrCount;
+
+	regs.InstrCount = 0;
+	return v;
+}
+#endif
+
 GLOBALFUNC ui3r get_vm_byte(CPTR addr)
 {
 	return (ui3b) get_byte(addr);
@@ -4970,6 +6959,9 @@ GLOBALPROC SetHeadATTel(ATTep p)
 	regs.MATCex.cmpmask = 0;
 	regs.MATCex.cmpvalu = 0xFFFFFFFF;
 	regs.HeadATTel = p;
+#if WantATTPageTable
+	ATTPageTabSetUp(p);
+#endif
 }
 
 LOCALPROC do_trace(void)
@@ -5022,8 +7014,17 @@ GLOBALPROC m68k_reset(void)
 	regs.MaxCyclesToGo = 0;
 	regs.MoreCyclesToGo = 0;
 	regs.ResidualCycles = 0;
+#if WantIdleSkip
+	regs.stopped = falseblnr;
+#endif
+#if EnableDynarec
+	DrFlush();
+#endif
+#if WantBlockCache
+	BcFlush();
+#endif
 
-	do_put_mem_word(regs.fakeword, 0x4AFC);
+	do_put_vmem_word((ui3p)&regs.fakeword, 0x4AFC);
 		/* illegal instruction opcode */
 
 #if 0
@@ -5071,11 +7072,74 @@ GLOBALPROC MINEM68K_Init(
 	regs.fIPL = fIPL;
 
 	M68KITAB_setup(regs.disp_table);
+#if WantFusedOps
+	FuseSetup();
+#endif
+#if WantBlockCache
+	BcFlush();
+#endif
+#if WantIdleSkip
+	m68k_AddIdleRange(kROM_Base, kROM_Base + kROM_Size);
+#endif
 }
 
+#if EnableFastTiming
+GLOBALPROC m68k_SetFlatCycles(blnr v)
+{
+	/*
+		In the fast timing mode every instruction costs
+		kMyAvgCycPerInstr. This is done by rewriting the
+		cycle counts in disp_table, so the instruction loop
+		is the same for both modes: DecodeNextInstruction
+		still subtracts GetDcoCycles for each instruction,
+		the mode only changes what it finds there. So the
+		fast mode makes the emulated cpu faster, not the
+		instruction loop. Everything that uses GetDcoCycles,
+		such as DBFLoopAccel, follows along.
+		Called between calls to m68k_go_nCycles.
+	*/
+	if (v != regs.FlatCycles) {
+		si5r i;
+
+		regs.FlatCycles = v;
+		M68KITAB_setup(regs.disp_table);
+		if (v) {
+			for (i = 0; i < disp_table_sz; ++i) {
+				SetDcoCycles(&regs.disp_table[i], kMyAvgCycPerInstr);
+			}
+		}
+#if WantFusedOps
+		FuseSetup();
+#endif
+#if EnableDynarec
+		DrFlush(); /* blocks hold the old cycle counts */
+#endif
+#if WantBlockCache
+		BcFlush(); /* so do these */
+#endif
+	}
+}
+#endif
+
+#if EnableClockMult
+GLOBALPROC m68k_SetClockShift(ui3r v)
+{
+	/* called between calls to m68k_go_nCycles */
+	if (v != regs.ClockShift) {
+		regs.ResidualCycles = (regs.ResidualCycles
+			>> regs.ClockShift) << v;
+		regs.ClockShift = v;
+	}
+}
+#endif
+
 GLOBALPROC m68k_go_nCycles(ui5b n)
 {
-	regs.MaxCyclesToGo += (n + regs.ResidualCycles);
+	regs.MaxCyclesToGo += (BaseCyclesToCpu(n) + regs.ResidualCycles);
+#if WantIdleSkip
+	regs.IdlePC = kIdleNoPC;
+		/* devices may have changed memory since last slice */
+#endif
 	while (regs.MaxCyclesToGo > 0) {
 
 #if 0
@@ -5097,7 +7161,20 @@ GLOBALPROC m68k_go_nCycles(ui5b n)
 		if (regs.t1) {
 			do_trace();
 		}
-		m68k_go_MaxCycles();
+#if WantIdleSkip
+		if (regs.stopped) {
+			regs.IdleCycles += regs.MaxCyclesToGo;
+			regs.MaxCyclesToGo = 0;
+		} else
+#endif
+#if EnableDynarec
+		if (kDrModeOff != DrMode) {
+			Dr_go_MaxCycles();
+		} else
+#endif
+		{
+			m68k_go_MaxCycles();
+		}
 		regs.MaxCyclesToGo += regs.MoreCyclesToGo;
 		regs.MoreCyclesToGo = 0;
 	}
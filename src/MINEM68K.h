@@ -33,6 +33,42 @@ EXPORTPROC m68k_reset(void);
 EXPORTFUNC si5r GetCyclesRemaining(void);
 EXPORTPROC SetCyclesRemaining(si5r n);
 
+#if WantBlockCache
+EXPORTPROC m68k_MemWriteNtfy(ui3p p, ui5r L);
+#endif
+
+#if WantInstrCount
+EXPORTFUNC ui5r m68k_TakeInstrCount(void);
+#endif
+
+#if WantFusedOps && WantFuseCounts && dbglog_HAVE
+EXPORTPROC m68k_LogFuseCounts(void);
+#endif
+
+#if WantMATCStats && dbglog_HAVE
+EXPORTPROC m68k_LogMATCStats(void);
+#endif
+
+#if EnableDynarec
+EXPORTPROC m68k_SetDynarec(ui3r v);
+#if dbglog_HAVE
+EXPORTPROC m68k_LogDynarecStats(void);
+#endif
+#endif
+
+#if WantIdleSkip
+EXPORTPROC m68k_AddIdleRange(CPTR lo, CPTR hi);
+EXPORTFUNC ui5r m68k_TakeIdleCycles(void);
+#endif
+
+#if EnableFastTiming
+EXPORTPROC m68k_SetFlatCycles(blnr v);
+#endif
+
+#if EnableClockMult
+EXPORTPROC m68k_SetClockShift(ui3r v);
+#endif
+
 EXPORTPROC m68k_go_nCycles(ui5b n);
 
 /*
@@ -26,6 +26,10 @@
 #include "MYOSGLUE.h"
 
 #include "STRCONST.h"
+#include "PIXCONV.h"
+#include "SCRNDIFF.h"
+#include "SCALE.h"
+#include "FRAMEPIPE.h"
 
 /* Uncomment to use debug console as a texture.
  * Press and hold X to see it.
@@ -125,11 +129,6 @@ GX_TRANSFER_SCALING(GX_TRANSFER_SCALE_NO))
 #define MySubScreenWidth 320
 #define MySubScreenHeight 240
 
-/*
- * Lookup table used for indexed->RGB565
- */
-static u16 FBConvTable[ 256 ][ 8 ];
-
 C3D_RenderTarget* MainRenderTarget = NULL;
 C3D_RenderTarget* SubRenderTarget = NULL;
 
@@ -308,134 +307,271 @@ rgba32* LoadPNG( const char* Path, int* OutWidth, int* OutHeight ) {
 
 static void* TempTextureBuffer = NULL;
 
-typedef enum {
-    INFB_FORMAT_1BPP = 1,
-    INFB_FORMAT_4BPP,
-    INFB_FORMAT_8BPP
-} INFB_FORMAT;
+/*
+ * Set when a texture drawn on either screen changes,
+ * so the next frame is submitted even if nothing else did.
+ */
+static blnr PresentDirty = trueblnr;
+
+#if vMacScreenDepth > 3
+#error "direct color screens are not supported"
+#endif
 
 /*
- * Converts a 1bpp packed image and outputs it in RGB565 format.
+ * What Video_UpdateTexture needs to know to convert a screen
+ * buffer, it may be mono even when vMacScreenDepth isn't 0.
+ * With UseEmThread this travels with each frame.
  */
-void Convert1BPP( u8* Src, u32* Dest, int Size ) {
-    const u32 HNibble2Pixels[ 4 ] = {
-        0xFFFFFFFF, // 00
-        0x0000FFFF, // 01
-        0xFFFF0000, // 10
-        0x00000000  // 11
-    };
-    u8 In = 0;
+typedef struct {
+    ui3r Depth;
+#if 0 != vMacScreenDepth
+    ui4r Reds[ CLUT_size ];
+    ui4r Greens[ CLUT_size ];
+    ui4r Blues[ CLUT_size ];
+#endif
+} ScreenColors;
+
+/* Mac Plus screen, 0 is white */
+static ui4r MonoLevels[ 2 ] = { 0xFFFF, 0x0000 };
+
+/* Converts screen buffers to RGB565 for FBTexture */
+static PixConv ScreenConv;
+static ScreenColors ScreenConvColors;
+
+/* Sets up ScreenConv for Colors, if it isn't already */
+static void Video_SetColors( ScreenColors* Colors ) {
+    if ( memcmp( Colors, &ScreenConvColors, sizeof( ScreenColors ) ) == 0 )
+        return;
     
-    while ( Size-= 8 > 0 ) {
-        In = *Src++;
-        
-        *Dest++ = HNibble2Pixels[ ( In >> 6 ) & 0x03 ];
-        *Dest++ = HNibble2Pixels[ ( In >> 4 ) & 0x03 ];
-        *Dest++ = HNibble2Pixels[ ( In >> 2 ) & 0x03 ];
-        *Dest++ = HNibble2Pixels[ In & 0x03 ];
+    ScreenConvColors = *Colors;
+    
+#if 0 != vMacScreenDepth
+    if ( Colors->Depth != 0 ) {
+        PixConvSetup( &ScreenConv, Colors->Depth, kPixFmtRGB565,
+            Colors->Reds, Colors->Greens, Colors->Blues );
+        return;
+    }
+#endif
+    
+    PixConvSetup( &ScreenConv, 0, kPixFmtRGB565, MonoLevels, MonoLevels, MonoLevels );
+}
+
+/* The colors of the screen buffer being drawn by the emulation */
+static void GetCurScreenColors( ScreenColors* Colors ) {
+    memset( Colors, 0, sizeof( ScreenColors ) );
+    
+#if 0 != vMacScreenDepth
+    if ( UseColorMode ) {
+        Colors->Depth = vMacScreenDepth;
+        memcpy( Colors->Reds, CLUT_reds, sizeof( CLUT_reds ) );
+        memcpy( Colors->Greens, CLUT_greens, sizeof( CLUT_greens ) );
+        memcpy( Colors->Blues, CLUT_blues, sizeof( CLUT_blues ) );
     }
+#endif
 }
 
 /*
- * Converts an 8bpp paletted image and outputs it in RGB565 format.
+ * Most bands transferred per update, the last one
+ * is stretched to cover whatever changed after it.
  */
-static void Convert8BPP( u8* Src, u16* Dest, int Size ) {
-    while ( Size-- ) {
-        *Dest++ = FBConvTable[ *Src++ ][ 0 ];
-    }
+#define kMaxTextureBands 4
+
+#ifndef WantUploadStats
+#define WantUploadStats 0
+#endif
+
+#if WantUploadStats
+static u32 UploadFrames = 0;
+static u32 UploadBands = 0;
+static u32 UploadBytes = 0;
+#endif
+
+/*
+ * Flushes and transfers rows Top to Bottom of a 512 wide staging
+ * buffer into a 512x512 texture. Top and Bottom must be on a tile
+ * boundary. The transfer flips vertically, so the rows land
+ * counting up from the bottom of the texture.
+ */
+static void Video_TransferRows( u16* Buffer, C3D_Tex* Texture, int Top, int Bottom ) {
+    GSPGPU_FlushDataCache( Buffer + ( 512 * Top ), 512 * ( Bottom - Top ) * 2 );
+    C3D_SafeDisplayTransfer( ( u32* ) ( Buffer + ( 512 * Top ) ), GX_BUFFER_DIM( 512, Bottom - Top ),
+        ( u32* ) ( ( u16* ) Texture->data + ( 512 * ( 512 - Bottom ) ) ), GX_BUFFER_DIM( 512, Bottom - Top ),
+        TEXTURE_TRANSFER_FLAGS );
+    
+#if WantUploadStats
+    UploadBands++;
+    UploadBytes+= 512 * ( Bottom - Top ) * 2;
+#endif
 }
 
 /*
- * Converts an 4bpp packed image and outputs it in RGB565 format.
+ * Transfers each run of set bands, at most kMaxTextureBands
+ * of them. Returns the number of runs transferred.
  */
-static void Convert4BPP( u8* Src, u16* Dest, int Size ) {
-    while ( Size-= 2 ) {
-        memcpy( Dest, &FBConvTable[ *Src ][ 0 ], 2 * 2 );
+static int Video_TransferBands( u16* Buffer, C3D_Tex* Texture, ui5b* Bands ) {
+    int Uploads = 0;
+    int Last = 0;
+    int i = 0;
+    int j = 0;
+    
+    for ( Last = kScreenBandsN; Last > 0 && ! ScreenBandTst( Bands, Last - 1 ); Last-- ) {
+    }
+    
+    for ( i = 0; i < Last; i = j ) {
+        if ( ! ScreenBandTst( Bands, i ) ) {
+            j = i + 1;
+            continue;
+        }
         
-        Dest+= 2;
-        Src++;
+        if ( ++Uploads == kMaxTextureBands ) {
+            j = Last;
+        } else {
+            for ( j = i + 1; j < Last && ScreenBandTst( Bands, j ); j++ ) {
+            }
+        }
+        
+        Video_TransferRows( Buffer, Texture, i * kScreenBandRows, j * kScreenBandRows );
     }
+    
+    return Uploads;
 }
 
 /*
- * Performs an indexed to RGB565 framebuffer conversion
+ * Downscaler for the fit to screen modes, see src/SCALE.c.
+ * ScaleBuffer is kept between frames, so only the output rows
+ * under changed bands are redone and transferred. ScaleSrc is
+ * the scaler's own copy of the screen, so it can be rebuilt on
+ * a mode change without waiting for the emulator.
  */
-static void ConvertFBTo565( u8* Src, u16* Dest, int Size, INFB_FORMAT Format ) {
-    switch ( Format ) {
-        case INFB_FORMAT_1BPP: {
-            Convert1BPP( Src, ( u32* ) Dest, Size );
-            break;
-        }
-        case INFB_FORMAT_4BPP: {
-            Convert4BPP( Src, Dest, Size );
-            break;
-        }
-        case INFB_FORMAT_8BPP: {
-            Convert8BPP( Src, Dest, Size );
-            break;
-        }
-        default: break;
-    };
+C3D_Tex ScaledTex;
+
+static u16* ScaleBuffer = NULL;
+static u8* ScaleSrc = NULL;
+static u8* ScaleHCache = NULL;
+
+/* DstW is zero while the GPU does the scaling */
+static Scaler ScreenScaler;
+
+/*
+ * Picks the output size, zero to leave the scaling to the GPU,
+ * and rebuilds the whole scaled texture for it.
+ */
+static void Scale_Setup( int Width, int Height ) {
+    if ( ! ScaleBuffer || ! ScaleSrc || ! ScaleHCache )
+        Width = 0;
+    else
+        memset( ScaleBuffer, 0, 512 * 512 * 2 );
+    
+    if ( ScaleSetSize( &ScreenScaler, Width, Height ) ) {
+        Video_TransferRows( ScaleBuffer, &ScaledTex, 0, 512 );
+        PresentDirty = trueblnr;
+    }
 }
 
 /*
- * Sets up the 8bpp->16bpp paletted to RGB565 conversion table.
+ * Takes the changed bands of a 1bpp screen into ScaleSrc and,
+ * when scaling, redoes and transfers the output rows under them.
  */
-void MakeTable8BPP( u16* Reds, u16* Greens, u16* Blues, int Size ) {
+static void Scale_Update( u8* Src, ui5b* Bands ) {
+    ui5b OutBands[ kScreenBandWords ];
+    uimr DstTop = 0;
+    uimr DstBottom = 0;
+    int Top = 0;
+    int Bottom = 0;
     int i = 0;
+    int j = 0;
     
-    for ( i = 0; i < Size; i++ ) {
-        FBConvTable[ i ][ 0 ] = RGB8_to_565( Reds[ i ] >> 8, Greens[ i ] >> 8, Blues[ i ] >> 8 );
+    if ( ! ScaleSrc )
+        return;
+    
+    memset( OutBands, 0, sizeof( OutBands ) );
+    
+    for ( i = 0; i < kScreenBandsN; i = j ) {
+        if ( ! ScreenBandTst( Bands, i ) ) {
+            j = i + 1;
+            continue;
+        }
+        
+        for ( j = i + 1; j < kScreenBandsN && ScreenBandTst( Bands, j ); j++ ) {
+        }
+        
+        Top = i * kScreenBandRows;
+        Bottom = j * kScreenBandRows;
+        
+        if ( Bottom > vMacScreenHeight ) Bottom = vMacScreenHeight;
+        
+        if ( ScaleRows( &ScreenScaler, Src, Top, Bottom, &DstTop, &DstBottom ) )
+            ScreenBandsSet( OutBands, DstTop, DstBottom );
+    }
+    
+    if ( ScreenScaler.DstW ) {
+        Video_TransferBands( ScaleBuffer, &ScaledTex, OutBands );
     }
 }
 
 /*
- * Sets up the 4bpp->16bpp paletted to RGB565 conversion table.
+ * Updates the texture for the changed bands, converting
+ * only the columns from Left to Right.
  */
-void MakeTable4BPP( u16* Reds, u16* Greens, u16* Blues, int Size ) {
-    u8 l;
-    u8 h;
+void Video_UpdateTexture( u8* Src, ScreenColors* Colors, int Left, int Right, ui5b* Bands ) {
+    int Pitch = ( vMacScreenWidth << Colors->Depth ) / 8;
+    u16* TempBuffer = ( u16* ) TempTextureBuffer;
+    int Top = 0;
+    int Bottom = 0;
     int i = 0;
+    int j = 0;
     
-    for ( i = 0; i < 256; i++ ) {
-        l = i & 0x0F;
-        h = i >> 4;
-        
-        FBConvTable[ i ][ 1 ] = RGB8_to_565( Reds[ l ] >> 8, Greens[ l ] >> 8, Blues[ l ] >> 8 );
-        FBConvTable[ i ][ 0 ] = RGB8_to_565( Reds[ h ] >> 8, Greens[ h ] >> 8, Blues[ h ] >> 8 );
-    }
-}
-
-void Video_UpdateTexture( u8* Src, INFB_FORMAT Format, int Left, int Right, int Top, int Bottom ) {
-	u16* TempBuffer = ( u16 ) TempTextureBuffer;
-	int Value = 0;
-	u8* Ptr = NULL;
-	
-	/* Make sure Left and Right are on an 8 pixel boundary */
-	Left = ( Left & ~0x07 );
-	Right = ( ( Right + 8 ) & ~0x07 );
-	
-	if ( Left < 0 ) Left = 0;
-	if ( Left >= vMacScreenWidth ) Left = vMacScreenWidth;
-	
-	if ( Right < 0 ) Right = 0;
-	if ( Right >= vMacScreenWidth ) Right = vMacScreenWidth;
-	
-	if ( Top < 0 ) Top = 0;
-	if ( Top >= vMacScreenHeight ) Top = vMacScreenHeight;
-	
-	if ( Bottom < 0 ) Bottom = 0;
-	if ( Bottom >= vMacScreenHeight ) Bottom = vMacScreenHeight;
-	
-	for ( ; Top <= Bottom; Top++ ) {
-		Ptr = Src + ( Top * ( vMacScreenWidth / 8 ) ) + ( Left / 8 );
-		TempBuffer = TempTextureBuffer + ( 512 * Top * 2 ) + ( Left * 2 );
-		
-		ConvertFBTo565( Ptr, TempBuffer, ( Right - Left ), Format );
-	}
-	
-	GSPGPU_FlushDataCache( TempTextureBuffer, 512 * 512 * 2 );
-	C3D_SafeDisplayTransfer( ( u32* ) TempTextureBuffer, GX_BUFFER_DIM( 512, 512 ), ( u32* ) FBTexture.data, GX_BUFFER_DIM( 512, 512 ), TEXTURE_TRANSFER_FLAGS );
+    /* Make sure Left and Right are on an 8 pixel boundary */
+    Left = ( Left & ~0x07 );
+    Right = ( ( Right + 7 ) & ~0x07 );
+    
+    if ( Left < 0 ) Left = 0;
+    if ( Right > vMacScreenWidth ) Right = vMacScreenWidth;
+    if ( Left >= Right ) return;
+    
+    /* A new palette comes with the whole screen changed */
+    Video_SetColors( Colors );
+    
+    /*
+     * Convert every changed run. The transfer may merge runs, but
+     * the rows in between are still current in the staging buffer.
+     */
+    for ( i = 0; i < kScreenBandsN; i = j ) {
+        if ( ! ScreenBandTst( Bands, i ) ) {
+            j = i + 1;
+            continue;
+        }
+        
+        for ( j = i + 1; j < kScreenBandsN && ScreenBandTst( Bands, j ); j++ ) {
+        }
+        
+        Top = i * kScreenBandRows;
+        Bottom = j * kScreenBandRows;
+        
+        if ( Bottom > vMacScreenHeight ) Bottom = vMacScreenHeight;
+        
+        PixConvRect( &ScreenConv, Src + ( Top * Pitch ) + ( ( Left << Colors->Depth ) / 8 ), Pitch,
+            ( ui3p ) ( TempBuffer + ( 512 * Top ) + Left ), 512 * 2, Right - Left, Bottom - Top );
+    }
+    
+    Video_TransferBands( TempBuffer, &FBTexture, Bands );
+    
+    if ( Colors->Depth == 0 )
+        Scale_Update( Src, Bands );
+    
+    PresentDirty = trueblnr;
+    
+#if WantUploadStats
+    if ( ++UploadFrames == 60 ) {
+#if dbglog_HAVE
+        dbglog_writelnNum( "upload bytes per frame", UploadBytes / UploadFrames );
+        dbglog_writelnNum( "upload bands in 60 frames", UploadBands );
+#endif
+        UploadFrames = 0;
+        UploadBands = 0;
+        UploadBytes = 0;
+    }
+#endif
 }
 
 void DrawTexture( C3D_Tex* Texture, int Width, int Height, float X, float Y, float ScaleX, float ScaleY ) {
@@ -540,6 +676,24 @@ static int Video_SetupShader( void ) {
 void UI_UploadTexture32( void* ImageData, C3D_Tex* Texture, int Width, int Height ) {
     GSPGPU_FlushDataCache( ImageData, Width * Height * sizeof( rgba32 ) );
     C3D_SafeDisplayTransfer( ( u32* ) ImageData, GX_BUFFER_DIM( Width, Height ), ( u32* ) Texture->data, GX_BUFFER_DIM( Width, Height ), TEXTURE32_TRANSFER_FLAGS );
+    
+    PresentDirty = trueblnr;
+}
+
+/*
+ * Uploads only rows Top to Bottom of an image, which must be on
+ * a tile boundary. Like Video_UploadBand the transfer flips, so
+ * the rows land counting up from the bottom of the texture.
+ */
+void UI_UploadTexture32Rows( void* ImageData, C3D_Tex* Texture, int Width, int Height, int Top, int Bottom ) {
+    rgba32* Src = ( ( rgba32* ) ImageData ) + ( Width * Top );
+    
+    GSPGPU_FlushDataCache( Src, Width * ( Bottom - Top ) * sizeof( rgba32 ) );
+    C3D_SafeDisplayTransfer( ( u32* ) Src, GX_BUFFER_DIM( Width, Bottom - Top ),
+        ( u32* ) ( ( ( rgba32* ) Texture->data ) + ( Width * ( Height - Bottom ) ) ), GX_BUFFER_DIM( Width, Bottom - Top ),
+        TEXTURE32_TRANSFER_FLAGS );
+    
+    PresentDirty = trueblnr;
 }
 
 static int Video_CreateTextures( void ) {
@@ -547,9 +701,11 @@ static int Video_CreateTextures( void ) {
     
     C3D_TexInit( &FBTexture, 512, 512, GPU_RGB565 );
     C3D_TexInit( &KeyboardTex, 512, 256, GPU_RGBA8 );
+    C3D_TexInit( &ScaledTex, 512, 512, GPU_RGB565 );
     
     C3D_TexSetFilter( &FBTexture, GPU_NEAREST, GPU_NEAREST );
     C3D_TexSetFilter( &KeyboardTex, GPU_NEAREST, GPU_NEAREST );
+    C3D_TexSetFilter( &ScaledTex, GPU_NEAREST, GPU_NEAREST );
     
     Env = C3D_GetTexEnv( 0 );
     
@@ -716,8 +872,20 @@ void DebugConsoleDraw( void ) {
 }
 #endif
 
+static aptHookCookie VideoAptHook;
+
+/*
+ * Whatever was on the screens is gone after coming back
+ * from the home menu or sleep, draw it again.
+ */
+static void Video_AptHook( APT_HookType Hook, void* Param ) {
+    if ( Hook == APTHOOK_ONRESTORE || Hook == APTHOOK_ONWAKEUP )
+        PresentDirty = trueblnr;
+}
+
 int Video_Init( void ) {
     gfxInitDefault( );
+    aptHook( &VideoAptHook, Video_AptHook, NULL );
     //consoleInit( GFX_BOTTOM, NULL );
     //printf( "Hi!\n" );
     
@@ -733,6 +901,13 @@ int Video_Init( void ) {
     C3D_DepthTest( true, GPU_GEQUAL, GPU_WRITE_ALL );
     
     TempTextureBuffer = linearMemAlign( 512 * 512 * 2, 0x80 );
+    PixConvSetup( &ScreenConv, 0, kPixFmtRGB565, MonoLevels, MonoLevels, MonoLevels );
+    
+    /* The scaler is optional, without it the GPU scales as before */
+    ScaleBuffer = ( u16* ) linearMemAlign( 512 * 512 * 2, 0x80 );
+    ScaleSrc = ( u8* ) calloc( ( vMacScreenHeight * vMacScreenWidth / 8 ) + 1, 1 );
+    ScaleHCache = ( u8* ) malloc( vMacScreenHeight * vMacScreenWidth );
+    ScaleInit( &ScreenScaler, vMacScreenWidth, vMacScreenHeight, ScaleSrc, ScaleHCache, ScaleBuffer, 512 );
     
 #ifdef DEBUG_CONSOLE
     DebugConsoleInit( );
@@ -745,6 +920,15 @@ void Video_Close( void ) {
     if ( TempTextureBuffer )
         linearFree( TempTextureBuffer );
     
+    if ( ScaleBuffer )
+        linearFree( ScaleBuffer );
+    
+    if ( ScaleSrc )
+        free( ScaleSrc );
+    
+    if ( ScaleHCache )
+        free( ScaleHCache );
+    
     if ( Shader ) {
         shaderProgramFree( &Program );
         DVLB_Free( Shader );
@@ -762,8 +946,10 @@ void Video_Close( void ) {
     
     C3D_TexDelete( &FBTexture );
     C3D_TexDelete( &KeyboardTex );
+    C3D_TexDelete( &ScaledTex );
     C3D_Fini( );
     
+    aptUnhook( &VideoAptHook );
     gfxExit( );
 }
 
@@ -1097,27 +1283,600 @@ LOCALVAR blnr gBackgroundFlag = falseblnr;
 LOCALVAR blnr gTrueBackgroundFlag = falseblnr;
 LOCALVAR blnr CurSpeedStopped = trueblnr;
 
+/* --- emulation thread --- */
+
+/*
+    With UseEmThread, ProgramMain runs on a thread of its own (on
+    the extra application core of the New 3DS when there is one)
+    while the main thread only polls input and presents frames.
+    The two sides share a single producer / single consumer input
+    ring and a pair of frame slots; the emulation thread never
+    waits on either.
+*/
+
+#if UseFramePipe && ! UseEmThread
+#error "the frame pipeline needs UseEmThread"
+#endif
+
+#if UseEmThread || WantScreenCapture
+#define AtomicLoadAcq( p ) __atomic_load_n( ( p ), __ATOMIC_ACQUIRE )
+#define AtomicStoreRel( p, v ) __atomic_store_n( ( p ), ( v ), __ATOMIC_RELEASE )
+#endif
+
+#if UseEmThread
+
+enum {
+    HostEvtKey,
+    HostEvtMouseButton,
+    HostEvtMousePos,
+    HostEvtMouseDelta,
+    HostEvtMsg,
+    HostEvtMsgOff
+};
+
+typedef struct {
+    ui3b Kind;
+    blnr Down;
+    si4b H; /* key code, or mouse h */
+    si4b V;
+    char* Title;
+    char* Msg;
+} HostEvt;
+
+#define HostEvtQLg2Sz 6
+#define HostEvtQSz (1 << HostEvtQLg2Sz)
+#define HostEvtQIMask (HostEvtQSz - 1)
+
+LOCALVAR HostEvt HostEvtQA[ HostEvtQSz ];
+LOCALVAR ui5r HostEvtQIn = 0; /* written only by the main thread */
+LOCALVAR ui5r HostEvtQOut = 0; /* written only by the emulation thread */
+LOCALVAR blnr HostEvtQLost = falseblnr;
+LOCALVAR blnr HostRequestOff = falseblnr;
+LOCALVAR blnr EmThreadRunning = falseblnr;
+    /* else ProgramMain runs on the main thread, see main */
+LOCALVAR blnr HostMouseButtonState = falseblnr;
+
+/* Main thread side. When the ring is full the event is dropped
+   and the emulation thread releases all keys, as MyEvtQ does. */
+LOCALPROC HostEvtQPush( ui3r Kind, blnr Down, si4b H, si4b V,
+    char* Title, char* Msg )
+{
+    ui5r In = HostEvtQIn;
+    HostEvt* p;
+    
+    if ( ( In - AtomicLoadAcq( &HostEvtQOut ) ) >= HostEvtQSz ) {
+        AtomicStoreRel( &HostEvtQLost, trueblnr );
+    } else {
+        p = &HostEvtQA[ In & HostEvtQIMask ];
+        p->Kind = Kind;
+        p->Down = Down;
+        p->H = H;
+        p->V = V;
+        p->Title = Title;
+        p->Msg = Msg;
+        AtomicStoreRel( &HostEvtQIn, In + 1 );
+    }
+}
+
+LOCALPROC HostKeyEvent( int key, blnr down ) {
+    HostEvtQPush( HostEvtKey, down, key, 0, nullpr, nullpr );
+}
+
+LOCALPROC HostMouseButton( blnr down ) {
+    if ( down != HostMouseButtonState ) {
+        HostMouseButtonState = down;
+        HostEvtQPush( HostEvtMouseButton, down, 0, 0, nullpr, nullpr );
+    }
+}
+
+LOCALPROC HostMousePositionSet( ui4r h, ui4r v ) {
+    HostEvtQPush( HostEvtMousePos, falseblnr, h, v, nullpr, nullpr );
+}
+
+LOCALPROC HostMousePositionSetDelta( ui4r dh, ui4r dv ) {
+    HostEvtQPush( HostEvtMouseDelta, falseblnr, dh, dv, nullpr, nullpr );
+}
+
+LOCALPROC HostMacMsg( char* Title, char* Msg ) {
+    HostEvtQPush( HostEvtMsg, falseblnr, 0, 0, Title, Msg );
+}
+
+LOCALPROC HostMacMsgDisplayOff( void ) {
+    HostEvtQPush( HostEvtMsgOff, falseblnr, 0, 0, nullpr, nullpr );
+}
+
+LOCALPROC HostForceMacOff( void ) {
+    AtomicStoreRel( &HostRequestOff, trueblnr );
+}
+
+/* Emulation thread side, feeds the queued input into MyEvtQ. */
+LOCALPROC EmThreadTakeInput( void ) {
+    ui5r Out = HostEvtQOut;
+    ui5r In = AtomicLoadAcq( &HostEvtQIn );
+    HostEvt* p;
+    
+    while ( Out != In ) {
+        p = &HostEvtQA[ Out & HostEvtQIMask ];
+        switch ( p->Kind ) {
+            case HostEvtKey:
+                Keyboard_UpdateKeyMap2( p->H, p->Down );
+                break;
+            case HostEvtMouseButton:
+                MyMouseButtonSet( p->Down );
+                break;
+            case HostEvtMousePos:
+                MyMousePositionSet( p->H, p->V );
+                break;
+            case HostEvtMouseDelta:
+                MyMousePositionSetDelta( p->H, p->V );
+                break;
+            case HostEvtMsg:
+                MacMsg( p->Title, p->Msg, falseblnr );
+                break;
+            case HostEvtMsgOff:
+                MacMsgDisplayOff( );
+                break;
+            default:
+                break;
+        }
+        ++Out;
+        AtomicStoreRel( &HostEvtQOut, Out );
+    }
+    
+    if ( __atomic_exchange_n( &HostEvtQLost, falseblnr, __ATOMIC_ACQ_REL ) )
+        MyEvtQNeedRecover = trueblnr;
+    
+    if ( AtomicLoadAcq( &HostRequestOff ) )
+        ForceMacOff = trueblnr;
+}
+
+/*
+    Frame handoff. The emulation thread copies the changed bands
+    of rows into the slot it owns and accumulates them; when the
+    presenter has consumed the last frame it publishes that slot
+    and moves to the other one. Bands written into one slot are
+    remembered as stale in the other and caught up on its next fill,
+    so each fill only copies the rows that differ from the screen.
+
+    The diff (ScreenFindChanges) and this copy run on the emulation
+    thread, the conversion and upload on the presenter (EmFrameTake).
+    With UseFramePipe, frames go to the frame pipeline below instead
+    whenever they can.
+*/
+
+LOCALVAR ui3p EmFrameBuff[ 2 ];
+LOCALVAR ScreenColors EmFrameColors[ 2 ];
+LOCALVAR ui5b EmFrameStale[ 2 ][ kScreenBandWords ];
+LOCALVAR ui3r EmFrameFill = 0;
+
+LOCALVAR blnr EmFramePending = falseblnr;
+LOCALVAR ui4r EmFrameLeft;
+LOCALVAR ui4r EmFrameRight;
+LOCALVAR ui5b EmFrameBands[ kScreenBandWords ];
+
+/* owned by the presenter while EmFrameReady is set */
+LOCALVAR ui3r EmFramePub;
+LOCALVAR ui4r EmFramePubLeft;
+LOCALVAR ui4r EmFramePubRight;
+LOCALVAR ui5b EmFramePubBands[ kScreenBandWords ];
+LOCALVAR blnr EmFrameReady = falseblnr;
+
+#if EnableFrameGovernor
+/* presenter cost of a whole screen in microseconds, for the governor */
+LOCALVAR ui5r EmFrameTakeCost = 0;
+#endif
+
+LOCALPROC EmFrameZap( void ) {
+    int i;
+    
+    for ( i = 0; i < kScreenBandWords; ++i )
+        EmFrameStale[ 0 ][ i ] = EmFrameStale[ 1 ][ i ] = 0;
+    
+    ScreenBandsSet( EmFrameStale[ 0 ], 0, vMacScreenHeight );
+    ScreenBandsSet( EmFrameStale[ 1 ], 0, vMacScreenHeight );
+}
+
+/* Copies each run of bands set in Bands into Dst. */
+LOCALPROC EmFrameCopyBands( ui3p Dst, ui5b* Bands ) {
+    ui3p Src = GetCurDrawBuff( );
+    uimr top;
+    uimr bottom;
+    int i = 0;
+    int j;
+    
+    while ( i < kScreenBandsN ) {
+        if ( ! ScreenBandTst( Bands, i ) ) {
+            ++i;
+            continue;
+        }
+        for ( j = i + 1; j < kScreenBandsN && ScreenBandTst( Bands, j ); ++j ) {
+        }
+        
+        top = i * kScreenBandRows;
+        bottom = j * kScreenBandRows;
+        if ( bottom > vMacScreenHeight )
+            bottom = vMacScreenHeight;
+        
+        MyMoveBytes( ( anyp ) Src + top * vMacScreenByteWidth,
+            ( anyp ) Dst + top * vMacScreenByteWidth,
+            ( bottom - top ) * vMacScreenByteWidth );
+        
+        i = j;
+    }
+}
+
+LOCALPROC EmFrameFillRows( ui4r left, ui4r right, ui5b* bands ) {
+    ui3r w = EmFrameFill;
+    ui5b copy[ kScreenBandWords ];
+    int i;
+    
+    for ( i = 0; i < kScreenBandWords; ++i ) {
+        copy[ i ] = bands[ i ] | EmFrameStale[ w ][ i ];
+        EmFrameStale[ w ][ i ] = 0;
+        EmFrameStale[ w ^ 1 ][ i ] |= bands[ i ];
+    }
+    EmFrameCopyBands( EmFrameBuff[ w ], copy );
+    GetCurScreenColors( &EmFrameColors[ w ] );
+    
+    if ( EmFramePending ) {
+        if ( left < EmFrameLeft ) EmFrameLeft = left;
+        if ( right > EmFrameRight ) EmFrameRight = right;
+        for ( i = 0; i < kScreenBandWords; ++i )
+            EmFrameBands[ i ] |= bands[ i ];
+    } else {
+        EmFrameLeft = left;
+        EmFrameRight = right;
+        for ( i = 0; i < kScreenBandWords; ++i )
+            EmFrameBands[ i ] = bands[ i ];
+        EmFramePending = trueblnr;
+    }
+}
+
+LOCALPROC EmFramePublish( void ) {
+    int i;
+    
+    if ( EmFramePending && ! AtomicLoadAcq( &EmFrameReady ) ) {
+        EmFramePub = EmFrameFill;
+        EmFramePubLeft = EmFrameLeft;
+        EmFramePubRight = EmFrameRight;
+        for ( i = 0; i < kScreenBandWords; ++i )
+            EmFramePubBands[ i ] = EmFrameBands[ i ];
+        AtomicStoreRel( &EmFrameReady, trueblnr );
+        
+        EmFrameFill ^= 1;
+        EmFramePending = falseblnr;
+    }
+}
+
+#if UseFramePipe
+
+/*
+    Frame pipeline, see src/FRAMEPIPE.c. The emulation thread only
+    copies the frame into FramePipeSnap and wakes a pool of workers,
+    which compare it with screencomparebuff, bring that up to date
+    and convert the changed columns of their bands straight into
+    TempTextureBuffer. The last one done marks the frame done, and
+    the presenter transfers the bands and sets the pipeline idle.
+
+    While the workers are at it they own screencomparebuff and the
+    staging buffer, so the emulation thread skips frames (the next
+    one is compared with the last one finished, so nothing is lost)
+    and holds back drawing the control mode. Frames with the control
+    mode showing, or with changes still on their way through the
+    frame handoff above, go that way instead, so the two never
+    overtake each other.
+
+    The workers go on core 1, which an application may have a share
+    of, and the cores the other two threads are on. A worker flushes
+    what it converted itself, as a flush by address only reaches the
+    data cache of the core it runs on.
+*/
+
+#if 0 != vMacScreenDepth
+#error "the frame pipeline only handles the 1bpp screen"
+#endif
+
+#if WantScreenCapture
+#error "screen capture needs the compare on the emulation thread"
+#endif
+
+#ifndef kFramePipeWorkers
+#define kFramePipeWorkers 2
+#endif
+
+#if ( kFramePipeWorkers < 1 ) || ( kFramePipeWorkers > kFramePipeMaxWorkers )
+#error "kFramePipeWorkers must be 1 to kFramePipeMaxWorkers"
+#endif
+
+#if kScreenBandsN > kFramePipeMaxBands
+#error "too many bands for the frame pipeline"
+#endif
+
+#define FramePipeStackSize 0x2000
+
+enum {
+    kFramePipeIdle,
+    kFramePipeBusy, /* the workers have it */
+    kFramePipeDone /* the presenter has it */
+};
+
+LOCALVAR FramePipe ScreenPipe;
+LOCALVAR ui3p FramePipeSnap = NULL;
+LOCALVAR Thread FramePipeThread[ kFramePipeWorkers ];
+LOCALVAR LightEvent FramePipeGo[ kFramePipeWorkers ];
+LOCALVAR uimr FramePipeNum[ kFramePipeWorkers ];
+LOCALVAR uimr FramePipeThreads = 0;
+LOCALVAR ui5r FramePipeLeft = 0;
+LOCALVAR ui5r FramePipeState = kFramePipeIdle;
+LOCALVAR blnr FramePipeStop = falseblnr;
+
+/* emulation side, a frame was handed over and not looked at since */
+LOCALVAR blnr FramePipeOwed = falseblnr;
+
+#define FramePipeBusyNow( ) ( AtomicLoadAcq( &FramePipeState ) != kFramePipeIdle )
+
+/* Flushes the bands worker w converted */
+LOCALPROC FramePipeFlush( uimr w ) {
+    u16* Buffer = ( u16* ) TempTextureBuffer;
+    ui5b* Bands = ScreenPipe.Slice[ w ].Bands;
+    int i;
+    
+    for ( i = w; i < kScreenBandsN; i+= FramePipeThreads ) {
+        if ( ScreenBandTst( Bands, i ) ) {
+            GSPGPU_FlushDataCache( Buffer + ( 512 * i * kScreenBandRows ),
+                512 * kScreenBandRows * 2 );
+        }
+    }
+}
+
+LOCALPROC FramePipeMain( void* Arg ) {
+    uimr w = *( uimr* ) Arg;
+    
+    for ( ; ; ) {
+        LightEvent_Wait( &FramePipeGo[ w ] );
+        if ( AtomicLoadAcq( &FramePipeStop ) )
+            break;
+        
+        FramePipeWork( &ScreenPipe, w );
+        FramePipeFlush( w );
+        
+        if ( __atomic_sub_fetch( &FramePipeLeft, 1, __ATOMIC_ACQ_REL ) == 0 )
+            AtomicStoreRel( &FramePipeState, kFramePipeDone );
+    }
+}
+
+/*
+    Without any workers the pipeline stays off, and every frame
+    goes the way it does without UseFramePipe.
+*/
+LOCALPROC FramePipeBegin( void ) {
+    s32 Prio = 0x30;
+    bool IsNew3DS = false;
+    int Core;
+    int w;
+    
+    FramePipeSnap = ( ui3p ) malloc( vMacScreenMonoNumBytes );
+    if ( FramePipeSnap == NULL || TempTextureBuffer == NULL )
+        return;
+    
+    FramePipeSetup( &ScreenPipe, vMacScreenWidth, vMacScreenHeight,
+        kScreenBandRows, screencomparebuff, ( ui3p ) TempTextureBuffer,
+        512 * 2, &ScreenConv );
+    
+    /* the same as the emulation thread */
+    svcGetThreadPriority( &Prio, CUR_THREAD_HANDLE );
+    if ( Prio < 0x3F )
+        Prio++;
+    
+    APT_CheckNew3DS( &IsNew3DS );
+    APT_SetAppCpuTimeLimit( 30 );
+    
+    for ( w = 0; w < kFramePipeWorkers; ++w ) {
+        Core = ( w & 1 ) ? ( IsNew3DS ? 2 : 0 ) : 1;
+        
+        LightEvent_Init( &FramePipeGo[ FramePipeThreads ], RESET_ONESHOT );
+        FramePipeNum[ FramePipeThreads ] = FramePipeThreads;
+        
+        FramePipeThread[ FramePipeThreads ] = threadCreate( FramePipeMain,
+            &FramePipeNum[ FramePipeThreads ], FramePipeStackSize, Prio, Core, false );
+        if ( FramePipeThread[ FramePipeThreads ] == NULL ) {
+            FramePipeThread[ FramePipeThreads ] = threadCreate( FramePipeMain,
+                &FramePipeNum[ FramePipeThreads ], FramePipeStackSize, Prio, -2, false );
+        }
+        
+        if ( FramePipeThread[ FramePipeThreads ] != NULL )
+            ++FramePipeThreads;
+    }
+}
+
+/* Called once the emulation thread is done */
+LOCALPROC FramePipeEnd( void ) {
+    uimr w;
+    
+    AtomicStoreRel( &FramePipeStop, trueblnr );
+    for ( w = 0; w < FramePipeThreads; ++w )
+        LightEvent_Signal( &FramePipeGo[ w ] );
+    
+    for ( w = 0; w < FramePipeThreads; ++w ) {
+        threadJoin( FramePipeThread[ w ], U64_MAX );
+        threadFree( FramePipeThread[ w ] );
+    }
+    FramePipeThreads = 0;
+    
+    if ( FramePipeSnap )
+        free( FramePipeSnap );
+    
+    FramePipeSnap = NULL;
+}
+
+/* Emulation side, called from Screen_OutputFrame */
+LOCALFUNC blnr ScreenPipeFrame( ui3p screencurrentbuff ) {
+    ui5r State;
+#if EnableAutoSlow
+    uimr Top;
+    uimr Left;
+    uimr Bottom;
+    uimr Right;
+#endif
+    uimr w;
+    
+    if ( FramePipeThreads == 0 )
+        return falseblnr;
+    
+    State = AtomicLoadAcq( &FramePipeState );
+    if ( State == kFramePipeBusy )
+        return trueblnr;
+    
+    /* what the last frame changed, once it is finished */
+    if ( FramePipeOwed ) {
+        FramePipeOwed = falseblnr;
+#if EnableAutoSlow
+        if ( FramePipeResult( &ScreenPipe, nullpr, &Top, &Left, &Bottom, &Right ) )
+            ScreenQuietAdd( Top, Left, Bottom, Right );
+#endif
+    }
+    
+    if ( State != kFramePipeIdle )
+        return trueblnr;
+    
+    if ( SpecialModes != 0 || CntrlShowing
+        || ScreenChangedBottom > ScreenChangedTop
+        || EmFramePending || AtomicLoadAcq( &EmFrameReady ) )
+    {
+        return falseblnr;
+    }
+    
+    MyMoveBytes( ( anyp ) screencurrentbuff, ( anyp ) FramePipeSnap,
+        vMacScreenMonoNumBytes );
+    FramePipeStart( &ScreenPipe, FramePipeSnap, FramePipeThreads );
+    FramePipeOwed = trueblnr;
+    
+    AtomicStoreRel( &FramePipeLeft, FramePipeThreads );
+    AtomicStoreRel( &FramePipeState, kFramePipeBusy );
+    for ( w = 0; w < FramePipeThreads; ++w )
+        LightEvent_Signal( &FramePipeGo[ w ] );
+    
+    return trueblnr;
+}
+
+/* Presenter side, transfers a frame the workers finished */
+LOCALPROC FramePipeTake( void ) {
+    ui5b Bands[ kScreenBandWords ];
+    uimr Top;
+    uimr Left;
+    uimr Bottom;
+    uimr Right;
+    
+    if ( AtomicLoadAcq( &FramePipeState ) != kFramePipeDone )
+        return;
+    
+    if ( FramePipeResult( &ScreenPipe, Bands, &Top, &Left, &Bottom, &Right ) ) {
+        Video_TransferBands( ( u16* ) TempTextureBuffer, &FBTexture, Bands );
+        Scale_Update( FramePipeSnap, Bands );
+        PresentDirty = trueblnr;
+    }
+    
+    AtomicStoreRel( &FramePipeState, kFramePipeIdle );
+}
+
+#endif /* UseFramePipe */
+
+#if EnableFrameGovernor
+LOCALFUNC ui4r EmFramePubRows( void ) {
+    ui4r n = 0;
+    int i;
+    
+    for ( i = 0; i < kScreenBandsN; ++i ) {
+        if ( ScreenBandTst( EmFramePubBands, i ) )
+            n += kScreenBandRows;
+    }
+    
+    return ( n > vMacScreenHeight ) ? vMacScreenHeight : n;
+}
+#endif
+
+/* Presenter side, called on the main thread before drawing. */
+LOCALPROC EmFrameTake( void ) {
+#if EnableFrameGovernor
+    ui5r t0;
+    ui5r Rows;
+#endif
+    
+    if ( AtomicLoadAcq( &EmFrameReady ) ) {
+#if EnableFrameGovernor
+        t0 = GetHostMicroseconds( );
+#endif
+        Video_UpdateTexture( ( u8* ) EmFrameBuff[ EmFramePub ],
+            &EmFrameColors[ EmFramePub ], EmFramePubLeft, EmFramePubRight,
+            EmFramePubBands );
+#if EnableFrameGovernor
+        /* scaled to a whole screen, as the governor wants */
+        Rows = EmFramePubRows( );
+        if ( Rows != 0 ) {
+            AtomicStoreRel( &EmFrameTakeCost,
+                ( GetHostMicroseconds( ) - t0 ) * vMacScreenHeight / Rows );
+        }
+#endif
+        AtomicStoreRel( &EmFrameReady, falseblnr );
+    }
+    
+#if UseFramePipe
+    /* after, as a frame of the handoff is always the older */
+    FramePipeTake( );
+#endif
+}
+
+#else
+
+#define HostKeyEvent Keyboard_UpdateKeyMap2
+#define HostMouseButton MyMouseButtonSet
+#define HostMousePositionSet MyMousePositionSet
+#define HostMousePositionSetDelta MyMousePositionSetDelta
+#define HostMacMsg( Title, Msg ) MacMsg( Title, Msg, falseblnr )
+#define HostMacMsgDisplayOff MacMsgDisplayOff
+#define HostForceMacOff( ) ( ForceMacOff = trueblnr )
+
+#endif
+
 #if EnableMagnify
 #define MaxScale MyWindowScale
 #else
 #define MaxScale 1
 #endif
 
+#if ! UseEmThread
 LOCALPROC HaveChangedScreenBuff(ui4r top, ui4r left,
 	ui4r bottom, ui4r right)
 {
-#if vMacScreenDepth < 2
-	Video_UpdateTexture( ( u8* ) GetCurDrawBuff( ), INFB_FORMAT_1BPP, left, right, top, bottom );
-#endif
+	ScreenColors Colors;
+
+	GetCurScreenColors(&Colors);
+	Video_UpdateTexture( ( u8* ) GetCurDrawBuff( ), &Colors, left, right, ScreenChangedBands );
 }
+#endif
 
 LOCALPROC MyDrawChangesAndClear(void)
 {
+#if UseFramePipe
+	/* the workers have screencomparebuff, the changes can wait */
+	if (FramePipeBusyNow()) {
+		return;
+	}
+#endif
 	if (ScreenChangedBottom > ScreenChangedTop) {
+		CntrlComposite(ScreenChangedTop, ScreenChangedBottom);
+#if UseEmThread
+		EmFrameFillRows(ScreenChangedLeft, ScreenChangedRight,
+			ScreenChangedBands);
+#else
 		HaveChangedScreenBuff(ScreenChangedTop, ScreenChangedLeft,
 			ScreenChangedBottom, ScreenChangedRight);
+#endif
 		ScreenClearChanges();
 	}
+#if UseEmThread
+	EmFramePublish();
+#endif
 }
 
 GLOBALPROC DoneWithDrawingForTick(void)
@@ -1130,6 +1889,247 @@ GLOBALPROC DoneWithDrawingForTick(void)
 	MyDrawChangesAndClear();
 }
 
+/* --- screen capture --- */
+
+/*
+    With WantScreenCapture, everything the emulated screen shows
+    is recorded to ScreenCaptureFile, for regression and performance
+    work. tools/capdec.c turns the recording back into frames.
+
+    The file is gzip compressed. It starts with "vMSC", a u8 version
+    and u16 width and height, followed by records of a kind byte and
+    the u32 emulated tick (OnTrueTime) they were shown at:
+        'K' keyframe, then the whole 1bpp screen
+        'D' delta, then a u8 rectangle count and for each rectangle
+            u16 top, bottom, first byte and byte count, followed
+            by those bytes of each of its rows
+        'E' end of the recording
+    All numbers are little endian.
+
+    The emulation side only copies the changed spans into a ring,
+    a writer thread of lower priority compresses and writes them. If
+    the ring is full the frame is dropped and the next one becomes a
+    keyframe, so a slow card loses frames rather than emulated time.
+*/
+
+#if WantScreenCapture
+
+#if 0 != vMacScreenDepth
+#error "screen capture only handles the 1bpp screen"
+#endif
+
+#define ScreenCaptureFile "capture.vms.gz"
+#define kCaptureVersion 1
+
+#define kCaptureRingSize 0x40000 /* a power of two */
+#define kCaptureKeyTicks 600 /* a keyframe at least every 10 seconds */
+#define CaptureThreadStackSize 0x4000
+
+LOCALVAR gzFile CaptureFile = NULL;
+LOCALVAR Thread CaptureThread = NULL;
+LOCALVAR u8* CaptureRing = NULL;
+LOCALVAR ui5r CaptureIn = 0;
+LOCALVAR ui5r CaptureOut = 0;
+LOCALVAR blnr CaptureStop = falseblnr;
+LOCALVAR blnr CaptureNeedKey = trueblnr;
+LOCALVAR ui5b CaptureKeyTime = 0;
+LOCALVAR ui5r CaptureDropped = 0;
+
+LOCALFUNC ui5r CaptureFree( ui5r In ) {
+    return kCaptureRingSize - ( In - AtomicLoadAcq( &CaptureOut ) );
+}
+
+LOCALPROC CapturePut( ui5r* In, const u8* Src, ui5r Size ) {
+    ui5r At = *In & ( kCaptureRingSize - 1 );
+    ui5r n = kCaptureRingSize - At;
+    
+    if ( n > Size ) n = Size;
+    
+    memcpy( CaptureRing + At, Src, n );
+    memcpy( CaptureRing, Src + n, Size - n );
+    
+    *In+= Size;
+}
+
+LOCALPROC CapturePutNum( ui5r* In, ui5r Value, int Bytes ) {
+    u8 Buffer[ 4 ];
+    int i = 0;
+    
+    for ( i = 0; i < Bytes; i++ ) {
+        Buffer[ i ] = Value & 0xFF;
+        Value>>= 8;
+    }
+    
+    CapturePut( In, Buffer, Bytes );
+}
+
+/* Emulation side, called from Screen_OutputFrame */
+LOCALPROC ScreenCaptureFrame( void ) {
+    ui5r In = CaptureIn;
+    ui5r Size = 0;
+    uimr First = 0;
+    uimr Count = 0;
+    uimr Row = 0;
+    uimr i = 0;
+    blnr Key = falseblnr;
+    
+    if ( CaptureRing == NULL )
+        return;
+    
+    Key = CaptureNeedKey || ( ( OnTrueTime - CaptureKeyTime ) >= kCaptureKeyTicks );
+    
+    if ( ! Key && 0 == ScrnSpanN )
+        return;
+    
+    /* Size it up first, records go in whole or not at all */
+    if ( Key ) {
+        Size = 5 + vMacScreenMonoNumBytes;
+    } else {
+        Size = 6;
+        
+        for ( i = 0; i < ScrnSpanN; i++ ) {
+            Count = ( ( ScrnSpanRight[ i ] + 7 ) >> 3 ) - ( ScrnSpanLeft[ i ] >> 3 );
+            Size+= 8 + ( ( ScrnSpanBottom[ i ] - ScrnSpanTop[ i ] ) * Count );
+        }
+    }
+    
+    if ( CaptureFree( In ) < Size ) {
+        CaptureNeedKey = trueblnr;
+        CaptureDropped++;
+        return;
+    }
+    
+    CapturePutNum( &In, Key ? 'K' : 'D', 1 );
+    CapturePutNum( &In, OnTrueTime, 4 );
+    
+    if ( Key ) {
+        CapturePut( &In, screencomparebuff, vMacScreenMonoNumBytes );
+        
+        CaptureNeedKey = falseblnr;
+        CaptureKeyTime = OnTrueTime;
+    } else {
+        CapturePutNum( &In, ScrnSpanN, 1 );
+        
+        for ( i = 0; i < ScrnSpanN; i++ ) {
+            First = ScrnSpanLeft[ i ] >> 3;
+            Count = ( ( ScrnSpanRight[ i ] + 7 ) >> 3 ) - First;
+            
+            CapturePutNum( &In, ScrnSpanTop[ i ], 2 );
+            CapturePutNum( &In, ScrnSpanBottom[ i ], 2 );
+            CapturePutNum( &In, First, 2 );
+            CapturePutNum( &In, Count, 2 );
+            
+            for ( Row = ScrnSpanTop[ i ]; Row < ScrnSpanBottom[ i ]; Row++ ) {
+                CapturePut( &In, screencomparebuff + ( Row * vMacScreenMonoByteWidth ) + First, Count );
+            }
+        }
+    }
+    
+    AtomicStoreRel( &CaptureIn, In );
+}
+
+LOCALPROC CaptureThreadMain( void* Arg ) {
+    ui5r Out = CaptureOut;
+    ui5r In = 0;
+    ui5r n = 0;
+    blnr Stop = falseblnr;
+    
+    UnusedParam( Arg );
+    
+    for ( ; ; ) {
+        /* Stop is read first, so whatever came before it is written */
+        Stop = AtomicLoadAcq( &CaptureStop );
+        In = AtomicLoadAcq( &CaptureIn );
+        
+        if ( In == Out ) {
+            if ( Stop )
+                break;
+            
+            svcSleepThread( 8 * 1000000LL );
+            continue;
+        }
+        
+        n = kCaptureRingSize - ( Out & ( kCaptureRingSize - 1 ) );
+        if ( n > ( In - Out ) )
+            n = In - Out;
+        
+        gzwrite( CaptureFile, CaptureRing + ( Out & ( kCaptureRingSize - 1 ) ), n );
+        
+        Out+= n;
+        AtomicStoreRel( &CaptureOut, Out );
+    }
+}
+
+/*
+    A capture that can not start leaves the emulator running
+    without one. The writer runs below the emulation thread, so on
+    the Old 3DS it only gets the time both other threads are waiting.
+*/
+LOCALPROC ScreenCaptureStart( void ) {
+    u8 Header[ 9 ] = {
+        'v', 'M', 'S', 'C', kCaptureVersion,
+        vMacScreenWidth & 0xFF, vMacScreenWidth >> 8,
+        vMacScreenHeight & 0xFF, vMacScreenHeight >> 8
+    };
+    s32 Prio = 0x30;
+    
+    CaptureRing = ( u8* ) malloc( kCaptureRingSize );
+    CaptureFile = gzopen( ScreenCaptureFile, "wb1" );
+    
+    if ( CaptureRing && CaptureFile && gzwrite( CaptureFile, Header, sizeof( Header ) ) == sizeof( Header ) ) {
+        svcGetThreadPriority( &Prio, CUR_THREAD_HANDLE );
+        Prio+= 2;
+        if ( Prio > 0x3F )
+            Prio = 0x3F;
+        
+        CaptureThread = threadCreate( CaptureThreadMain, NULL, CaptureThreadStackSize, Prio, -2, false );
+    }
+    
+    if ( CaptureThread == NULL ) {
+        if ( CaptureFile )
+            gzclose( CaptureFile );
+        
+        if ( CaptureRing )
+            free( CaptureRing );
+        
+        CaptureFile = NULL;
+        CaptureRing = NULL;
+    }
+}
+
+/* Called once the emulation side is done */
+LOCALPROC ScreenCaptureStop( void ) {
+    ui5r In = CaptureIn;
+    
+    if ( CaptureRing == NULL )
+        return;
+    
+    while ( CaptureFree( In ) < 5 ) {
+        svcSleepThread( 1000000LL );
+    }
+    
+    CapturePutNum( &In, 'E', 1 );
+    CapturePutNum( &In, OnTrueTime, 4 );
+    AtomicStoreRel( &CaptureIn, In );
+    
+    AtomicStoreRel( &CaptureStop, trueblnr );
+    threadJoin( CaptureThread, U64_MAX );
+    threadFree( CaptureThread );
+    
+    gzclose( CaptureFile );
+    free( CaptureRing );
+    
+    CaptureThread = NULL;
+    CaptureFile = NULL;
+    CaptureRing = NULL;
+    
+#if dbglog_HAVE
+    dbglog_writelnNum( "capture frames dropped", CaptureDropped );
+#endif
+}
+
+#endif
+
 /* --- mouse --- */
 
 
@@ -1363,10 +2363,6 @@ LOCALPROC KeyboardSetTexture( rgba32* Image ) {
     UI_UploadTexture32( Keyboard_Current_Image, &KeyboardTex, 512, 256 );
 }
 
-LOCALPROC KeyboardUpdateTexture( void ) {
-    KeyboardSetTexture( Keyboard_Current_Image );
-}
-
 LOCALPROC KeyboardSetState( KeyboardState State ) {
     KeyboardSetTexture( KeyboardGetImage( State ) );
     KeyboardCurrentState = State;
@@ -1460,6 +2456,8 @@ LOCALPROC InvertKeyboardTiles( int TileToInvert ) {
     int TileTopPx = 0;
     int TileX = 0;
     int TileY = 0;
+    int Top = Map_Height * 8;
+    int Bottom = 0;
     
     for ( TileY = 0; TileY < Map_Height; TileY++ ) {
         for ( TileX = 0; TileX < Map_Width; TileX++ ) {
@@ -1468,11 +2466,16 @@ LOCALPROC InvertKeyboardTiles( int TileToInvert ) {
                 TileTopPx = TileY * 8;
                 
                 InvertKeyboardPixels( Keyboard_Current_Image, TileLeftPx, TileLeftPx + 8, TileTopPx, TileTopPx + 8 );
+                
+                if ( TileTopPx < Top ) Top = TileTopPx;
+                if ( TileTopPx + 8 > Bottom ) Bottom = TileTopPx + 8;
             }
         }
     }
     
-    KeyboardUpdateTexture( );
+    /* Only the rows of tiles holding the key go up */
+    if ( Bottom > Top )
+        UI_UploadTexture32Rows( Keyboard_Current_Image, &KeyboardTex, 512, 256, Top, Bottom );
 }
 
 /* Returns a character from the on screen keyboard map from where
@@ -1595,18 +2598,18 @@ LOCALPROC ToggleStickyKey( si3b MacKey, blnr Down, blnr* KeyState ) {
         return;
     
     if ( Down == trueblnr ) {
-        if ( *KeyState == falseblnr ) Keyboard_UpdateKeyMap2( MacKey, trueblnr );
-        else Keyboard_UpdateKeyMap2( MacKey, falseblnr );
+        if ( *KeyState == falseblnr ) HostKeyEvent( MacKey, trueblnr );
+        else HostKeyEvent( MacKey, falseblnr );
         
         *KeyState = ! *KeyState;
     }
 }
 
 LOCALPROC ResetSpecialKeys( void ) {
-    Keyboard_UpdateKeyMap2( MKC_Shift, falseblnr );
-    Keyboard_UpdateKeyMap2( MKC_CapsLock, falseblnr );
-    Keyboard_UpdateKeyMap2( MKC_Option, falseblnr );
-    Keyboard_UpdateKeyMap2( MKC_Command, falseblnr );
+    HostKeyEvent( MKC_Shift, falseblnr );
+    HostKeyEvent( MKC_CapsLock, falseblnr );
+    HostKeyEvent( MKC_Option, falseblnr );
+    HostKeyEvent( MKC_Command, falseblnr );
     
     KeyboardShiftState = falseblnr;
     KeyboardCapsState = falseblnr;
@@ -1680,7 +2683,7 @@ LOCALPROC DoKeyCode( int Key, blnr Down ) {
             default: break;
         };
         
-        Keyboard_UpdateKeyMap2( MacKey, Down );
+        HostKeyEvent( MacKey, Down );
         InvertKeyboardTiles( Key );
     }
 }
@@ -1726,90 +2729,240 @@ LOCALPROC DisconnectKeyCodes3(void)
 
 #define dbglog_TimeStuff (1 && dbglog_HAVE)
 
+#ifndef WantVSyncPacing
+#define WantVSyncPacing 0
+#endif
+
+#ifndef WantPaceStats
+#define WantPaceStats 0
+#endif
+
 LOCALVAR ui5b TrueEmulatedTime = 0;
 
+/*
+    Pacing. Time is counted in ARM11 system ticks, read with
+    svcGetSystemTick, which is much cheaper than the date and time
+    page that osGetTime goes through, so ExtraTimeNotOver can be
+    called for every extra sub tick. NextTickTime is when the next
+    emulated tick (1/60.14742 s) is due, and the emulation sleeps
+    until then rather than spinning.
+*/
+
 #define MyInvTimeDivPow 16
 #define MyInvTimeDiv (1 << MyInvTimeDivPow)
 #define MyInvTimeDivMask (MyInvTimeDiv - 1)
-#define MyInvTimeStep 1089590 /* 1000 / 60.14742 * MyInvTimeDiv */
+#define MyInvTimeStep \
+    ( ( u64 ) SYSCLOCK_ARM11 * 100000 * MyInvTimeDiv / 6014742 )
+    /* SYSCLOCK_ARM11 / 60.14742 * MyInvTimeDiv */
+#define MyEmTickTicks ( MyInvTimeStep >> MyInvTimeDivPow )
+#define MyMSTicks ( SYSCLOCK_ARM11 / 1000 )
 
-typedef unsigned int Uint32;
+LOCALVAR u64 NextTickTime;
+LOCALVAR ui5b NextFracTime;
 
-LOCALVAR Uint32 LastTime;
+#if WantPaceStats
+/*
+    How late each tick started, in units of 100us,
+    and how many ticks were given up on.
+*/
+#define kPaceHistSz 64
 
-LOCALVAR Uint32 NextIntTime;
-LOCALVAR ui5b NextFracTime;
+LOCALVAR ui5b PaceHist[ kPaceHistSz + 1 ];
+LOCALVAR ui5b PaceCount = 0;
+LOCALVAR u64 PaceSum = 0;
+LOCALVAR ui5b PaceDropped = 0;
+LOCALVAR u64 PaceDue;
+
+LOCALPROC PaceStatsNtfy( void ) {
+    u64 Late = svcGetSystemTick( ) - PaceDue;
+    ui5b i = Late / ( MyMSTicks / 10 );
+    
+    if ( i > kPaceHistSz )
+        i = kPaceHistSz;
+    
+    ++PaceHist[ i ];
+    ++PaceCount;
+    PaceSum += Late;
+}
+
+LOCALPROC PaceStatsSecondNotify( void ) {
+    ui5b i;
+    ui5b n = 0;
+    
+    if ( 0 != PaceCount ) {
+        for ( i = 0; i < kPaceHistSz; ++i ) {
+            n += PaceHist[ i ];
+            if ( n * 100 >= PaceCount * 99 )
+                break;
+        }
+#if dbglog_HAVE
+        dbglog_writelnNum( "pace mean us",
+            ( ui5b ) ( PaceSum * 1000 / MyMSTicks / PaceCount ) );
+        dbglog_writelnNum( "pace p99 us", ( i + 1 ) * 100 );
+        dbglog_writelnNum( "pace dropped ticks", PaceDropped );
+#endif
+    }
+    
+    for ( i = 0; i <= kPaceHistSz; ++i )
+        PaceHist[ i ] = 0;
+    
+    PaceCount = 0;
+    PaceSum = 0;
+    PaceDropped = 0;
+}
+#endif
+
+#if WantVSyncPacing
+/*
+    If the display refresh is within 1% of the emulated tick rate,
+    one emulated tick is run per vblank, with each tick due at the
+    predicted time of a vblank. Otherwise pacing is by the clock.
+    Times here are the low 32 bits of the system tick, which are
+    read and written atomically.
+*/
+
+LOCALVAR ui5b VBlankTime = 0;
+LOCALVAR ui5b VBlankPeriod = ( u64 ) SYSCLOCK_ARM11 * 100 / 5983;
+
+LOCALPROC VBlankNtfy( void* Arg ) {
+    ui5b Now = ( ui5b ) svcGetSystemTick( );
+    ui5b d = Now - VBlankTime;
+    
+    UnusedParam( Arg );
+    
+    if ( ( d > VBlankPeriod / 2 ) && ( d < VBlankPeriod * 2 ) )
+        VBlankPeriod = VBlankPeriod - ( VBlankPeriod >> 4 ) + ( d >> 4 );
+    
+    VBlankTime = Now;
+}
+
+LOCALFUNC blnr VSyncNextTime( void ) {
+    u64 Now = svcGetSystemTick( );
+    ui5b Period = VBlankPeriod;
+    ui5b Since = ( ui5b ) Now - VBlankTime;
+    ui5b Diff = ( Period > MyEmTickTicks ) ?
+        Period - MyEmTickTicks : MyEmTickTicks - Period;
+    u64 Next;
+    
+    if ( ( Diff * 100 >= MyEmTickTicks ) || ( Since > Period * 4 ) ) {
+        /* refresh too far off, or vblanks have stopped */
+        return falseblnr;
+    }
+    
+    Next = Now - Since + Period;
+    while ( Next < NextTickTime + Period / 2 )
+        Next += Period;
+    
+#if WantPaceStats
+    /* vblanks passed over since the last tick was due */
+    PaceDropped += ( ( Next - NextTickTime + Period / 2 ) / Period ) - 1;
+#endif
+    
+    NextTickTime = Next;
+    return trueblnr;
+}
+#endif
 
 LOCALPROC IncrNextTime(void)
 {
-	NextFracTime += MyInvTimeStep;
-	NextIntTime += (NextFracTime >> MyInvTimeDivPow);
+#if WantVSyncPacing
+	if (VSyncNextTime()) {
+		return;
+	}
+#endif
+	NextFracTime += ( ui5b ) ( MyInvTimeStep & MyInvTimeDivMask );
+	NextTickTime += MyEmTickTicks + (NextFracTime >> MyInvTimeDivPow);
 	NextFracTime &= MyInvTimeDivMask;
 }
 
 LOCALPROC InitNextTime(void)
 {
-	NextIntTime = LastTime;
+	NextTickTime = svcGetSystemTick( );
 	NextFracTime = 0;
 	IncrNextTime();
 }
 
 LOCALVAR ui5b NewMacDateInSeconds;
 
-u64 MSAtAppStart = 0;
-
 /*
- * Returns the time in milliseconds since the start of the app
- */
-LOCALFUNC u32 GetMS( void ) {
-    return ( u32 ) osGetTime( );
+    osGetTime counts milliseconds from 1900, the Mac counts
+    seconds from 1904, which is 1460 days later.
+*/
+#define MacDateDelta1900 ( ( u64 ) 1460 * 24 * 60 * 60 )
+
+LOCALFUNC ui5b GetMacDateInSeconds( void ) {
+    return ( ui5b ) ( ( osGetTime( ) / 1000 ) - MacDateDelta1900 );
 }
 
+u64 MSAtAppStart = 0;
+
 LOCALFUNC blnr UpdateTrueEmulatedTime(void)
 {
-	Uint32 LatestTime;
-	si5b TimeDiff;
-
-    LatestTime = GetMS( ); //osGetTime( );
-	if (LatestTime != LastTime) {
+	u64 LatestTime = svcGetSystemTick( );
 
-		NewMacDateInSeconds = LatestTime / 1000;
-			/* no date and time api in SDL */
+	if (LatestTime >= NextTickTime) {
+#if WantPaceStats
+		PaceDue = NextTickTime;
+#endif
+		NewMacDateInSeconds = GetMacDateInSeconds( );
 
-		LastTime = LatestTime;
-		TimeDiff = (LatestTime - NextIntTime);
-			/* this should work even when time wraps */
-		if (TimeDiff >= 0) {
-			if (TimeDiff > 256) {
-				/* emulation interrupted, forget it */
-				++TrueEmulatedTime;
-				InitNextTime();
+		if (LatestTime - NextTickTime > 256 * MyMSTicks) {
+			/* emulation interrupted, forget it */
+#if WantPaceStats
+			PaceDropped += ( LatestTime - NextTickTime ) / MyEmTickTicks;
+			PaceDue = LatestTime;
+#endif
+			++TrueEmulatedTime;
+			InitNextTime();
 
 #if dbglog_TimeStuff
-				dbglog_writelnNum("emulation interrupted",
-					TrueEmulatedTime);
+			dbglog_writelnNum("emulation interrupted",
+				TrueEmulatedTime);
 #endif
-			} else {
-				do {
-					++TrueEmulatedTime;
-					IncrNextTime();
-					TimeDiff = (LatestTime - NextIntTime);
-				} while (TimeDiff >= 0);
-			}
-			return trueblnr;
 		} else {
-			if (TimeDiff < -256) {
-#if dbglog_TimeStuff
-				dbglog_writeln("clock set back");
-#endif
-				/* clock goofed if ever get here, reset */
-				InitNextTime();
-			}
+			do {
+				++TrueEmulatedTime;
+				IncrNextTime();
+			} while (LatestTime >= NextTickTime);
 		}
+		return trueblnr;
 	}
 	return falseblnr;
 }
 
+#if EnableFrameGovernor
+GLOBALFUNC ui5r GetHostMicroseconds( void ) {
+    u64 Now = svcGetSystemTick( );
+    
+    return ( ui5r ) ( ( Now / SYSCLOCK_ARM11 ) * 1000000
+        + ( Now % SYSCLOCK_ARM11 ) * 1000000 / SYSCLOCK_ARM11 );
+}
+
+/*
+    With UseEmThread, DoneWithDrawingForTick only copies the changed
+    rows for the presenter, which then converts and uploads them on
+    the main thread. That shares the core with emulation on the Old
+    3DS, and on the New 3DS a presenter that can't keep up just
+    makes the frames drawn for it wasted, so it is charged to drawing.
+*/
+GLOBALFUNC ui5r GetPresentMicroseconds( void ) {
+#if UseEmThread
+    return AtomicLoadAcq( &EmFrameTakeCost );
+#else
+    return 0;
+#endif
+}
+#endif
+
+/* Sleep until the next tick is due. */
+LOCALPROC SleepUntilNextTime( void ) {
+    u64 Now = svcGetSystemTick( );
+    
+    if ( NextTickTime > Now )
+        svcSleepThread( ( s64 ) ( ( NextTickTime - Now ) * 1000000000ULL
+            / SYSCLOCK_ARM11 ) );
+}
+
 
 LOCALFUNC blnr CheckDateTime(void)
 {
@@ -1823,17 +2976,19 @@ LOCALFUNC blnr CheckDateTime(void)
 
 LOCALPROC StartUpTimeAdjust(void)
 {
-    LastTime = GetMS( );//osGetTime( );
 	InitNextTime();
 }
 
 LOCALFUNC blnr InitLocationDat(void)
 {
-    LastTime = GetMS( ); //osGetTime( );
 	InitNextTime();
-	NewMacDateInSeconds = LastTime / 1000;
+	NewMacDateInSeconds = GetMacDateInSeconds( );
 	CurMacDateInSeconds = NewMacDateInSeconds;
 
+#if WantVSyncPacing
+	gspSetEventCallback( GSPGPU_EVENT_VBlank0, VBlankNtfy, NULL, false );
+#endif
+
 	return trueblnr;
 }
 
@@ -2186,6 +3341,9 @@ LOCALPROC MySound_Stop(void)
 		ui4r retry_limit = 50; /* half of a second */
 
 		cur_audio.wantplaying = falseblnr;
+#if ! EmASC
+		ICT_RemoveConsumer(kICT_SubTick);
+#endif
 
 label_retry:
 		if (kCenterTempSound == cur_audio.lastv) {
@@ -2230,6 +3388,10 @@ LOCALPROC MySound_Start(void)
 		cur_audio.lastv = kCenterTempSound;
 		cur_audio.HaveStartedPlaying = falseblnr;
 		cur_audio.wantplaying = trueblnr;
+#if ! EmASC
+		/* sound is made a sub tick at a time */
+		ICT_AddConsumer(kICT_SubTick);
+#endif
 
 		SDL_PauseAudio(0);
 	}
@@ -2437,7 +3599,7 @@ LOCALPROC HandleMouseMovement( void ) {
     /* Clamp deltas and set mouse movement */
     if ( HaveMouseMotion == trueblnr ) {
         if ( IsDelta == falseblnr ) {
-            MyMousePositionSet( X, Y );
+            HostMousePositionSet( X, Y );
         }
         else {
             if ( X < MouseMinDelta ) X = MouseMinDelta;
@@ -2446,7 +3608,7 @@ LOCALPROC HandleMouseMovement( void ) {
             if ( Y < MouseMinDelta ) Y = MouseMinDelta;
             if ( Y > MouseMaxDelta ) Y = MouseMaxDelta;
             
-            MyMousePositionSetDelta( X, Y );
+            HostMousePositionSetDelta( X, Y );
         }
         
         HaveMouseMotion = falseblnr;
@@ -2521,6 +3683,11 @@ LOCALPROC ToggleScreenScaleMode( void ) {
     if ( ScaleMode == ScaleMode_1to1 ) C3D_TexSetFilter( &FBTexture, GPU_NEAREST, GPU_NEAREST );
     else C3D_TexSetFilter( &FBTexture, GPU_LINEAR, GPU_LINEAR );
     
+    /* Scaled modes are downscaled on the CPU when there is memory for it */
+    if ( ScaleMode == ScaleMode_1to1 ) Scale_Setup( 0, 0 );
+    else Scale_Setup( ( int ) ( ( vMacScreenWidth * ScreenScaleW ) + 0.5f ),
+        ( int ) ( ( vMacScreenHeight * ScreenScaleH ) + 0.5f ) );
+    
     /* Reset scrolling offsets */
     ScreenScrollX = 0;
     ScreenScrollY = 0;
@@ -2564,12 +3731,12 @@ LOCALPROC DrawMainScreen( void ) {
     
     C3D_FrameDrawOn( MainRenderTarget );
     C3D_FVUnifMtx4x4( GPU_VERTEX_SHADER, LocProjectionUniforms, &ProjectionMain );
-    DrawTexture( &FBTexture, 512, 512, ScreenScrollX, ScreenScrollY, ScreenScaleW, ScreenScaleH );
+    
+    /* The CPU scaled texture is already at screen size */
+    if ( ScreenScaler.DstW ) DrawTexture( &ScaledTex, 512, 512, ScreenScrollX, ScreenScrollY, 1.0f, 1.0f );
+    else DrawTexture( &FBTexture, 512, 512, ScreenScrollX, ScreenScrollY, ScreenScaleW, ScreenScaleH );
 }
 
-extern int FramesTooSlow;
-extern int FramesVideoDisabled;
-
 LOCALPROC DrawSubScreen( void ) {
     float SubScaleX = ( ( float ) MySubScreenWidth ) / ( ( float ) vMacScreenWidth );
     float SubScaleY = ( ( float ) MySubScreenHeight ) / ( ( float ) vMacScreenHeight );
@@ -2589,22 +3756,89 @@ LOCALPROC DrawSubScreen( void ) {
     
     if ( Keys_Held & KEY_X ) {
         //printf( "\x1b[2J" );
-        //printf( "Frames where not fast enough: %d\n", FramesTooSlow );
-        //printf( "Frames where video was disabled: %d\n", FramesVideoDisabled );
         
         DebugConsoleDraw( );
     }
 #endif
 }
 
+/*
+ * Everything besides the textures that goes into a frame.
+ * A frame is only submitted when this, or a texture, changed
+ * since the last one.
+ */
+typedef struct {
+    int ScrollX;
+    int ScrollY;
+    ScreenScaleMode ScaleMode;
+    blnr KeyboardIsActive;
+    blnr ConsoleShown;
+} PresentState;
+
+static PresentState LastPresent;
+
+#ifndef WantPresentStats
+#define WantPresentStats 0
+#endif
+
+#if WantPresentStats
+static u32 PresentFrames = 0;
+static u32 PresentSkipped = 0;
+#endif
+
+LOCALFUNC blnr PresentCheck( void ) {
+    PresentState Cur;
+    blnr Changed = PresentDirty;
+    
+    Cur.ScrollX = ScreenScrollX;
+    Cur.ScrollY = ScreenScrollY;
+    Cur.ScaleMode = ScaleMode;
+    Cur.KeyboardIsActive = KeyboardIsActive;
+#ifdef DEBUG_CONSOLE
+    Cur.ConsoleShown = ( Keys_Held & KEY_X ) ? trueblnr : falseblnr;
+#else
+    Cur.ConsoleShown = falseblnr;
+#endif
+    
+    if ( Cur.ScrollX != LastPresent.ScrollX
+        || Cur.ScrollY != LastPresent.ScrollY
+        || Cur.ScaleMode != LastPresent.ScaleMode
+        || Cur.KeyboardIsActive != LastPresent.KeyboardIsActive
+        || Cur.ConsoleShown != LastPresent.ConsoleShown )
+    {
+        Changed = trueblnr;
+    }
+    
+    LastPresent = Cur;
+    PresentDirty = falseblnr;
+    
+#if WantPresentStats
+    if ( Changed )
+        PresentFrames++;
+    else
+        PresentSkipped++;
+    
+    if ( PresentFrames + PresentSkipped == 60 ) {
+#if dbglog_HAVE
+        dbglog_writelnNum( "frames presented", PresentFrames );
+        dbglog_writelnNum( "frames skipped", PresentSkipped );
+#endif
+        PresentFrames = 0;
+        PresentSkipped = 0;
+    }
+#endif
+    
+    return Changed;
+}
+
 /* --- event handling for main window --- */
 
 LOCALPROC HandleControlMode( void ) {
     static blnr ToggleState = falseblnr;
     
     if ( Keys_Down & KEY_START ) {
-        if ( ToggleState == falseblnr ) Keyboard_UpdateKeyMap2( MKC_Control, trueblnr );
-        else Keyboard_UpdateKeyMap2( MKC_Control, falseblnr );
+        if ( ToggleState == falseblnr ) HostKeyEvent( MKC_Control, trueblnr );
+        else HostKeyEvent( MKC_Control, falseblnr );
         
         ToggleState = ! ToggleState;
     }
@@ -2612,7 +3846,7 @@ LOCALPROC HandleControlMode( void ) {
 
 LOCALPROC Handle3FingerSalute( void ) {
     if ( ( Keys_Held & KEY_L ) && ( Keys_Held & KEY_R ) && ( Keys_Held & KEY_START ) )
-   		ForceMacOff = trueblnr;
+   		HostForceMacOff( );
     	
     //    RequestMacOff = trueblnr;
 }
@@ -2620,8 +3854,8 @@ LOCALPROC Handle3FingerSalute( void ) {
 /* Toggle between absolute/relative mouse modes */
 LOCALPROC HandleMouseToggle( void ) {
     if (  ( Keys_Held & KEY_L ) && ( Keys_Held & KEY_R ) && ( Keys_Held & KEY_A ) ) {
-        if ( IsMouseAbsolute == falseblnr ) MacMsg( "Mouse mode changed", "Absolute mouse movement enabled", falseblnr );
-        else MacMsg( "Mouse mode changed", "Relative mouse mode enabled", falseblnr );
+        if ( IsMouseAbsolute == falseblnr ) HostMacMsg( "Mouse mode changed", "Absolute mouse movement enabled" );
+        else HostMacMsg( "Mouse mode changed", "Relative mouse mode enabled" );
         
         IsMouseAbsolute = ! IsMouseAbsolute;
     }
@@ -2636,7 +3870,7 @@ LOCALPROC HandleTheEvent( void ) {
         Keys_Held = hidKeysHeld( );
         
         HandleMouseMovement( );
-        MyMouseButtonSet( IsMouseKeyDown( ) );
+        HostMouseButton( IsMouseKeyDown( ) );
         
         Handle3FingerSalute( );
         HandleControlMode( );
@@ -2654,17 +3888,28 @@ LOCALPROC HandleTheEvent( void ) {
             
         /* Pressing X should dismiss all emulator messages */
         if ( ( Keys_Down & KEY_X ) )
-        	MacMsgDisplayOff( );
+        	HostMacMsgDisplayOff( );
         
         /* Handle the DPAD arrow keys regardless of if the keyboard is shown */
         Keyboard_HandleDPAD( );
         
         UpdateScreenScroll( );
         
-        C3D_FrameBegin( C3D_FRAME_SYNCDRAW );
-            DrawMainScreen( );
-            DrawSubScreen( );
-        C3D_FrameEnd( 0 );
+#if UseEmThread
+        EmFrameTake( );
+#endif
+        if ( PresentCheck( ) ) {
+            C3D_FrameBegin( C3D_FRAME_SYNCDRAW );
+                DrawMainScreen( );
+                DrawSubScreen( );
+            C3D_FrameEnd( 0 );
+        } else {
+#if UseEmThread
+            /* Nothing else paces the presentation loop */
+            if ( EmThreadRunning )
+                gspWaitForVBlank( );
+#endif
+        }
         
         // printf( "dx: %d, dy: %d\n", dx, dy );
         
@@ -2673,7 +3918,7 @@ LOCALPROC HandleTheEvent( void ) {
     } else {
         /* If we're force closing, make sure the emulator exits.
          */
-        ForceMacOff = trueblnr;
+        HostForceMacOff( );
     }
 }
 
@@ -2849,9 +4094,14 @@ LOCALPROC CheckForSavedTasks(void)
 	}
 #endif
 
-	if (NeedWholeScreenDraw) {
-		NeedWholeScreenDraw = falseblnr;
-		ScreenChangedAll();
+	if (NeedSpclModeDraw
+#if UseFramePipe
+		&& ! FramePipeBusyNow()
+#endif
+		)
+	{
+		NeedSpclModeDraw = falseblnr;
+		CntrlUpdate();
 	}
 }
 
@@ -2872,17 +4122,26 @@ GLOBALFUNC blnr ExtraTimeNotOver(void)
 
 LOCALPROC WaitForTheNextEvent(void)
 {
+#if UseEmThread
+    svcSleepThread( 16 * 1000000LL );
+#endif
 }
 
 LOCALPROC CheckForSystemEvents(void)
 {
+#if UseEmThread
+    if ( ! EmThreadRunning ) {
+        /* no emulation thread, poll and present from here */
+        HandleTheEvent( );
+    }
+    EmThreadTakeInput( );
+#else
     HandleTheEvent( );
+#endif
 }
 
 void MyDelay( u32 TimeToDelay ) {
-    u64 TimeWhenDone = osGetTime( ) + TimeToDelay;
-    
-    while ( osGetTime( ) < TimeWhenDone );
+    svcSleepThread( ( s64 ) TimeToDelay * 1000000LL );
 }
 
 GLOBALPROC WaitForNextTick(void)
@@ -2902,11 +4161,18 @@ label_retry:
 	}
 
 	if (ExtraTimeNotOver()) {
-		MyDelay(NextIntTime - LastTime);
+		SleepUntilNextTime();
 		goto label_retry;
 	}
 
+#if WantPaceStats
+	PaceStatsNtfy();
+#endif
+
 	if (CheckDateTime()) {
+#if WantPaceStats
+		PaceStatsSecondNotify();
+#endif
 #if MySoundEnabled
 		MySound_SecondNotify();
 #endif
@@ -2939,6 +4205,9 @@ LOCALPROC ZapOSGLUVars(void)
 {
 	InitDrives();
 	ZapWinStateVars();
+#if UseEmThread
+	EmFrameZap();
+#endif
 }
 
 LOCALPROC ReserveAllocAll(void)
@@ -2954,6 +4223,12 @@ LOCALPROC ReserveAllocAll(void)
 	ReserveAllocOneBlock(&CntrlDisplayBuff,
 		vMacScreenNumBytes, 5, falseblnr);
 #endif
+#if UseEmThread
+	ReserveAllocOneBlock(&EmFrameBuff[0],
+		vMacScreenNumBytes, 5, falseblnr);
+	ReserveAllocOneBlock(&EmFrameBuff[1],
+		vMacScreenNumBytes, 5, falseblnr);
+#endif
 
 #if MySoundEnabled
 	ReserveAllocOneBlock((ui3p *)&TheSoundBuffer,
@@ -3028,6 +4303,12 @@ LOCALFUNC blnr InitOSGLU(void)
 	if (Screen_Init())
 	if (CreateMainWindow())
 	{
+#if WantScreenCapture
+		ScreenCaptureStart();
+#endif
+#if UseFramePipe
+		FramePipeBegin();
+#endif
 		return trueblnr;
 	}
     printf( "B\n" );
@@ -3054,6 +4335,12 @@ LOCALPROC UnInitOSGLU(void)
 	UnInitPbufs();
 #endif
 	UnInitDrives();
+#if WantScreenCapture
+	ScreenCaptureStop();
+#endif
+#if UseFramePipe
+	FramePipeEnd();
+#endif
 
 #if dbglog_HAVE
 	dbglog_close();
@@ -3072,6 +4359,64 @@ LOCALPROC UnInitOSGLU(void)
     MyDelay( 250 );
 }
 
+#if UseEmThread
+#define EmThreadStackSize 0x40000
+
+LOCALVAR Thread EmThread = NULL;
+LOCALVAR blnr EmThreadDone = falseblnr;
+
+LOCALPROC EmThreadMain( void* Arg ) {
+    UnusedParam( Arg );
+    
+    ProgramMain( );
+    AtomicStoreRel( &EmThreadDone, trueblnr );
+}
+
+/*
+    The emulation thread gets a lower priority than the main
+    thread, so that when the two share a core (Old 3DS) input and
+    presentation preempt it, and it runs whenever the main thread
+    is waiting on the GPU.
+*/
+LOCALFUNC blnr EmThreadStart( void ) {
+    s32 Prio = 0x30;
+    bool IsNew3DS = false;
+    
+    svcGetThreadPriority( &Prio, CUR_THREAD_HANDLE );
+    if ( Prio < 0x3F )
+        Prio++;
+    
+    /* set first, the thread may start running right away */
+    EmThreadRunning = trueblnr;
+    
+    APT_CheckNew3DS( &IsNew3DS );
+    if ( IsNew3DS )
+        EmThread = threadCreate( EmThreadMain, NULL, EmThreadStackSize, Prio, 2, false );
+    
+    if ( EmThread == NULL )
+        EmThread = threadCreate( EmThreadMain, NULL, EmThreadStackSize, Prio, -2, false );
+    
+    if ( EmThread == NULL )
+        EmThreadRunning = falseblnr;
+    
+    return EmThread != NULL;
+}
+
+LOCALPROC PresentationLoop( void ) {
+    while ( ! AtomicLoadAcq( &EmThreadDone ) ) {
+        HandleTheEvent( );
+        
+        /* Once quitting nothing below waits on the GPU,
+           give the emulation thread a chance to finish. */
+        if ( AtomicLoadAcq( &HostRequestOff ) )
+            svcSleepThread( 1000000LL );
+    }
+    
+    threadJoin( EmThread, U64_MAX );
+    threadFree( EmThread );
+}
+#endif
+
 int main(int argc, char **argv)
 {
 	my_argc = argc;
@@ -3079,7 +4424,19 @@ int main(int argc, char **argv)
 
 	ZapOSGLUVars();
 	if (InitOSGLU()) {
+#if UseEmThread
+		if (EmThreadStart()) {
+			PresentationLoop();
+		} else {
+			/*
+				No thread to be had, run everything on this
+				one, as without UseEmThread.
+			*/
+			ProgramMain();
+		}
+#else
 		ProgramMain();
+#endif
 	}
 	UnInitOSGLU();
 
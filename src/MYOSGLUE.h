@@ -177,6 +177,26 @@ EXPORTVAR(ui5b, CurMacDelta)
 #define vMacScreenMonoNumBytes (vMacScreenNumPixels / 8)
 #define vMacScreenMonoByteWidth ((long)vMacScreenWidth / 8)
 
+#if EnableScreenDirtyRows
+#if 0 != vMacScreenDepth
+#error "EnableScreenDirtyRows only supports a 1 bit screen"
+#endif
+
+/*
+	A bit for each row of the emulated screen that may have
+	changed since ScreenFindChanges last compared it. Set by
+	the emulation when memory in the displayed screen buffer
+	is written, and cleared by ScreenFindChanges.
+*/
+#define kScreenDirtyRowsN ((vMacScreenHeight + 31) / 32)
+EXPORTVAR(ui5b, ScreenDirtyRows[kScreenDirtyRowsN])
+
+#define ScreenDirtyRowTst(i) \
+	(0 != (ScreenDirtyRows[(i) >> 5] & ((ui5b)1 << ((i) & 31))))
+#define ScreenDirtyRowSet(i) \
+	(ScreenDirtyRows[(i) >> 5] |= ((ui5b)1 << ((i) & 31)))
+#endif
+
 #if 0 != vMacScreenDepth
 EXPORTVAR(blnr, UseColorMode)
 EXPORTVAR(blnr, ColorModeWorks)
@@ -196,6 +216,17 @@ EXPORTVAR(ui4r, CLUT_blues[CLUT_size])
 
 EXPORTVAR(blnr, EmVideoDisable);
 EXPORTVAR(si3b, EmLagTime);
+EXPORTVAR(ui3b, EmIdlePercent);
+#if EnableFrameGovernor
+EXPORTVAR(ui4r, EmMaxRowsDrawn);
+EXPORTVAR(ui5b, EmRowsDeferred);
+EXPORTFUNC ui5r GetHostMicroseconds(void);
+EXPORTFUNC ui5r GetPresentMicroseconds(void);
+	/*
+		cost of getting a whole screen onto the display that
+		DoneWithDrawingForTick doesn't include, 0 if none
+	*/
+#endif
 
 EXPORTPROC Screen_OutputFrame(ui3p screencurrentbuff);
 EXPORTPROC DoneWithDrawingForTick(void);
@@ -210,6 +241,18 @@ EXPORTFUNC blnr ExtraTimeNotOver(void);
 
 EXPORTVAR(ui3b, SpeedValue)
 
+#if EnableFastTiming
+EXPORTVAR(blnr, WantFastTiming)
+#endif
+
+#if EnableClockMult
+EXPORTVAR(ui3b, ClockMultValue)
+#endif
+
+#if EnableDynarec
+EXPORTVAR(ui3b, DynarecMode)
+#endif
+
 #if EnableAutoSlow
 EXPORTVAR(blnr, WantNotAutoSlow)
 #endif
@@ -0,0 +1,140 @@
+/*
+	PIXCONV.c
+
+	You can redistribute this file and/or modify it under the terms
+	of version 2 of the GNU General Public License as published by
+	the Free Software Foundation.  You should have received a copy
+	of the license along with this file; see the file COPYING.
+
+	This file is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	license for more details.
+*/
+
+/*
+	PIXel CONVersion
+
+	Converts rectangles of 1, 2, 4 or 8 bit indexed screen
+	pixels, first pixel in the high bits of each byte, into
+	RGB565 or RGBA8 texture pixels.
+
+	Each source byte indexes a table holding all the output
+	pixels it makes, so a rectangle is converted with one
+	fixed size copy per source byte. The copy size only
+	depends on the depth and format, and there are just five
+	of them, so each gets a loop of its own, in which the
+	compiler can use whatever wide loads and stores the host
+	has. Only the last byte of a row may be partial.
+
+	Platform independent, tests/pixconv_test.c checks it and
+	tests/pixconv_bench.c times it on a desktop.
+*/
+
+#ifndef AllFiles
+#include "SYSDEPNS.h"
+#endif
+
+#include <string.h>
+
+#include "PIXCONV.h"
+
+LOCALPROC PixConvColor(ui3r Format, ui4r r, ui4r g, ui4r b, ui3p p)
+{
+	ui5r v;
+
+	r >>= 8;
+	g >>= 8;
+	b >>= 8;
+	if (kPixFmtRGBA8 == Format) {
+		p[0] = 0xFF;
+		p[1] = b;
+		p[2] = g;
+		p[3] = r;
+	} else {
+		v = ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3);
+		p[0] = v & 0xFF;
+		p[1] = v >> 8;
+	}
+}
+
+GLOBALPROC PixConvSetup(PixConv *c, ui3r Depth, ui3r Format,
+	ui4r *Reds, ui4r *Greens, ui4r *Blues)
+{
+	ui3b Colors[256][4];
+	uimr Bits = 1 << Depth;
+	uimr Mask = (1 << Bits) - 1;
+	uimr i;
+	uimr k;
+	uimr j;
+
+	c->Depth = Depth;
+	c->Format = Format;
+	c->PixelsPerByte = 8 >> Depth;
+	c->PixelBytes = (kPixFmtRGBA8 == Format) ? 4 : 2;
+
+	for (i = 0; i <= Mask; ++i) {
+		PixConvColor(Format, Reds[i], Greens[i], Blues[i], Colors[i]);
+	}
+
+	for (i = 0; i < 256; ++i) {
+		for (k = 0; k < c->PixelsPerByte; ++k) {
+			j = (i >> (8 - (k + 1) * Bits)) & Mask;
+			memcpy(&c->Lut[i][k * c->PixelBytes], Colors[j],
+				c->PixelBytes);
+		}
+	}
+}
+
+LOCALFUNC AlwaysInline void PixConvRows(PixConv *c, ui3p Src, uimr SrcPitch,
+	ui3p Dst, uimr DstPitch, uimr Width, uimr Height, uimr n)
+{
+	/* n is the bytes made from each source byte, a constant */
+	uimr Whole = Width / c->PixelsPerByte;
+	uimr Part = (Width % c->PixelsPerByte) * c->PixelBytes;
+	ui3p s;
+	ui3p d;
+	uimr i;
+
+	for (; Height > 0; --Height) {
+		s = Src;
+		d = Dst;
+		for (i = Whole; i > 0; --i) {
+			memcpy(d, c->Lut[*s++], n);
+			d += n;
+		}
+		if (0 != Part) {
+			memcpy(d, c->Lut[*s], Part);
+		}
+		Src += SrcPitch;
+		Dst += DstPitch;
+	}
+}
+
+GLOBALPROC PixConvRect(PixConv *c, ui3p Src, uimr SrcPitch,
+	ui3p Dst, uimr DstPitch, uimr Width, uimr Height)
+{
+	switch (c->PixelsPerByte * c->PixelBytes) {
+		case 2:
+			PixConvRows(c, Src, SrcPitch, Dst, DstPitch,
+				Width, Height, 2);
+			break;
+		case 4:
+			PixConvRows(c, Src, SrcPitch, Dst, DstPitch,
+				Width, Height, 4);
+			break;
+		case 8:
+			PixConvRows(c, Src, SrcPitch, Dst, DstPitch,
+				Width, Height, 8);
+			break;
+		case 16:
+			PixConvRows(c, Src, SrcPitch, Dst, DstPitch,
+				Width, Height, 16);
+			break;
+		case 32:
+		default:
+			PixConvRows(c, Src, SrcPitch, Dst, DstPitch,
+				Width, Height, 32);
+			break;
+	}
+}
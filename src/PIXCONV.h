@@ -0,0 +1,58 @@
+/*
+	PIXCONV.h
+
+	You can redistribute this file and/or modify it under the terms
+	of version 2 of the GNU General Public License as published by
+	the Free Software Foundation.  You should have received a copy
+	of the license along with this file; see the file COPYING.
+
+	This file is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	license for more details.
+*/
+
+#ifdef PIXCONV_H
+#error "header already included"
+#else
+#define PIXCONV_H
+#endif
+
+/*
+	Output pixel formats, both little endian as the 3DS GPU
+	wants them: kPixFmtRGB565 is 16 bits with red in the top
+	bits, kPixFmtRGBA8 is 32 bits, 0xRRGGBBAA.
+*/
+enum {
+	kPixFmtRGB565,
+	kPixFmtRGBA8,
+
+	kNumPixFmts
+};
+
+#define kPixConvMaxBytes 32
+	/* most output bytes for one source byte, 8 RGBA8 pixels */
+
+struct PixConv {
+	ui3r Depth; /* log2 of bits per source pixel, 0 to 3 */
+	ui3r Format;
+	uimr PixelsPerByte;
+	uimr PixelBytes;
+	ui3b Lut[256][kPixConvMaxBytes];
+		/* the output pixels for each source byte */
+};
+typedef struct PixConv PixConv;
+
+EXPORTPROC PixConvSetup(PixConv *c, ui3r Depth, ui3r Format,
+	ui4r *Reds, ui4r *Greens, ui4r *Blues);
+	/*
+		Builds the table for 1 << (1 << Depth) palette
+		entries, each channel 16 bits as in a Mac CLUT.
+	*/
+
+EXPORTPROC PixConvRect(PixConv *c, ui3p Src, uimr SrcPitch,
+	ui3p Dst, uimr DstPitch, uimr Width, uimr Height);
+	/*
+		Converts Width by Height pixels, with Src at the
+		start of a byte. Pitches are in bytes.
+	*/
@@ -124,6 +124,7 @@ LOCALPROC SubTickNotify(int SubTick)
 #define CyclesScaledPerSubTick (CyclesScaledPerTick / kNumSubTicks)
 
 LOCALVAR ui4r SubTickCounter;
+LOCALVAR blnr SubTickRunning = falseblnr;
 
 LOCALPROC SubTickTaskDo(void)
 {
@@ -143,12 +144,15 @@ LOCALPROC SubTickTaskDo(void)
 LOCALPROC SubTickTaskStart(void)
 {
 	SubTickCounter = 0;
+	SubTickRunning = ICT_HasConsumer(kICT_SubTick);
 	ICT_add(kICT_SubTick, CyclesScaledPerSubTick);
 }
 
 LOCALPROC SubTickTaskEnd(void)
 {
-	SubTickNotify(kNumSubTicks - 1);
+	if (SubTickRunning && ICT_HasConsumer(kICT_SubTick)) {
+		SubTickNotify(kNumSubTicks - 1);
+	}
 }
 
 LOCALPROC SixtiethSecondNotify(void)
@@ -230,6 +234,9 @@ GLOBALPROC EmulationReserveAlloc(void)
 	ReserveAllocOneBlock(&VidMem,
 		kVidMemRAM_Size + RAMSafetyMarginFudge, 5, trueblnr);
 #endif
+#if WantWordSwappedMem
+	Screen_ReserveAlloc();
+#endif
 #if SmallGlobals
 	MINEM68K_ReserveAlloc();
 #endif
@@ -246,6 +253,10 @@ LOCALFUNC blnr InitEmulation(void)
 #endif
 	if (AddrSpac_Init())
 	{
+#if EmASC
+		/* the ASC raises interrupts at sub ticks, so always listens */
+		ICT_AddConsumer(kICT_SubTick);
+#endif
 		EmulatedHardwareZap();
 		return trueblnr;
 	}
@@ -296,66 +307,34 @@ LOCALPROC ICT_DoTask(int taskid)
 	}
 }
 
-LOCALPROC ICT_DoCurrentTasks(void)
-{
-	int i = 0;
-	uimr m = ICTactive;
-
-	while (0 != m) {
-		if (0 != (m & 1)) {
-			if (i >= kNumICTs) {
-				/* shouldn't happen */
-				ICTactive &= ((1 << kNumICTs) - 1);
-				m = 0;
-			} else if (ICTwhen[i] == NextiCount) {
-				ICTactive &= ~ (1 << i);
-#ifdef _VIA_Debug
-				fprintf(stderr, "doing task %d, %d\n", NextiCount, i);
+#ifndef WantSliceStats
+#define WantSliceStats 0
 #endif
-				ICT_DoTask(i);
 
-				/*
-					A Task may set the time of
-					any task, including itself.
-					But it cannot set any task
-					to execute immediately, so
-					one pass is sufficient.
-				*/
-			}
-		}
-		++i;
-		m >>= 1;
-	}
-}
+#if WantSliceStats
+LOCALVAR ui5b SliceCount = 0;
+LOCALVAR ui5b SliceCycles = 0;
+LOCALVAR ui5b ICTTaskCount = 0;
+#endif
 
-LOCALFUNC ui5b ICT_DoGetNext(ui5b maxn)
+LOCALPROC ICT_DoCurrentTasks(void)
 {
-	int i = 0;
-	uimr m = ICTactive;
-	ui5b v = maxn;
-
-	while (0 != m) {
-		if (0 != (m & 1)) {
-			if (i >= kNumICTs) {
-				/* shouldn't happen */
-				m = 0;
-			} else {
-				ui5b d = ICTwhen[i] - NextiCount;
-				/* at this point d must be > 0 */
-				if (d < v) {
+	int taskid;
+
+	/*
+		A Task may set the time of any task, including itself.
+		But it cannot set any task to execute immediately, so
+		this ends.
+	*/
+	while (ICT_TakeDue(&taskid)) {
+#if WantSliceStats
+		++ICTTaskCount;
+#endif
 #ifdef _VIA_Debug
-					fprintf(stderr, "coming task %d, %d, %d\n",
-						NextiCount, i, d);
+		fprintf(stderr, "doing task %d, %d\n", NextiCount, taskid);
 #endif
-					v = d;
-				}
-			}
-		}
-		++i;
-		m >>= 1;
+		ICT_DoTask(taskid);
 	}
-
-	return v;
 }
 
 LOCALPROC m68k_go_nCycles_1(ui5b n)
@@ -364,7 +343,7 @@ LOCALPROC m68k_go_nCycles_1(ui5b n)
 	ui5b StopiCount = NextiCount + n;
 	do {
 		ICT_DoCurrentTasks();
-		n2 = ICT_DoGetNext(n);
+		n2 = ICT_TimeToNext(n);
 #if dbglog_HAVE && 0
 		dbglog_StartLine();
 		dbglog_writeCStr("before m68k_go_nCycles, NextiCount:");
@@ -376,6 +355,10 @@ LOCALPROC m68k_go_nCycles_1(ui5b n)
 		dbglog_writeReturn();
 #endif
 		NextiCount += n2;
+#if WantSliceStats
+		++SliceCount;
+		SliceCycles += n2 >> kLn2CycleScale;
+#endif
 		m68k_go_nCycles(n2);
 		n = StopiCount - NextiCount;
 	} while (n != 0);
@@ -383,8 +366,41 @@ LOCALPROC m68k_go_nCycles_1(ui5b n)
 
 LOCALVAR ui5b ExtraSubTicksToDo = 0;
 
+#if WantIdleSkip
+LOCALVAR ui5b IdleRunCycles = 0;
+LOCALVAR ui5b IdleSkipCycles = 0;
+LOCALVAR ui4r IdleTicks = 0;
+
+LOCALPROC IdleStatsNtfy(ui5b n)
+{
+	IdleRunCycles += n >> kLn2CycleScale;
+	IdleSkipCycles += m68k_TakeIdleCycles() >> kLn2CycleScale;
+}
+
+LOCALPROC IdleStatsTick(void)
+{
+	if (++IdleTicks >= 60) {
+		if (IdleRunCycles >= 100) {
+			EmIdlePercent = IdleSkipCycles / (IdleRunCycles / 100);
+		}
+		IdleRunCycles = 0;
+		IdleSkipCycles = 0;
+		IdleTicks = 0;
+	}
+}
+#endif
+
 LOCALPROC DoEmulateOneTick(void)
 {
+#if EnableFastTiming
+	m68k_SetFlatCycles(WantFastTiming);
+#endif
+#if EnableClockMult
+	m68k_SetClockShift(ClockMultValue);
+#endif
+#if EnableDynarec
+	m68k_SetDynarec(DynarecMode);
+#endif
 #if EnableAutoSlow
 	{
 		ui5r NewQuietTime = QuietTime + 1;
@@ -409,6 +425,10 @@ LOCALPROC DoEmulateOneTick(void)
 	SixtiethSecondNotify();
 
 	m68k_go_nCycles_1(CyclesScaledPerTick);
+#if WantIdleSkip
+	IdleStatsNtfy(CyclesScaledPerTick);
+	IdleStatsTick();
+#endif
 
 	SixtiethEndNotify();
 
@@ -472,6 +492,9 @@ LOCALPROC DoEmulateExtraTime(void)
 			}
 #endif
 			m68k_go_nCycles_1(CyclesScaledPerSubTick);
+#if WantIdleSkip
+			IdleStatsNtfy(CyclesScaledPerSubTick);
+#endif
 			--ExtraSubTicksToDo;
 		} while (MoreSubTicksToDo());
 		ExtraTimeEndNotify();
@@ -487,8 +510,185 @@ LOCALVAR ui5b CurEmulatedTime = 0;
 		"DoEmulateOneTick" has been called.
 	*/
 
-int FramesTooSlow = 0;
-int FramesVideoDisabled = 0;
+LOCALVAR ui5b FramesTooSlow = 0;
+	/* ticks given up on because emulation was too far behind */
+LOCALVAR ui5b FramesVideoDisabled = 0;
+	/* times ticks were run without video to catch up */
+LOCALVAR ui5b FramesSkipped = 0;
+	/* ticks the governor ran without video */
+
+#if EnableFrameGovernor
+/*
+	The frame governor. Each tick costs some host time to
+	emulate, plus, if the video is enabled for it, some more
+	to find and draw the screen changes. If the total is more
+	than a tick of host time, the emulation falls behind and
+	RunEmulatedTicksToTrueTime has to catch up in bursts, which
+	is what looks bad. So the governor measures the two costs,
+	and picks the smallest ratio of ticks to drawn frames, and
+	if that is not enough, the fewest rows drawn per frame,
+	that should let a tick of emulation fit in a tick of
+	host time.
+*/
+
+#define kGovTickMicroseconds 16626
+	/* one emulated tick, 1/60.14742 seconds */
+#define kGovBudget (kGovTickMicroseconds - kGovTickMicroseconds / 8)
+	/* leave some time for the host */
+#define kGovMaxSkip 4
+#define kGovMinRows (vMacScreenHeight / 4)
+#define kGovUpVotes 4
+#define kGovDownVotes 60
+
+LOCALVAR ui5r GovEmuCost = 0;
+	/* emulation cost of a tick, microseconds, times 16 */
+LOCALVAR ui5r GovDrawCost = 0;
+	/*
+		cost of finding and drawing changes for all rows,
+		microseconds, times 16
+	*/
+LOCALVAR ui3r GovSkip = 1;
+	/* draw one tick of every GovSkip */
+LOCALVAR ui3r GovPhase = 0;
+LOCALVAR si3r GovVotes = 0;
+LOCALVAR ui4r GovRowsMin = vMacScreenHeight;
+LOCALVAR ui4r GovRowsMax = 0;
+	/* range of EmMaxRowsDrawn since GetFrameStats */
+
+LOCALPROC GovAverage(ui5r *v, ui5r x)
+{
+	/* exponential moving average, weight 1/8 */
+	*v = *v - (*v >> 3) + (x << 1);
+}
+
+LOCALPROC GovDecide(void)
+{
+	ui5r Emu = GovEmuCost >> 4;
+	ui5r Draw = GovDrawCost >> 4;
+	ui5r Spare;
+	ui3r Want;
+	ui5r Rows = vMacScreenHeight;
+
+	if (Emu >= kGovBudget) {
+		/* can't keep up even without video */
+		Want = kGovMaxSkip;
+		Rows = kGovMinRows;
+	} else {
+		Spare = kGovBudget - Emu;
+		for (Want = 1; Want < kGovMaxSkip; ++Want) {
+			if (Want * Spare >= Draw) {
+				break;
+			}
+		}
+		if ((Want * Spare < Draw) && (0 != Draw)) {
+			Rows = (vMacScreenHeight * Want * Spare) / Draw;
+			if (Rows < kGovMinRows) {
+				Rows = kGovMinRows;
+			}
+		}
+	}
+
+	/*
+		Go to more skipping quickly, and back to less
+		slowly, so as not to oscillate.
+	*/
+	if (Want > GovSkip) {
+		if (GovVotes < 0) {
+			GovVotes = 0;
+		}
+		if (++GovVotes >= kGovUpVotes) {
+			GovSkip = Want;
+			GovVotes = 0;
+		}
+	} else if (Want < GovSkip) {
+		if (GovVotes > 0) {
+			GovVotes = 0;
+		}
+		if (--GovVotes <= - kGovDownVotes) {
+			--GovSkip;
+			GovVotes = 0;
+		}
+	} else {
+		GovVotes = 0;
+	}
+
+	if (Rows < EmMaxRowsDrawn) {
+		EmMaxRowsDrawn = Rows;
+	} else if (EmMaxRowsDrawn < vMacScreenHeight) {
+		/* grow back a little at a time */
+		EmMaxRowsDrawn += 2;
+		if (EmMaxRowsDrawn > Rows) {
+			EmMaxRowsDrawn = Rows;
+		}
+	}
+
+	if (EmMaxRowsDrawn < GovRowsMin) {
+		GovRowsMin = EmMaxRowsDrawn;
+	}
+	if (EmMaxRowsDrawn > GovRowsMax) {
+		GovRowsMax = EmMaxRowsDrawn;
+	}
+}
+
+LOCALPROC GovEmulateOneTick(void)
+{
+	ui5r t0 = GetHostMicroseconds();
+
+	if (EmVideoDisable) {
+		DoEmulateOneTick();
+		GovAverage(&GovEmuCost, GetHostMicroseconds() - t0);
+	} else {
+		ui5r t1;
+
+		DoEmulateOneTick();
+		DoneWithDrawingForTick();
+		t1 = GetHostMicroseconds() - t0;
+
+		/*
+			the part not explained by emulation is drawing,
+			plus whatever the platform does later to show it
+		*/
+		t1 = (t1 > (GovEmuCost >> 4)) ? t1 - (GovEmuCost >> 4) : 0;
+		GovAverage(&GovDrawCost,
+			t1 * vMacScreenHeight / EmMaxRowsDrawn
+				+ GetPresentMicroseconds());
+
+		GovDecide();
+	}
+}
+#endif
+
+GLOBALPROC GetFrameStats(FrameStats *s)
+{
+	s->FramesTooSlow = FramesTooSlow;
+	s->FramesVideoDisabled = FramesVideoDisabled;
+	s->FramesSkipped = FramesSkipped;
+#if EnableFrameGovernor
+	s->RowsDeferred = EmRowsDeferred;
+	s->EmuCost = GovEmuCost >> 4;
+	s->DrawCost = GovDrawCost >> 4;
+	s->PresentCost = GetPresentMicroseconds();
+	s->RowBudget = EmMaxRowsDrawn;
+	if (GovRowsMin > GovRowsMax) {
+		/* no drawn ticks since the last call */
+		GovRowsMin = GovRowsMax = EmMaxRowsDrawn;
+	}
+	s->RowBudgetMin = GovRowsMin;
+	s->RowBudgetMax = GovRowsMax;
+	s->SkipRatio = GovSkip;
+	GovRowsMin = vMacScreenHeight;
+	GovRowsMax = 0;
+#else
+	s->RowsDeferred = 0;
+	s->EmuCost = 0;
+	s->DrawCost = 0;
+	s->PresentCost = 0;
+	s->RowBudget = vMacScreenHeight;
+	s->RowBudgetMin = vMacScreenHeight;
+	s->RowBudgetMax = vMacScreenHeight;
+	s->SkipRatio = 1;
+#endif
+}
 
 LOCALPROC RunEmulatedTicksToTrueTime(void)
 {
@@ -513,32 +713,40 @@ LOCALPROC RunEmulatedTicksToTrueTime(void)
 	si3b n = OnTrueTime - CurEmulatedTime;
 
 	if (n > 0) {
+#if EnableFrameGovernor
+		if (++GovPhase >= GovSkip) {
+			GovPhase = 0;
+		} else {
+			EmVideoDisable = trueblnr;
+			++FramesSkipped;
+		}
+		GovEmulateOneTick();
+		EmVideoDisable = falseblnr;
+#else
 		DoEmulateOneTick();
-		++CurEmulatedTime;
-
 		DoneWithDrawingForTick();
+#endif
+		++CurEmulatedTime;
 
 		if (n > 8) {
 			/* emulation not fast enough */
 			n = 8;
 			CurEmulatedTime = OnTrueTime - n;
-            
-//#if dbglog_HAVE
-            FramesTooSlow++;
-//#endif
+			++FramesTooSlow;
 		}
 
 		if (ExtraTimeNotOver() && (--n > 0)) {
 			/* lagging, catch up */
-            
-//#if dbglog_HAVE
-            FramesVideoDisabled++;
-//#endif
+			++FramesVideoDisabled;
 
 			EmVideoDisable = trueblnr;
 
 			do {
+#if EnableFrameGovernor
+				GovEmulateOneTick();
+#else
 				DoEmulateOneTick();
+#endif
 				++CurEmulatedTime;
 			} while (ExtraTimeNotOver()
 				&& (--n > 0));
@@ -550,6 +758,73 @@ LOCALPROC RunEmulatedTicksToTrueTime(void)
 	}
 }
 
+#define WantStatsSecondNotify (dbglog_HAVE \
+	&& (WantInstrCount || (WantFusedOps && WantFuseCounts) \
+		|| WantMATCStats || WantSliceStats || WantIdleSkip \
+		|| EnableFrameGovernor))
+
+#if WantStatsSecondNotify
+LOCALVAR ui5b StatsSeconds = 0;
+
+LOCALPROC StatsSecondNotify(void)
+{
+	/*
+		CurMacDateInSeconds follows the host clock, so
+		these are per real second, for comparing dispatch
+		methods.
+	*/
+	if (CurMacDateInSeconds != StatsSeconds) {
+		StatsSeconds = CurMacDateInSeconds;
+#if WantInstrCount
+		dbglog_writelnNum("instructions per second",
+			m68k_TakeInstrCount());
+#endif
+#if WantFusedOps && WantFuseCounts
+		m68k_LogFuseCounts();
+#endif
+#if WantMATCStats
+		m68k_LogMATCStats();
+#endif
+#if EnableDynarec
+		m68k_LogDynarecStats();
+#endif
+#if WantIdleSkip
+		dbglog_writelnNum("idle percent", EmIdlePercent);
+#endif
+#if WantSliceStats
+		dbglog_writelnNum("slices per second", SliceCount);
+		if (0 != SliceCount) {
+			dbglog_writelnNum("average slice cycles",
+				SliceCycles / SliceCount);
+		}
+		dbglog_writelnNum("ICT tasks per second", ICTTaskCount);
+		SliceCount = 0;
+		SliceCycles = 0;
+		ICTTaskCount = 0;
+#endif
+#if EnableFrameGovernor
+		{
+			FrameStats s;
+
+			GetFrameStats(&s);
+			dbglog_writelnNum("frame skip ratio", s.SkipRatio);
+			dbglog_writelnNum("rows drawn limit", s.RowBudget);
+			dbglog_writelnNum("rows drawn limit low", s.RowBudgetMin);
+			dbglog_writelnNum("rows drawn limit high", s.RowBudgetMax);
+			dbglog_writelnNum("tick emulation us", s.EmuCost);
+			dbglog_writelnNum("screen draw us", s.DrawCost);
+			dbglog_writelnNum("screen present us", s.PresentCost);
+			dbglog_writelnNum("frames skipped", s.FramesSkipped);
+			dbglog_writelnNum("rows deferred", s.RowsDeferred);
+			dbglog_writelnNum("frames too slow", s.FramesTooSlow);
+			dbglog_writelnNum("frames video disabled",
+				s.FramesVideoDisabled);
+		}
+#endif
+	}
+}
+#endif
+
 LOCALPROC MainEventLoop(void)
 {
 	for (; ; ) {
@@ -558,6 +833,10 @@ LOCALPROC MainEventLoop(void)
 			return;
 		}
 
+#if WantStatsSecondNotify
+		StatsSecondNotify();
+#endif
+
 		RunEmulatedTicksToTrueTime();
 
 		DoEmulateExtraTime();
@@ -23,3 +23,27 @@
 
 EXPORTPROC EmulationReserveAlloc(void);
 EXPORTPROC ProgramMain(void);
+
+struct FrameStats {
+	ui5b FramesTooSlow;
+		/* ticks given up on because emulation was too far behind */
+	ui5b FramesVideoDisabled;
+		/* times ticks were run without video to catch up */
+	ui5b FramesSkipped; /* ticks the governor ran without video */
+	ui5b RowsDeferred;
+		/* changed rows the row budget left for a later tick */
+	ui5b EmuCost; /* microseconds to emulate a tick */
+	ui5b DrawCost; /* microseconds per whole screen drawn */
+	ui5b PresentCost; /* part of DrawCost spent by the platform */
+	ui4b RowBudget; /* EmMaxRowsDrawn, most rows drawn per tick */
+	ui4b RowBudgetMin; /* lowest and highest since the last call */
+	ui4b RowBudgetMax;
+	ui3b SkipRatio; /* one tick in SkipRatio is drawn */
+};
+typedef struct FrameStats FrameStats;
+
+EXPORTPROC GetFrameStats(FrameStats *s);
+	/*
+		The frame governor's decisions and counters. The counts
+		are totals, the row budget trend starts again each call.
+	*/
@@ -201,18 +201,18 @@ LOCALPROC Sony_Install(void)
 {
 	ui3p pto = Sony_DriverBase + ROM;
 
-	MyMoveBytes((anyp)sony_driver, (anyp)pto, sizeof(sony_driver));
+	MoveBytesToVMem((ui3p)sony_driver, pto, sizeof(sony_driver));
 	pto += sizeof(sony_driver);
 
-	do_put_mem_word(pto, kcom_callcheck);
+	do_put_vmem_word(pto, kcom_callcheck);
 	pto += 2;
-	do_put_mem_word(pto, kExtnSony);
+	do_put_vmem_word(pto, kExtnSony);
 	pto += 2;
-	do_put_mem_long(pto, kExtn_Block_Base); /* pokeaddr */
+	do_put_vmem_long(pto, kExtn_Block_Base); /* pokeaddr */
 	pto += 4;
 
 	my_disk_icon_addr = (pto - ROM) + kROM_Base;
-	MyMoveBytes((anyp)my_disk_icon, (anyp)pto, sizeof(my_disk_icon));
+	MoveBytesToVMem((ui3p)my_disk_icon, pto, sizeof(my_disk_icon));
 	pto += sizeof(my_disk_icon);
 
 #if UseLargeScreenHack
@@ -234,7 +234,7 @@ LOCALFUNC blnr Check_Checksum(ui5r CheckSum1)
 	ui3p p = 4 + ROM;
 
 	for (i = (kCheckSumRom_Size - 4) >> 1; --i >= 0; ) {
-		CheckSum2 += do_get_mem_word(p);
+		CheckSum2 += do_get_vmem_word(p);
 		p += 2;
 	}
 	return (CheckSum1 == CheckSum2);
@@ -242,7 +242,12 @@ LOCALFUNC blnr Check_Checksum(ui5r CheckSum1)
 
 GLOBALFUNC blnr ROM_Init(void)
 {
-	ui5r CheckSum = do_get_mem_long(ROM);
+	ui5r CheckSum;
+
+	ByteOrderToVMem(ROM, kROM_Size);
+		/* the ROM image is loaded in ordinary byte order */
+
+	CheckSum = do_get_vmem_long(ROM);
 
 	if (! Check_Checksum(CheckSum)) {
 		WarnMsgCorruptedROM();
@@ -294,30 +299,30 @@ GLOBALFUNC blnr ROM_Init(void)
 
 /* skip the rom checksum */
 #if CurEmMd <= kEmMd_128K
-	do_put_mem_word(226 + ROM, 0x6004);
+	do_put_vmem_word(226 + ROM, 0x6004);
 #elif CurEmMd <= kEmMd_Plus
-	do_put_mem_word(3450 + ROM, 0x6022);
+	do_put_vmem_word(3450 + ROM, 0x6022);
 #elif CurEmMd <= kEmMd_Classic
-	do_put_mem_word(7272 + ROM, 0x6008);
+	do_put_vmem_word(7272 + ROM, 0x6008);
 #elif (CurEmMd == kEmMd_II) || (CurEmMd == kEmMd_IIx)
-	do_put_mem_word(0x2AB0 + ROM, 0x6008);
+	do_put_vmem_word(0x2AB0 + ROM, 0x6008);
 #endif
 
 #if CurEmMd <= kEmMd_128K
 #elif CurEmMd <= kEmMd_Plus
-	do_put_mem_word(3752 + ROM, 0x4E71);
+	do_put_vmem_word(3752 + ROM, 0x4E71);
 		/* shorten the ram check read */
-	do_put_mem_word(3728 + ROM, 0x4E71);
+	do_put_vmem_word(3728 + ROM, 0x4E71);
 		/* shorten the ram check write */
 #elif CurEmMd <= kEmMd_Classic
-	do_put_mem_word(134 + ROM, 0x6002);
-	do_put_mem_word(286 + ROM, 0x6002);
+	do_put_vmem_word(134 + ROM, 0x6002);
+	do_put_vmem_word(286 + ROM, 0x6002);
 #elif (CurEmMd == kEmMd_II) || (CurEmMd == kEmMd_IIx)
-	do_put_mem_word(0xEE + ROM, 0x6002);
-	do_put_mem_word(0x1AA + ROM, 0x6002);
+	do_put_vmem_word(0xEE + ROM, 0x6002);
+	do_put_vmem_word(0x1AA + ROM, 0x6002);
 #endif
 
-	/* do_put_mem_word(862 + ROM, 0x4E71); */ /* shorten set memory */
+	/* do_put_vmem_word(862 + ROM, 0x4E71); */ /* shorten set memory */
 
 #if UseSonyPatch
 	Sony_Install();
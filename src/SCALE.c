@@ -0,0 +1,244 @@
+/*
+	SCALE.c
+
+	You can redistribute this file and/or modify it under the terms
+	of version 2 of the GNU General Public License as published by
+	the Free Software Foundation.  You should have received a copy
+	of the license along with this file; see the file COPYING.
+
+	This file is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	license for more details.
+*/
+
+/*
+	SCALE down
+
+	Downscales the 1 bit screen to RGB565 for the fit to screen
+	modes. Linear filtering on the GPU only ever samples the
+	two nearest texels, so at these ratios one pixel lines
+	either vanish or turn to gray mush. Instead each output
+	pixel is the average of the source area it covers,
+	darkened along a square root curve so a lone black pixel
+	still comes out clearly visible.
+
+	Both passes are table driven. A source row is averaged
+	across into Across, then the output rows that cover it are
+	averaged down into Dst, which the caller keeps between
+	frames, so only the rows under changed source rows are
+	redone. Src is the scaler's own copy of the screen, so the
+	whole output can be rebuilt on a change of size without
+	waiting for the emulator.
+
+	Platform independent, tests/scale_test.c checks it against
+	a floating point reference and tests/scale_bench.c times it
+	on a desktop.
+*/
+
+#ifndef AllFiles
+#include "SYSDEPNS.h"
+#endif
+
+#include <string.h>
+
+#include "SCALE.h"
+
+/*
+	Finds the source pixels under output pixel i, along with how
+	much of each is covered, as weights adding up to Total. The
+	edges between them are rounded, rather than each weight, so
+	a sliver of a pixel isn't lost and the sum stays exact.
+*/
+LOCALFUNC uimr ScaleTaps(uimr i, uimr Src, uimr Dst, uimr Total,
+	uimr *First, uimr *Weights)
+{
+	uimr Start = i * Src;
+	uimr End = Start + Src;
+	uimr Done = 0;
+	uimr n = 0;
+	uimr p = Start / Dst;
+	uimr b;
+	uimr k;
+
+	*First = p;
+
+	for (; (p * Dst < End) && (n < kScaleMaxTaps); ++p, ++n) {
+		b = (End < (p + 1) * Dst) ? End : (p + 1) * Dst;
+		k = ((b - Start) * Total + Src / 2) / Src;
+		Weights[n] = k - Done;
+		Done = k;
+	}
+
+	return n;
+}
+
+LOCALPROC ScaleBuildTables(Scaler *s)
+{
+	uimr Weights[kScaleMaxTaps];
+	uimr First;
+	uimr Bits;
+	uimr n;
+	uimr x;
+	uimr y;
+	uimr i;
+	uimr k;
+
+	/*
+		Columns look up their darkness straight from the source
+		bits under them, first pixel in the highest bit.
+	*/
+	for (x = 0; x < s->DstW; ++x) {
+		n = ScaleTaps(x, s->SrcW, s->DstW, 255, &First, Weights);
+
+		s->ColByte[x] = First >> 3;
+		s->ColShift[x] = 16 - (First & 7) - n;
+		s->ColMask[x] = (1 << n) - 1;
+
+		for (Bits = 0; Bits < ((uimr)1 << n); ++Bits) {
+			for (i = 0, k = 0; k < n; ++k) {
+				if (0 != (Bits & (1 << (n - 1 - k)))) {
+					i += Weights[k];
+				}
+			}
+			s->ColTab[x][Bits] = i;
+		}
+	}
+
+	/*
+		Unused row taps get a zero weight on the first row,
+		so the vertical pass can always take three.
+	*/
+	for (y = 0; y < s->DstH; ++y) {
+		n = ScaleTaps(y, s->SrcH, s->DstH, 256, &First, Weights);
+
+		s->RowFirst[y] = First;
+		for (k = 0; k < kScaleMaxTaps; ++k) {
+			s->RowWeight[y][k] = (k < n) ? Weights[k] : 0;
+		}
+	}
+
+	/*
+		square root tone curve, t = sqrt(d) scaled to 0..255, on
+		a finer scale of darkness than the passes keep, and each
+		rounded to nearest, since near white the curve is steep
+	*/
+	for (i = 0; i < kScaleGrays; ++i) {
+		for (k = 0; (2 * k + 1) * (2 * k + 1) * (kScaleGrays - 1)
+			<= 4 * 255 * 255 * i; ++k)
+		{
+		}
+		k = 255 - k;
+		s->Gray[i] = (((k * 31 + 127) / 255) << 11)
+			| (((k * 63 + 127) / 255) << 5)
+			| ((k * 31 + 127) / 255);
+	}
+}
+
+/* horizontal pass for one source row */
+LOCALPROC ScaleAcross(Scaler *s, uimr Row)
+{
+	ui3p Src = s->Src + Row * (s->SrcW / 8);
+	ui3p Dst = s->Across + Row * s->SrcW;
+	uimr Byte;
+	uimr x;
+
+	for (x = 0; x < s->DstW; ++x) {
+		Byte = s->ColByte[x];
+		Dst[x] = s->ColTab[x][(((Src[Byte] << 8) | Src[Byte + 1])
+			>> s->ColShift[x]) & s->ColMask[x]];
+	}
+}
+
+/* vertical pass for output rows Top to Bottom */
+LOCALPROC ScaleDown(Scaler *s, uimr Top, uimr Bottom)
+{
+	ui3p Src0;
+	ui3p Src1;
+	ui3p Src2;
+	ui4p Dst;
+	ui4b *Weights;
+	uimr y;
+	uimr x;
+
+	for (y = Top; y < Bottom; ++y) {
+		Weights = s->RowWeight[y];
+		Dst = s->Dst + y * s->DstPitch;
+
+		Src0 = s->Across + s->RowFirst[y] * s->SrcW;
+		Src1 = (0 != Weights[1]) ? Src0 + s->SrcW : Src0;
+		Src2 = (0 != Weights[2]) ? Src1 + s->SrcW : Src0;
+
+		for (x = 0; x < s->DstW; ++x) {
+			Dst[x] = s->Gray[(Src0[x] * Weights[0]
+				+ Src1[x] * Weights[1]
+				+ Src2[x] * Weights[2] + 32) >> 6];
+		}
+	}
+}
+
+GLOBALPROC ScaleInit(Scaler *s, uimr SrcW, uimr SrcH,
+	ui3p Src, ui3p Across, ui4p Dst, uimr DstPitch)
+{
+	s->SrcW = SrcW;
+	s->SrcH = SrcH;
+	s->DstW = 0;
+	s->DstH = 0;
+	s->Src = Src;
+	s->Across = Across;
+	s->Dst = Dst;
+	s->DstPitch = DstPitch;
+}
+
+GLOBALFUNC blnr ScaleSetSize(Scaler *s, uimr DstW, uimr DstH)
+{
+	uimr y;
+
+	if ((DstW > s->SrcW) || (2 * DstW < s->SrcW)
+		|| (DstH > s->SrcH) || (2 * DstH < s->SrcH)
+		|| (s->SrcW > kScaleMaxSize) || (s->SrcH > kScaleMaxSize))
+	{
+		s->DstW = 0;
+		s->DstH = 0;
+		return falseblnr;
+	}
+
+	s->DstW = DstW;
+	s->DstH = DstH;
+
+	ScaleBuildTables(s);
+	for (y = 0; y < s->SrcH; ++y) {
+		ScaleAcross(s, y);
+	}
+	ScaleDown(s, 0, DstH);
+
+	return trueblnr;
+}
+
+GLOBALFUNC blnr ScaleRows(Scaler *s, ui3p Src, uimr Top, uimr Bottom,
+	uimr *DstTop, uimr *DstBottom)
+{
+	uimr Pitch = s->SrcW / 8;
+	uimr y;
+
+	memcpy(s->Src + Top * Pitch, Src + Top * Pitch,
+		(Bottom - Top) * Pitch);
+
+	if (0 == s->DstW) {
+		return falseblnr;
+	}
+
+	for (y = Top; y < Bottom; ++y) {
+		ScaleAcross(s, y);
+	}
+
+	/* output rows that take any of the source rows Top to Bottom */
+	Top = Top * s->DstH / s->SrcH;
+	Bottom = (Bottom * s->DstH + s->SrcH - 1) / s->SrcH;
+
+	ScaleDown(s, Top, Bottom);
+	*DstTop = Top;
+	*DstBottom = Bottom;
+
+	return trueblnr;
+}
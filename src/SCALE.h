@@ -0,0 +1,78 @@
+/*
+	SCALE.h
+
+	You can redistribute this file and/or modify it under the terms
+	of version 2 of the GNU General Public License as published by
+	the Free Software Foundation.  You should have received a copy
+	of the license along with this file; see the file COPYING.
+
+	This file is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	license for more details.
+*/
+
+#ifdef SCALE_H
+#error "header already included"
+#else
+#define SCALE_H
+#endif
+
+#define kScaleMaxTaps 3
+	/* source pixels under an output pixel, each way */
+#define kScaleMaxSize 512
+	/* the largest source, so also output, width or height */
+#define kScaleGrays 1021
+	/* darknesses told apart, 255 * 256 / 64 + 1 */
+
+struct Scaler {
+	uimr SrcW;
+	uimr SrcH;
+	uimr DstW; /* 0 while not scaling */
+	uimr DstH;
+	ui3p Src;
+		/*
+			the scaler's own copy of the 1 bit source, SrcH rows
+			of SrcW / 8 bytes, and one byte more
+		*/
+	ui3p Across; /* SrcH rows of SrcW, each row averaged across */
+	ui4p Dst; /* RGB565 output */
+	uimr DstPitch; /* in pixels */
+
+	ui4b ColByte[kScaleMaxSize];
+	ui3b ColShift[kScaleMaxSize];
+	ui3b ColMask[kScaleMaxSize];
+	ui3b ColTab[kScaleMaxSize][1 << kScaleMaxTaps];
+		/* darkness of each output column, from its source bits */
+	ui4b RowFirst[kScaleMaxSize];
+	ui4b RowWeight[kScaleMaxSize][kScaleMaxTaps];
+	ui4b Gray[kScaleGrays];
+		/* output pixel for each darkness */
+};
+typedef struct Scaler Scaler;
+
+EXPORTPROC ScaleInit(Scaler *s, uimr SrcW, uimr SrcH,
+	ui3p Src, ui3p Across, ui4p Dst, uimr DstPitch);
+	/*
+		Takes the buffers, which the caller allocates, and
+		starts with scaling off. SrcW must be a multiple of 8.
+	*/
+
+EXPORTFUNC blnr ScaleSetSize(Scaler *s, uimr DstW, uimr DstH);
+	/*
+		Picks the output size and scales the whole of the
+		copy of the source into it. At most kScaleMaxTaps
+		source pixels may go into one output pixel, so the
+		output must be from half to all of the source each
+		way. For any other size, such as 0 by 0, scaling is
+		turned off and false returned.
+	*/
+
+EXPORTFUNC blnr ScaleRows(Scaler *s, ui3p Src, uimr Top, uimr Bottom,
+	uimr *DstTop, uimr *DstBottom);
+	/*
+		Takes source rows Top to Bottom of Src, with the same
+		pitch as the copy, and if scaling, redoes the output
+		rows under them, returns true and sets DstTop and
+		DstBottom to those rows.
+	*/
@@ -0,0 +1,335 @@
+/*
+	SCRNDIFF.c
+
+	You can redistribute this file and/or modify it under the terms
+	of version 2 of the GNU General Public License as published by
+	the Free Software Foundation.  You should have received a copy
+	of the license along with this file; see the file COPYING.
+
+	This file is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	license for more details.
+*/
+
+/*
+	SCReeN DIFFerence
+
+	Finds the changed part of a row of the 1 bit screen. The
+	row is compared a block at a time, as wide as the host
+	allows, from the left for the first differing block and
+	from the right for the last. Only within those two blocks
+	is the edge looked for, with count leading or trailing
+	zeros:
+
+	With SSE2 or AVX2, a byte compare of 16 or 32 bytes gives
+	a mask with a bit for each differing byte, the lowest for
+	the first byte.
+
+	With words, the exclusive or of the two words, with bytes
+	swapped on a little endian host (REV on ARM), has the
+	pixels in screen order from the high bit down. The 3DS
+	(ARMv6, which has REV and CLZ but no vector compare) takes
+	four words a step, which the compiler loads with LDM.
+
+	Bytes after the last whole block are compared one at a
+	time.
+
+	Platform independent, tests/scrndiff_test.c checks each
+	way against a byte at a time reference.
+*/
+
+#ifndef AllFiles
+#include "SYSDEPNS.h"
+#endif
+
+#include "SCRNDIFF.h"
+
+#ifndef ScrnDiffUse
+#if defined(__AVX2__)
+#define ScrnDiffUse kScrnDiffAVX2
+#elif defined(__SSE2__)
+#define ScrnDiffUse kScrnDiffSSE2
+#elif defined(__ARM_ARCH_6__) || defined(__ARM_ARCH_6K__) \
+	|| defined(ARM11)
+#define ScrnDiffUse kScrnDiffARMv6
+#else
+#define ScrnDiffUse kScrnDiffWords
+#endif
+#endif
+
+#ifdef __GNUC__
+#define ScrnDiffClz8(x) (__builtin_clz(x) - 24)
+#define ScrnDiffCtz8(x) __builtin_ctz(x)
+#else
+LOCALFUNC uimr ScrnDiffClz8(ui3r x)
+{
+	uimr n = 0;
+
+	while (0 == (x & 0x80)) {
+		x <<= 1;
+		++n;
+	}
+	return n;
+}
+
+LOCALFUNC uimr ScrnDiffCtz8(ui3r x)
+{
+	uimr n = 0;
+
+	while (0 == (x & 0x01)) {
+		x >>= 1;
+		++n;
+	}
+	return n;
+}
+#endif
+
+#if (kScrnDiffSSE2 == ScrnDiffUse) || (kScrnDiffAVX2 == ScrnDiffUse)
+
+typedef ui5r ScrnDiffBits;
+
+#if kScrnDiffAVX2 == ScrnDiffUse
+
+#include <immintrin.h>
+
+GLOBALVAR char *ScrnDiffName = "AVX2";
+
+#define kScrnDiffBlock 32
+
+LOCALFUNC AlwaysInline ScrnDiffBits ScrnDiffMask(ui3p p1, ui3p p2)
+{
+	__m256i a = _mm256_loadu_si256((__m256i *)p1);
+	__m256i b = _mm256_loadu_si256((__m256i *)p2);
+
+	return (ui5r)(unsigned int)
+		~ _mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b));
+}
+
+#else
+
+#include <emmintrin.h>
+
+GLOBALVAR char *ScrnDiffName = "SSE2";
+
+#define kScrnDiffBlock 16
+
+LOCALFUNC AlwaysInline ScrnDiffBits ScrnDiffMask(ui3p p1, ui3p p2)
+{
+	__m128i a = _mm_loadu_si128((__m128i *)p1);
+	__m128i b = _mm_loadu_si128((__m128i *)p2);
+
+	return 0xFFFF & ~ _mm_movemask_epi8(_mm_cmpeq_epi8(a, b));
+}
+
+#endif
+
+LOCALFUNC AlwaysInline uimr ScrnDiffLeft(ui3p p1, ui3p p2,
+	ScrnDiffBits m)
+{
+	uimr k = __builtin_ctz(m);
+
+	return k * 8 + ScrnDiffClz8(p1[k] ^ p2[k]);
+}
+
+LOCALFUNC AlwaysInline uimr ScrnDiffRight(ui3p p1, ui3p p2,
+	ScrnDiffBits m)
+{
+	uimr k = 31 - __builtin_clz(m);
+
+	return k * 8 + 8 - ScrnDiffCtz8(p1[k] ^ p2[k]);
+}
+
+#else
+
+/*
+	ScrnWord is a word of the row, in screen order, so that
+	the first pixel is the high bit.
+*/
+
+#if (kScrnDiffWords == ScrnDiffUse) && defined(__SIZEOF_POINTER__) \
+	&& (__SIZEOF_POINTER__ >= 8)
+typedef unsigned long long ScrnWord0;
+#define kScrnWordBits 64
+#define ScrnWordName "64 bit words"
+#else
+typedef unsigned int ScrnWord0;
+#define kScrnWordBits 32
+#define ScrnWordName "32 bit words"
+#endif
+
+typedef ScrnWord0 ScrnDiffBits;
+
+#ifdef __GNUC__
+
+typedef ScrnWord0 __attribute__((__may_alias__)) ScrnWord;
+
+#define ScrnWordRaw(p, i) (((ScrnWord *)(p))[i])
+
+#if 64 == kScrnWordBits
+#define ScrnWordClz(x) __builtin_clzll(x)
+#define ScrnWordCtz(x) __builtin_ctzll(x)
+#define ScrnWordSwap(x) __builtin_bswap64(x)
+#else
+#define ScrnWordClz(x) __builtin_clz(x)
+#define ScrnWordCtz(x) __builtin_ctz(x)
+#define ScrnWordSwap(x) __builtin_bswap32(x)
+#endif
+
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define ScrnWordLd(p, i) ScrnWordRaw(p, i)
+#else
+#define ScrnWordLd(p, i) ScrnWordSwap(ScrnWordRaw(p, i))
+#endif
+
+#else
+
+typedef ScrnWord0 ScrnWord;
+
+LOCALFUNC ScrnWord ScrnWordLd(ui3p p, uimr i)
+{
+	ScrnWord w = 0;
+	uimr k;
+
+	p += i * sizeof(ScrnWord);
+	for (k = 0; k < sizeof(ScrnWord); ++k) {
+		w = (w << 8) | p[k];
+	}
+	return w;
+}
+
+#define ScrnWordRaw(p, i) ScrnWordLd(p, i)
+
+LOCALFUNC uimr ScrnWordClz(ScrnWord x)
+{
+	uimr n = 0;
+
+	while (0 == (x >> (kScrnWordBits - 1))) {
+		x <<= 1;
+		++n;
+	}
+	return n;
+}
+
+LOCALFUNC uimr ScrnWordCtz(ScrnWord x)
+{
+	uimr n = 0;
+
+	while (0 == (x & 1)) {
+		x >>= 1;
+		++n;
+	}
+	return n;
+}
+
+#endif
+
+#if kScrnDiffARMv6 == ScrnDiffUse
+
+GLOBALVAR char *ScrnDiffName = "ARMv6";
+
+#define kScrnDiffWordsPerBlock 4
+
+#else
+
+GLOBALVAR char *ScrnDiffName = ScrnWordName;
+
+#define kScrnDiffWordsPerBlock 1
+
+#endif
+
+#define kScrnDiffBlock (kScrnDiffWordsPerBlock * sizeof(ScrnWord))
+
+#define ScrnWordX(p1, p2, i) (ScrnWordLd(p1, i) ^ ScrnWordLd(p2, i))
+
+LOCALFUNC AlwaysInline ScrnDiffBits ScrnDiffMask(ui3p p1, ui3p p2)
+{
+#if 4 == kScrnDiffWordsPerBlock
+	/* only whether any differ, so no byte swap */
+	return (ScrnWordRaw(p1, 0) ^ ScrnWordRaw(p2, 0))
+		| (ScrnWordRaw(p1, 1) ^ ScrnWordRaw(p2, 1))
+		| (ScrnWordRaw(p1, 2) ^ ScrnWordRaw(p2, 2))
+		| (ScrnWordRaw(p1, 3) ^ ScrnWordRaw(p2, 3));
+#else
+	return ScrnWordX(p1, p2, 0);
+#endif
+}
+
+LOCALFUNC AlwaysInline uimr ScrnDiffLeft(ui3p p1, ui3p p2,
+	ScrnDiffBits m)
+{
+#if 4 == kScrnDiffWordsPerBlock
+	uimr i = 0;
+
+	while (0 == (m = ScrnWordX(p1, p2, i))) {
+		++i;
+	}
+	return i * kScrnWordBits + ScrnWordClz(m);
+#else
+	UnusedParam(p1);
+	UnusedParam(p2);
+	return ScrnWordClz(m);
+#endif
+}
+
+LOCALFUNC AlwaysInline uimr ScrnDiffRight(ui3p p1, ui3p p2,
+	ScrnDiffBits m)
+{
+#if 4 == kScrnDiffWordsPerBlock
+	uimr i = kScrnDiffWordsPerBlock;
+
+	do {
+		--i;
+	} while (0 == (m = ScrnWordX(p1, p2, i)));
+	return (i + 1) * kScrnWordBits - ScrnWordCtz(m);
+#else
+	UnusedParam(p1);
+	UnusedParam(p2);
+	return kScrnWordBits - ScrnWordCtz(m);
+#endif
+}
+
+#endif
+
+GLOBALFUNC blnr ScrnDiffRow(ui3p p1, ui3p p2, uimr n,
+	uimr *left, uimr *right)
+{
+	uimr Whole = n - n % kScrnDiffBlock;
+	uimr i;
+	uimr k;
+	ScrnDiffBits m;
+
+	for (i = 0; i < Whole; i += kScrnDiffBlock) {
+		m = ScrnDiffMask(p1 + i, p2 + i);
+		if (0 != m) {
+			*left = i * 8 + ScrnDiffLeft(p1 + i, p2 + i, m);
+			goto Label_1;
+		}
+	}
+	for (k = Whole; k < n; ++k) {
+		if (p1[k] != p2[k]) {
+			*left = k * 8 + ScrnDiffClz8(p1[k] ^ p2[k]);
+			goto Label_1;
+		}
+	}
+	return falseblnr;
+
+Label_1:
+	for (k = n; k > Whole; ) {
+		--k;
+		if (p1[k] != p2[k]) {
+			*right = k * 8 + 8 - ScrnDiffCtz8(p1[k] ^ p2[k]);
+			return trueblnr;
+		}
+	}
+
+	/* the first differing block is found again at the latest */
+	i = Whole;
+	do {
+		i -= kScrnDiffBlock;
+		m = ScrnDiffMask(p1 + i, p2 + i);
+	} while (0 == m);
+	*right = i * 8 + ScrnDiffRight(p1 + i, p2 + i, m);
+
+	return trueblnr;
+}
@@ -0,0 +1,40 @@
+/*
+	SCRNDIFF.h
+
+	You can redistribute this file and/or modify it under the terms
+	of version 2 of the GNU General Public License as published by
+	the Free Software Foundation.  You should have received a copy
+	of the license along with this file; see the file COPYING.
+
+	This file is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	license for more details.
+*/
+
+#ifdef SCRNDIFF_H
+#error "header already included"
+#else
+#define SCRNDIFF_H
+#endif
+
+/*
+	The ways of comparing, for ScrnDiffUse. The widest the
+	compiler has is the default.
+*/
+#define kScrnDiffWords 0 /* a 64 or 32 bit word at a time */
+#define kScrnDiffARMv6 1 /* four words at a time, REV and CLZ */
+#define kScrnDiffSSE2 2 /* 16 bytes at a time */
+#define kScrnDiffAVX2 3 /* 32 bytes at a time */
+
+EXPORTVAR(char *, ScrnDiffName)
+	/* which of the above is used, for tests */
+
+EXPORTFUNC blnr ScrnDiffRow(ui3p p1, ui3p p2, uimr n,
+	uimr *left, uimr *right);
+	/*
+		Compares n bytes of 1 bit pixels, first pixel in the
+		high bit of each byte. If any differ, sets left to the
+		first changed pixel and right to one past the last,
+		and returns true. p1 and p2 must be word aligned.
+	*/
@@ -41,6 +41,21 @@
 #define kAlternate_Buffer (kRAM_Size - kAlternate_Offset)
 #endif
 
+#if WantWordSwappedMem
+/*
+	The screen buffer is in emulated memory, stored with words
+	swapped. Screen_OutputFrame wants it in ordinary byte order.
+*/
+
+LOCALVAR ui3p ScreenBOBuff = nullpr;
+
+GLOBALPROC Screen_ReserveAlloc(void)
+{
+	ReserveAllocOneBlock(&ScreenBOBuff, vMacScreenNumBytes, 5,
+		falseblnr);
+}
+#endif
+
 GLOBALPROC Screen_EndTickNotify(void)
 {
 	ui3p screencurrentbuff;
@@ -55,5 +70,43 @@ GLOBALPROC Screen_EndTickNotify(void)
 	}
 #endif
 
+#if EnableScreenDirtyRows
+	if (screencurrentbuff != ScreenDirtyBase) {
+		/* first time, or switched page */
+		ScreenDirtyBase = screencurrentbuff;
+		ScreenDirtyAll();
+	}
+#endif
+
+#if WantWordSwappedMem
+#if EnableScreenDirtyRows
+	{
+		/* only rows that may have changed need to be copied */
+		uimr i = 0;
+		uimr j;
+
+		while (i < vMacScreenHeight) {
+			if (! ScreenDirtyRowTst(i)) {
+				++i;
+			} else {
+				j = i + 1;
+				while ((j < vMacScreenHeight) && ScreenDirtyRowTst(j)) {
+					++j;
+				}
+				MoveBytesFromVMem(
+					screencurrentbuff + i * vMacScreenByteWidth,
+					ScreenBOBuff + i * vMacScreenByteWidth,
+					(j - i) * vMacScreenByteWidth);
+				i = j;
+			}
+		}
+	}
+#else
+	MoveBytesFromVMem(screencurrentbuff, ScreenBOBuff,
+		vMacScreenNumBytes);
+#endif
+	screencurrentbuff = ScreenBOBuff;
+#endif
+
 	Screen_OutputFrame(screencurrentbuff);
 }
@@ -21,4 +21,7 @@
 #define SCRNEMDV_H
 #endif
 
+#if WantWordSwappedMem
+EXPORTPROC Screen_ReserveAlloc(void);
+#endif
 EXPORTPROC Screen_EndTickNotify(void);
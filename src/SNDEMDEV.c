@@ -26,6 +26,7 @@
 #include "SYSDEPNS.h"
 
 #include "MYOSGLUE.h"
+#include "ENDIANAC.h"
 #include "EMCONFIG.h"
 #include "GLOBGLUE.h"
 #endif
@@ -145,7 +146,7 @@ label_retry:
 		} else {
 			for (i = 0; i < actL; i++) {
 				/* Copy sound data, high byte of each word */
-				*p++ = *addr
+				*p++ = do_get_vmem_byte(addr)
 #if 4 == kLn2SoundSampSz
 					<< 8
 #endif
@@ -79,6 +79,50 @@ LOCALFUNC tMacErr CheckReadableDrive(tDrive Drive_No)
 	return result;
 }
 
+#if WantWordSwappedMem
+/*
+	Emulated memory is stored with words swapped, so go through
+	a buffer in ordinary byte order.
+*/
+
+#define kSonyBounceSize 0x1000
+
+LOCALVAR ui3b SonyBounce[kSonyBounceSize];
+
+LOCALFUNC tMacErr vSonyTransferVMem(blnr IsWrite, ui3p Buffer,
+	tDrive Drive_No, ui5r Sony_Start, ui5r Sony_Count,
+	ui5r *Sony_ActCount)
+{
+	tMacErr result;
+	ui5r actual;
+	ui5r n;
+	ui5r done = 0;
+
+	do {
+		n = Sony_Count - done;
+		if (n > kSonyBounceSize) {
+			n = kSonyBounceSize;
+		}
+		actual = 0;
+		if (IsWrite) {
+			MoveBytesFromVMem(Buffer + done, SonyBounce, n);
+		}
+		result = vSonyTransfer(IsWrite, SonyBounce, Drive_No,
+			Sony_Start + done, n, &actual);
+		if (! IsWrite) {
+			MoveBytesToVMem(SonyBounce, Buffer + done, actual);
+		}
+		done += actual;
+	} while ((mnvm_noErr == result) && (actual == n)
+		&& (done < Sony_Count));
+
+	*Sony_ActCount = done;
+	return result;
+}
+#else
+#define vSonyTransferVMem vSonyTransfer
+#endif
+
 LOCALFUNC tMacErr vSonyTransferVM(blnr IsWrite,
 	CPTR Buffera, tDrive Drive_No,
 	ui5r Sony_Start, ui5r Sony_Count, ui5r *Sony_ActCount)
@@ -103,7 +147,7 @@ label_1:
 		if (0 == contig) {
 			result = mnvm_miscErr;
 		} else {
-			result = vSonyTransfer(IsWrite, Buffer, Drive_No,
+			result = vSonyTransferVMem(IsWrite, Buffer, Drive_No,
 				offset, contig, &actual);
 			offset += actual;
 			Buffera += actual;
@@ -138,7 +182,7 @@ label_1:
 			ReportAbnormal("MyMoveBytesVM fails");
 		} else {
 			contig = (contigSrc < contigDst) ? contigSrc : contigDst;
-			MyMoveBytes(src, dst, contig);
+			MoveBytesVMem(src, dst, contig);
 			srcPtr += contig;
 			dstPtr += contig;
 			byteCount -= contig;
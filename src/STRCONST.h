@@ -102,6 +102,9 @@
 #define kStrSpeedStopped "stopped toggle (^h)"
 #define kStrSpeedBackToggle "run in Background toggle (^b)"
 #define kStrSpeedAutoSlowToggle "autosloW toggle (^l)"
+#define kStrSpeedClockMult "Cpu clock multiplier (^c)"
+#define kStrSpeedFastTiming "fast Timing toggle (^t)"
+#define kStrSpeedDynarec "dynamic Recompiler (^j)"
 #define kStrSpeedExit "Exit speed control"
 
 #define kStrNewSpeed "Speed: ^s"
@@ -110,6 +113,10 @@
 #define kStrNewStopped "Stopped is ^h."
 #define kStrNewRunInBack "Run in background is ^b."
 #define kStrNewAutoSlow "AutoSlow is ^l."
+#define kStrNewClockMult "Cpu clock multiplier is ^c."
+#define kStrNewFastTiming "Fast timing is ^t."
+#define kStrNewDynarec "Dynamic recompiler is ^j."
+#define kStrDynarecCheck "checked against the interpreter"
 
 #define kStrNewMagnify "Magnify is ^g."
 
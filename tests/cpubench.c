@@ -0,0 +1,335 @@
+/*
+	cpubench.c
+
+	Times the emulated 68000 on a desktop, with everything but
+	src/MYOSGLUE.c, which this replaces. No Mac ROM is needed:
+	a small program of the usual sort (a fill loop, a checksum
+	loop, and a subroutine with LINK, MOVEM, UNLK and RTS) is
+	built in place of the ROM, and counts its iterations in
+	memory. It runs for a while at each clock multiplier (1x,
+	2x, 4x and 8x, see ClockMultValue) and prints, for each:
+
+		emulated MIPS, 68000 instructions per emulated second,
+		which should double with each setting;
+
+		host MIPS, 68000 instructions per second of host time,
+		which says how fast the interpreter is, and so should
+		stay about the same.
+
+	Builds on any desktop:
+
+		cc -O2 -I../src -o cpubench cpubench.c \
+			../src/[!M]*.c ../src/M[!Y]*.c
+
+	and to compare the dispatch of the interpreter, threaded
+	(the default) with the plain switch, once more with
+	-DWantThreadedDispatch=0 -DWantFusedOps=0, and the block cache
+	with -DWantBlockCache=1 -DWantFusedOps=0.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "SYSDEPNS.h"
+#include "MYOSGLUE.h"
+#include "EMCONFIG.h"
+#include "GLOBGLUE.h"
+#include "PROGMAIN.h"
+
+#define kMinSeconds 2.0
+#define kNumClockMults (EnableClockMult ? 4 : 1)
+
+/* where the program starts, and counts, as the cpu sees them */
+#define kProgAddr (kROM_Base + 0x800)
+#define kCountAddr 0x00600400
+#define kInstrsPerIter 280
+
+/* the platform interface, for ProgramMain */
+
+GLOBALVAR ui3p ROM = nullpr;
+GLOBALVAR ui5b vSonyWritableMask = 0;
+GLOBALVAR ui5b vSonyInsertedMask = 0;
+GLOBALVAR ui5b OnTrueTime = 0;
+GLOBALVAR ui5b CurMacDateInSeconds = 0;
+GLOBALVAR ui5b CurMacLatitude = 0;
+GLOBALVAR ui5b CurMacLongitude = 0;
+GLOBALVAR ui5b CurMacDelta = 0;
+#if EnableScreenDirtyRows
+GLOBALVAR ui5b ScreenDirtyRows[kScreenDirtyRowsN];
+#endif
+GLOBALVAR blnr EmVideoDisable = falseblnr;
+GLOBALVAR si3b EmLagTime = 0;
+GLOBALVAR ui3b EmIdlePercent = 0;
+GLOBALVAR ui4r EmMaxRowsDrawn = vMacScreenHeight;
+GLOBALVAR ui5b EmRowsDeferred = 0;
+GLOBALVAR blnr ForceMacOff = falseblnr;
+GLOBALVAR blnr WantMacInterrupt = falseblnr;
+GLOBALVAR blnr WantMacReset = falseblnr;
+GLOBALVAR ui3b SpeedValue = 0;
+#if EnableFastTiming
+GLOBALVAR blnr WantFastTiming = falseblnr;
+#endif
+#if EnableClockMult
+GLOBALVAR ui3b ClockMultValue = 0;
+#endif
+#if EnableDynarec
+GLOBALVAR ui3b DynarecMode = 0;
+#endif
+GLOBALVAR ui4b CurMouseV = 0;
+GLOBALVAR ui4b CurMouseH = 0;
+
+GLOBALPROC WarnMsgCorruptedROM(void)
+{
+}
+
+GLOBALPROC WarnMsgUnsupportedROM(void)
+{
+}
+
+GLOBALPROC WarnMsgAbnormal(void)
+{
+	fprintf(stderr, "abnormal situation\n");
+}
+
+GLOBALPROC MyMoveBytes(anyp srcPtr, anyp destPtr, si5b byteCount)
+{
+	memmove(destPtr, srcPtr, byteCount);
+}
+
+GLOBALFUNC tMacErr vSonyTransfer(blnr IsWrite, ui3p Buffer,
+	tDrive Drive_No, ui5r Sony_Start, ui5r Sony_Count,
+	ui5r *Sony_ActCount)
+{
+	UnusedParam(IsWrite);
+	UnusedParam(Buffer);
+	UnusedParam(Drive_No);
+	UnusedParam(Sony_Start);
+	UnusedParam(Sony_Count);
+	UnusedParam(Sony_ActCount);
+	return mnvm_offLinErr;
+}
+
+GLOBALFUNC tMacErr vSonyEject(tDrive Drive_No)
+{
+	UnusedParam(Drive_No);
+	return mnvm_offLinErr;
+}
+
+GLOBALFUNC tMacErr vSonyGetSize(tDrive Drive_No, ui5r *Sony_Count)
+{
+	UnusedParam(Drive_No);
+	UnusedParam(Sony_Count);
+	return mnvm_offLinErr;
+}
+
+GLOBALFUNC blnr AnyDiskInserted(void)
+{
+	return falseblnr;
+}
+
+GLOBALPROC DiskRevokeWritable(tDrive Drive_No)
+{
+	UnusedParam(Drive_No);
+}
+
+GLOBALFUNC ui5r GetHostMicroseconds(void)
+{
+	return 0;
+}
+
+GLOBALFUNC ui5r GetPresentMicroseconds(void)
+{
+	return 0;
+}
+
+GLOBALPROC Screen_OutputFrame(ui3p screencurrentbuff)
+{
+	UnusedParam(screencurrentbuff);
+}
+
+GLOBALPROC DoneWithDrawingForTick(void)
+{
+}
+
+GLOBALFUNC blnr ExtraTimeNotOver(void)
+{
+	return falseblnr;
+}
+
+GLOBALFUNC MyEvtQEl * MyEvtQOutP(void)
+{
+	return nullpr;
+}
+
+GLOBALPROC MyEvtQOutDone(void)
+{
+}
+
+/* memory, in one block, sized by a first pass */
+
+static ui3p BigBlock = nullpr;
+static uimr AllocOffset;
+
+GLOBALPROC ReserveAllocOneBlock(ui3p *p, uimr n, ui3r align,
+	blnr FillOnes)
+{
+	AllocOffset = (AllocOffset + ((1 << align) - 1))
+		& ~ (uimr)((1 << align) - 1);
+	if (nullpr == BigBlock) {
+		*p = nullpr;
+	} else {
+		*p = BigBlock + AllocOffset;
+		if (FillOnes) {
+			memset(*p, 0xFF, n);
+		}
+	}
+	AllocOffset += n;
+}
+
+static void AllocAll(void)
+{
+	AllocOffset = 0;
+	ReserveAllocOneBlock(&ROM, kROM_Size, 5, falseblnr);
+	EmulationReserveAlloc();
+}
+
+/* the program */
+
+static const ui4b Prog[] = {
+	0x41F9, 0x0060, 0x0000, /* lea $600000, a0 */
+	0x7E00,                 /* moveq #0, d7 */
+	                        /* loop: */
+	0x2248,                 /* movea.l a0, a1 */
+	0x303C, 0x003F,         /* move.w #63, d0 */
+	0x22C7,                 /* fill: move.l d7, (a1)+ */
+	0x51C8, 0xFFFC,         /* dbf d0, fill */
+	0x2248,                 /* movea.l a0, a1 */
+	0x7200,                 /* moveq #0, d1 */
+	0x303C, 0x003F,         /* move.w #63, d0 */
+	0xD299,                 /* sum: add.l (a1)+, d1 */
+	0x51C8, 0xFFFC,         /* dbf d0, sum */
+	0x6100, 0x0018,         /* bsr.w sub */
+	0x4A81,                 /* tst.l d1 */
+	0x6702,                 /* beq.s 1f */
+	0x5282,                 /* addq.l #1, d2 */
+	0xB481,                 /* 1: cmp.l d1, d2 */
+	0x6602,                 /* bne.s 2f */
+	0x4E71,                 /* nop */
+	0x5287,                 /* 2: addq.l #1, d7 */
+	0x23C7, 0x0060, 0x0400, /* move.l d7, $600400 */
+	0x60CC,                 /* bra.s loop */
+	                        /* sub: */
+	0x4E56, 0xFFF8,         /* link a6, #-8 */
+	0x48E7, 0xE0C0,         /* movem.l d0-d2/a0-a1, -(sp) */
+	0x2D41, 0xFFFC,         /* move.l d1, -4(a6) */
+	0x2001,                 /* move.l d1, d0 */
+	0xE588,                 /* lsl.l #2, d0 */
+	0x4680,                 /* not.l d0 */
+	0xC0BC, 0x00FF, 0x00FF, /* and.l #$00FF00FF, d0 */
+	0x4CDF, 0x0307,         /* movem.l (sp)+, d0-d2/a0-a1 */
+	0x4E5E,                 /* unlk a6 */
+	0x4E75                  /* rts */
+};
+	/*
+		kInstrsPerIter is 2 * 64 for each loop, 10 in the
+		subroutine, and 14 more, the nop being skipped.
+	*/
+
+static void PutLong(ui3p p, ui5r v)
+{
+	p[0] = v >> 24;
+	p[1] = v >> 16;
+	p[2] = v >> 8;
+	p[3] = v;
+}
+
+static void MakeROM(void)
+{
+	ui3p p = ROM + (kProgAddr - kROM_Base);
+	uimr i;
+
+	memset(ROM, 0, kROM_Size);
+
+	/* the reset vectors, seen at 0 while the ROM overlays RAM */
+	PutLong(ROM, 0x00608000);
+	PutLong(ROM + 4, kProgAddr);
+
+	for (i = 0; i < sizeof(Prog) / sizeof(Prog[0]); ++i) {
+		p[0] = Prog[i] >> 8;
+		p[1] = Prog[i];
+		p += 2;
+	}
+}
+
+static ui5r GetCount(void)
+{
+	/* while the ROM overlays RAM, RAM is at $600000 */
+	ui5r a = kCountAddr & (kRAM_Size - 1);
+	ui5r v = 0;
+	int i;
+
+	for (i = 0; i < 4; ++i) {
+		v = (v << 8) | RAM[(a + i) ^ WantWordSwappedMem];
+	}
+	return v;
+}
+
+/* the measurements, one per clock multiplier */
+
+static int ClockMult = 0;
+static clock_t PhaseStart;
+static ui5r PhaseTicks;
+static ui5r PhaseCount;
+
+GLOBALPROC WaitForNextTick(void)
+{
+	double Seconds = (double)(clock() - PhaseStart) / CLOCKS_PER_SEC;
+
+	if (Seconds >= kMinSeconds) {
+		double Instrs = (double)(ui5r)(GetCount() - PhaseCount)
+			* kInstrsPerIter;
+
+		printf("%2dx  %12.2f  %9.2f\n", 1 << ClockMult,
+			Instrs / PhaseTicks * 60.15 / 1e6,
+			Instrs / Seconds / 1e6);
+
+		if (++ClockMult >= kNumClockMults) {
+			ForceMacOff = trueblnr;
+			return;
+		}
+		PhaseStart = clock();
+		PhaseTicks = 0;
+		PhaseCount = GetCount();
+	}
+
+#if EnableClockMult
+	ClockMultValue = ClockMult;
+#endif
+	++PhaseTicks;
+	++OnTrueTime;
+}
+
+int main(void)
+{
+	AllocAll();
+	BigBlock = calloc(1, AllocOffset);
+	if (nullpr == BigBlock) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+	AllocAll();
+	MakeROM();
+
+	printf("%s dispatch\n",
+		WantThreadedDispatch ? "threaded" : "switch");
+	printf("mult  emulated MIPS  host MIPS\n");
+	PhaseStart = clock();
+	PhaseTicks = 0;
+	PhaseCount = 0;
+
+	ProgramMain();
+
+	return 0;
+}
@@ -0,0 +1,242 @@
+/*
+	framepipe_bench.c
+
+	Times src/FRAMEPIPE.c on a 512 x 342 screen with 1 to 4
+	workers, in microseconds per frame, for a frame with one
+	band of 8 rows changed, as when typing, a 200 x 100 pixel
+	rectangle, as when a menu drops, and every row changed, as
+	when scrolling. For each it gives:
+
+		copy	what is left on the emulation thread, the copy
+			of the frame for the workers
+		longest	the longest of the workers' shares, timed one
+			after another, which is how long a frame takes
+			with a core for each worker; with 1 worker it
+			is the whole compare and conversion
+		threads	the time to run the workers on threads of a
+			pool, as the 3DS build does, from the start of
+			the frame to the last worker done
+
+	threads only drops with the number of workers when the host
+	has that many cores to spare.
+
+	Builds on any desktop:
+
+		cc -O2 -I../src -o framepipe_bench framepipe_bench.c \
+			../src/FRAMEPIPE.c ../src/SCRNDIFF.c ../src/PIXCONV.c \
+			-lpthread
+*/
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "SYSDEPNS.h"
+#include "PIXCONV.h"
+#include "FRAMEPIPE.h"
+
+#define kWidth 512
+#define kHeight 342
+#define kByteWidth (kWidth / 8)
+#define kBandRows 8
+#define kDstPitch (512 * 2)
+#define kMinSeconds 0.5
+
+static union {
+	double Align;
+	ui3b b[kHeight * kByteWidth];
+} Frame[2], Prev, Snap;
+
+static ui3b Dst[kHeight * kDstPitch];
+
+/* called through this so the copy isn't optimized away */
+static void *(* volatile CopyBytes)(void *, const void *, size_t)
+	= memcpy;
+
+static ui4r MonoLevels[2] = { 0xFFFF, 0x0000 };
+static PixConv Conv;
+static FramePipe p;
+
+/* the pool, woken by a new Gen, Left counting down to done */
+static pthread_mutex_t PoolLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t PoolGo = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t PoolDone = PTHREAD_COND_INITIALIZER;
+static unsigned long PoolGen = 0;
+static int PoolLeft = 0;
+static int PoolStop = 0;
+static uimr WorkerNum[kFramePipeMaxWorkers] = { 0, 1, 2, 3 };
+
+static double Now(void)
+{
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static void *Worker(void *Arg)
+{
+	unsigned long Gen = 0;
+
+	for (;;) {
+		pthread_mutex_lock(&PoolLock);
+		while ((Gen == PoolGen) && ! PoolStop) {
+			pthread_cond_wait(&PoolGo, &PoolLock);
+		}
+		Gen = PoolGen;
+		pthread_mutex_unlock(&PoolLock);
+		if (PoolStop) {
+			return NULL;
+		}
+		if (*(uimr *)Arg >= p.NumWorkers) {
+			continue;
+		}
+
+		FramePipeWork(&p, *(uimr *)Arg);
+
+		pthread_mutex_lock(&PoolLock);
+		if (0 == --PoolLeft) {
+			pthread_cond_signal(&PoolDone);
+		}
+		pthread_mutex_unlock(&PoolLock);
+	}
+}
+
+static void PoolFrame(ui3p Cur, int NumWorkers)
+{
+	FramePipeStart(&p, Cur, NumWorkers);
+	pthread_mutex_lock(&PoolLock);
+	PoolLeft = NumWorkers;
+	++PoolGen;
+	pthread_cond_broadcast(&PoolGo);
+	while (0 != PoolLeft) {
+		pthread_cond_wait(&PoolDone, &PoolLock);
+	}
+	pthread_mutex_unlock(&PoolLock);
+}
+
+/* Frame 1 is frame 0 with rows Top to Bottom, Left to Right inverted */
+static void SetFrames(int Top, int Left, int Bottom, int Right)
+{
+	int h;
+	int v;
+	int i;
+
+	for (i = 0; i < kHeight * kByteWidth; ++i) {
+		Frame[0].b[i] = rand();
+	}
+	memcpy(Frame[1].b, Frame[0].b, sizeof(Frame[0].b));
+	for (v = Top; v < Bottom; ++v) {
+		for (h = Left; h < Right; ++h) {
+			Frame[1].b[v * kByteWidth + h / 8] ^= 0x80 >> (h & 7);
+		}
+	}
+	memcpy(Prev.b, Frame[0].b, sizeof(Prev.b));
+}
+
+static double CopyMicroseconds(void)
+{
+	double t0 = Now();
+	double t;
+	long n = 0;
+
+	do {
+		CopyBytes(Snap.b, Frame[n & 1].b, sizeof(Snap.b));
+		++n;
+	} while ((t = Now() - t0) < kMinSeconds);
+
+	return t * 1e6 / n;
+}
+
+/* the longest share of NumWorkers, or with 1 the whole frame */
+static double LongestMicroseconds(int NumWorkers)
+{
+	double Sum[kFramePipeMaxWorkers];
+	double Longest = 0;
+	double t0 = Now();
+	double t1;
+	long n = 0;
+	int w;
+
+	for (w = 0; w < NumWorkers; ++w) {
+		Sum[w] = 0;
+	}
+	do {
+		++n;
+		FramePipeStart(&p, Frame[n & 1].b, NumWorkers);
+		for (w = 0; w < NumWorkers; ++w) {
+			t1 = Now();
+			FramePipeWork(&p, w);
+			Sum[w] += Now() - t1;
+		}
+	} while (Now() - t0 < kMinSeconds);
+
+	for (w = 0; w < NumWorkers; ++w) {
+		if (Sum[w] > Longest) {
+			Longest = Sum[w];
+		}
+	}
+	return Longest * 1e6 / n;
+}
+
+static double ThreadsMicroseconds(int NumWorkers)
+{
+	double t0 = Now();
+	double t;
+	long n = 0;
+
+	do {
+		++n;
+		PoolFrame(Frame[n & 1].b, NumWorkers);
+	} while ((t = Now() - t0) < kMinSeconds);
+
+	return t * 1e6 / n;
+}
+
+static void BenchFrames(char *Name, int Top, int Left,
+	int Bottom, int Right)
+{
+	int NumWorkers;
+
+	SetFrames(Top, Left, Bottom, Right);
+	printf("%s, copy %.1f\n", Name, CopyMicroseconds());
+	printf("workers  longest  threads\n");
+	for (NumWorkers = 1; NumWorkers <= kFramePipeMaxWorkers;
+		++NumWorkers)
+	{
+		printf("%7d  %7.1f  %7.1f\n", NumWorkers,
+			LongestMicroseconds(NumWorkers),
+			ThreadsMicroseconds(NumWorkers));
+	}
+}
+
+int main(void)
+{
+	pthread_t t[kFramePipeMaxWorkers];
+	int w;
+
+	srand(1);
+	PixConvSetup(&Conv, 0, kPixFmtRGB565,
+		MonoLevels, MonoLevels, MonoLevels);
+	FramePipeSetup(&p, kWidth, kHeight, kBandRows, Prev.b,
+		Dst, kDstPitch, &Conv);
+	for (w = 0; w < kFramePipeMaxWorkers; ++w) {
+		pthread_create(&t[w], NULL, Worker, &WorkerNum[w]);
+	}
+
+	BenchFrames("one band", 160, 0, 168, kWidth);
+	BenchFrames("menu", 20, 100, 120, 300);
+	BenchFrames("whole screen", 0, 0, kHeight, kWidth);
+
+	pthread_mutex_lock(&PoolLock);
+	PoolStop = 1;
+	pthread_cond_broadcast(&PoolGo);
+	pthread_mutex_unlock(&PoolLock);
+	for (w = 0; w < kFramePipeMaxWorkers; ++w) {
+		pthread_join(t[w], NULL);
+	}
+
+	return 0;
+}
@@ -0,0 +1,236 @@
+/*
+	framepipe_test.c
+
+	Checks src/FRAMEPIPE.c against a serial compare and
+	conversion, with 1 to 4 workers each on a thread of its
+	own: a run of frames of a 512 x 342 screen, each with a few
+	random rectangles, lines or single pixels changed, some
+	with nothing changed and some with all of it. After each
+	frame the changed rectangle and bands must be those of a
+	pixel at a time compare, Prev must be the frame, and the
+	converted pixels must be the whole frame converted.
+
+	Builds on any desktop:
+
+		cc -O2 -I../src -o framepipe_test framepipe_test.c \
+			../src/FRAMEPIPE.c ../src/SCRNDIFF.c ../src/PIXCONV.c \
+			-lpthread
+
+	Prints "ok" and exits with 0 if everything matches.
+*/
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SYSDEPNS.h"
+#include "PIXCONV.h"
+#include "FRAMEPIPE.h"
+
+#define kWidth 512
+#define kHeight 342
+#define kByteWidth (kWidth / 8)
+#define kBandRows 8
+#define kNumBands ((kHeight + kBandRows - 1) / kBandRows)
+#define kDstPitch (512 * 2)
+#define kFrames 300
+
+static union {
+	double Align;
+	ui3b b[kHeight * kByteWidth];
+} Frame, Prev, Old;
+
+static ui3b Dst[kHeight * kDstPitch];
+static ui3b RefDst[kHeight * kDstPitch];
+
+static ui4r MonoLevels[2] = { 0xFFFF, 0x0000 };
+static PixConv Conv;
+static FramePipe p;
+
+static unsigned long NumChecks = 0;
+static unsigned long NumFailures = 0;
+
+static void Fail(char *s, int NumWorkers, int n)
+{
+	if (++NumFailures <= 10) {
+		fprintf(stderr, "%s: %d workers, frame %d\n", s, NumWorkers, n);
+	}
+}
+
+static int GetPixel(ui3b *b, int h, int v)
+{
+	return (b[v * kByteWidth + h / 8] >> (7 - (h & 7))) & 1;
+}
+
+static void FlipPixel(int h, int v)
+{
+	Frame.b[v * kByteWidth + h / 8] ^= 0x80 >> (h & 7);
+}
+
+static void ChangeFrame(void)
+{
+	int k = rand() % 8;
+	int n = rand() % 4;
+	int top;
+	int left;
+	int bottom;
+	int right;
+	int h;
+	int v;
+
+	if (0 == k) {
+		/* nothing changed */
+	} else if (1 == k) {
+		for (v = 0; v < kHeight * kByteWidth; ++v) {
+			Frame.b[v] = rand();
+		}
+	} else {
+		while (n-- >= 0) {
+			top = rand() % kHeight;
+			left = rand() % kWidth;
+			bottom = top + 1 + rand() % ((2 == k) ? 2 : 40);
+			right = left + 1 + rand() % ((3 == k) ? 2 : 200);
+			if (bottom > kHeight) {
+				bottom = kHeight;
+			}
+			if (right > kWidth) {
+				right = kWidth;
+			}
+			for (v = top; v < bottom; ++v) {
+				for (h = left; h < right; ++h) {
+					FlipPixel(h, v);
+				}
+			}
+		}
+	}
+}
+
+static uimr WorkerNum[kFramePipeMaxWorkers] = { 0, 1, 2, 3 };
+
+static void *Worker(void *Arg)
+{
+	FramePipeWork(&p, *(uimr *)Arg);
+	return NULL;
+}
+
+static void RunWorkers(int NumWorkers)
+{
+	pthread_t t[kFramePipeMaxWorkers];
+	int w;
+
+	FramePipeStart(&p, Frame.b, NumWorkers);
+	for (w = 0; w < NumWorkers; ++w) {
+		pthread_create(&t[w], NULL, Worker, &WorkerNum[w]);
+	}
+	for (w = 0; w < NumWorkers; ++w) {
+		pthread_join(t[w], NULL);
+	}
+}
+
+static void Check(int NumWorkers, int n)
+{
+	ui5b Bands[kFramePipeBandWords];
+	ui5b RefBands[kFramePipeBandWords];
+	uimr Top;
+	uimr Left;
+	uimr Bottom;
+	uimr Right;
+	int RefTop = kHeight;
+	int RefLeft = kWidth;
+	int RefBottom = 0;
+	int RefRight = 0;
+	blnr Changed;
+	int h;
+	int v;
+
+	memset(RefBands, 0, sizeof(RefBands));
+	for (v = 0; v < kHeight; ++v) {
+		for (h = 0; h < kWidth; ++h) {
+			if (GetPixel(Frame.b, h, v) != GetPixel(Old.b, h, v)) {
+				if (v < RefTop) {
+					RefTop = v;
+				}
+				if (h < RefLeft) {
+					RefLeft = h;
+				}
+				RefBottom = v + 1;
+				if (h + 1 > RefRight) {
+					RefRight = h + 1;
+				}
+				RefBands[v / kBandRows / 32] |=
+					(ui5b)1 << ((v / kBandRows) & 31);
+			}
+		}
+	}
+
+	++NumChecks;
+	Changed = FramePipeResult(&p, Bands, &Top, &Left, &Bottom, &Right);
+	if (Changed != (RefBottom > RefTop)) {
+		Fail("changed differs", NumWorkers, n);
+	} else if (Changed && ((Top != RefTop) || (Left != RefLeft)
+		|| (Bottom != RefBottom) || (Right != RefRight)))
+	{
+		Fail("rectangle differs", NumWorkers, n);
+	} else if (0 != memcmp(Bands, RefBands,
+		((kNumBands + 31) / 32) * sizeof(ui5b)))
+	{
+		Fail("bands differ", NumWorkers, n);
+	}
+
+	++NumChecks;
+	if (0 != memcmp(Prev.b, Frame.b, sizeof(Frame.b))) {
+		Fail("prev differs", NumWorkers, n);
+	}
+
+	++NumChecks;
+	PixConvRect(&Conv, Frame.b, kByteWidth, RefDst, kDstPitch,
+		kWidth, kHeight);
+	if (0 != memcmp(Dst, RefDst, sizeof(Dst))) {
+		Fail("pixels differ", NumWorkers, n);
+	}
+}
+
+static void CheckWorkers(int NumWorkers)
+{
+	int n;
+
+	for (n = 0; n < kHeight * kByteWidth; ++n) {
+		Frame.b[n] = rand();
+	}
+	memcpy(Prev.b, Frame.b, sizeof(Frame.b));
+	memset(Dst, 0, sizeof(Dst));
+	PixConvRect(&Conv, Frame.b, kByteWidth, Dst, kDstPitch,
+		kWidth, kHeight);
+	FramePipeSetup(&p, kWidth, kHeight, kBandRows, Prev.b,
+		Dst, kDstPitch, &Conv);
+
+	for (n = 0; n < kFrames; ++n) {
+		memcpy(Old.b, Frame.b, sizeof(Frame.b));
+		ChangeFrame();
+		RunWorkers(NumWorkers);
+		Check(NumWorkers, n);
+	}
+}
+
+int main(void)
+{
+	int NumWorkers;
+
+	srand(1);
+	memset(RefDst, 0, sizeof(RefDst));
+	PixConvSetup(&Conv, 0, kPixFmtRGB565,
+		MonoLevels, MonoLevels, MonoLevels);
+	for (NumWorkers = 1; NumWorkers <= kFramePipeMaxWorkers;
+		++NumWorkers)
+	{
+		CheckWorkers(NumWorkers);
+	}
+
+	if (0 != NumFailures) {
+		printf("%lu of %lu checks failed\n", NumFailures, NumChecks);
+		return 1;
+	}
+	printf("ok, %lu checks\n", NumChecks);
+	return 0;
+}
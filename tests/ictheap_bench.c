@@ -0,0 +1,140 @@
+/*
+	ictheap_bench.c
+
+	Times src/ICTHEAP.c next to a copy of the bitmask it
+	replaced, scanned in task id order, in nanoseconds per slice:
+	at each slice the tasks due are taken off and set again, and
+	then the time to the next is found, as PROGMAIN.c does. The
+	tasks are a 60 Hz tick, its 16 sub ticks, and the rest
+	timers with periods of up to a couple of ticks, which is
+	about what a Mac II with sound on schedules, and then more
+	of them, up to as many as the bitmask has bits.
+
+	Builds on any desktop:
+
+		cc -O2 -I../src -o ictheap_bench ictheap_bench.c ../src/ICTHEAP.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "SYSDEPNS.h"
+#include "ICTHEAP.h"
+
+#define kMaxTasks 64
+#define kCyclesPerTick 130000
+#define kSlices 2000000
+
+typedef unsigned long long BitMask;
+
+static ui5b Period[kMaxTasks];
+
+static ui4b Heap[kMaxTasks];
+static ui4b Pos[kMaxTasks];
+static ui5b When[kMaxTasks];
+static ICTHeap h;
+
+static BitMask Active;
+static ui5b ActiveWhen[kMaxTasks];
+
+static ui5b Now;
+static ui5b Sum;
+
+static void SetPeriods(int NumTasks)
+{
+	int i;
+
+	Period[0] = kCyclesPerTick;
+	for (i = 1; i < NumTasks; ++i) {
+		Period[i] = (1 == i) ? kCyclesPerTick / 16
+			: 1000 + rand() % (2 * kCyclesPerTick);
+	}
+}
+
+static void HeapSlices(int NumTasks)
+{
+	unsigned long n;
+	int taskid;
+	int i;
+
+	ICTHeapInit(&h, Heap, Pos, When, NumTasks);
+	Now = 0;
+	for (i = 0; i < NumTasks; ++i) {
+		ICTHeapAdd(&h, i, Now + Period[i]);
+	}
+
+	for (n = 0; n < kSlices; ++n) {
+		while ((! ICTHeapEmpty(&h)) && (ICTHeapFirstWhen(&h) == Now)) {
+			taskid = ICTHeapFirst(&h);
+			ICTHeapCancel(&h, taskid);
+			ICTHeapAdd(&h, taskid, Now + Period[taskid]);
+		}
+		Now = ICTHeapFirstWhen(&h);
+		Sum += Now;
+	}
+}
+
+static void BitMaskSlices(int NumTasks)
+{
+	unsigned long n;
+	BitMask m;
+	ui5b v;
+	ui5b d;
+	int i;
+
+	Active = 0;
+	Now = 0;
+	for (i = 0; i < NumTasks; ++i) {
+		ActiveWhen[i] = Now + Period[i];
+		Active |= (BitMask)1 << i;
+	}
+
+	for (n = 0; n < kSlices; ++n) {
+		for (i = 0, m = Active; 0 != m; ++i, m >>= 1) {
+			if ((0 != (m & 1)) && (ActiveWhen[i] == Now)) {
+				Active &= ~ ((BitMask)1 << i);
+				ActiveWhen[i] = Now + Period[i];
+				Active |= (BitMask)1 << i;
+			}
+		}
+		v = kCyclesPerTick * 4;
+		for (i = 0, m = Active; 0 != m; ++i, m >>= 1) {
+			if (0 != (m & 1)) {
+				d = ActiveWhen[i] - Now;
+				if (d < v) {
+					v = d;
+				}
+			}
+		}
+		Now += v;
+		Sum += Now;
+	}
+}
+
+static double NanosecondsPerSlice(void (*Slices)(int NumTasks),
+	int NumTasks)
+{
+	clock_t t0 = clock();
+
+	Slices(NumTasks);
+	return (double)(clock() - t0) / CLOCKS_PER_SEC * 1e9 / kSlices;
+}
+
+int main(void)
+{
+	static const int NumTasks[] = { 5, 10, 16, 32, 64 };
+	int i;
+
+	srand(1);
+	printf("tasks  bitmask ns  heap ns\n");
+	for (i = 0; i < (int)(sizeof(NumTasks) / sizeof(int)); ++i) {
+		SetPeriods(NumTasks[i]);
+		printf("%5d  %10.1f  %7.1f\n", NumTasks[i],
+			NanosecondsPerSlice(BitMaskSlices, NumTasks[i]),
+			NanosecondsPerSlice(HeapSlices, NumTasks[i]));
+	}
+
+	/* so the work isn't optimized away */
+	return (0 == Sum) ? 1 : 0;
+}
@@ -0,0 +1,147 @@
+/*
+	ictheap_test.c
+
+	Checks src/ICTHEAP.c against a scan of every task, the way
+	pending tasks were found when they were a bitmask: random
+	adds, moves and cancels of up to kMaxTasks tasks, with
+	deadlines close together so ties are common, and near the
+	point where the time wraps around. After each, the first
+	task, its deadline and which tasks are pending must match,
+	and taking every task off in turn must give them in the
+	scan's order.
+
+	Builds on any desktop:
+
+		cc -O2 -I../src -o ictheap_test ictheap_test.c ../src/ICTHEAP.c
+
+	Prints "ok" and exits with 0 if everything matches.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SYSDEPNS.h"
+#include "ICTHEAP.h"
+
+#define kMaxTasks 100
+
+static ui4b Heap[kMaxTasks];
+static ui4b Pos[kMaxTasks];
+static ui5b When[kMaxTasks];
+static ICTHeap h;
+
+static blnr RefPending[kMaxTasks];
+static ui5b RefWhen[kMaxTasks];
+
+static unsigned long NumChecks = 0;
+static unsigned long NumFailures = 0;
+
+static void Fail(char *s, int NumTasks, int n)
+{
+	if (++NumFailures <= 10) {
+		fprintf(stderr, "%s: %d tasks, step %d\n", s, NumTasks, n);
+	}
+}
+
+/* the first due, ties to the lower id, or -1 */
+static int RefFirst(int NumTasks, ui5b Now)
+{
+	int First = -1;
+	int i;
+
+	for (i = 0; i < NumTasks; ++i) {
+		if (RefPending[i] && ((First < 0)
+			|| (RefWhen[i] - Now < RefWhen[First] - Now)))
+		{
+			First = i;
+		}
+	}
+	return First;
+}
+
+static void Check(int NumTasks, ui5b Now, int n)
+{
+	int First = RefFirst(NumTasks, Now);
+	int i;
+
+	++NumChecks;
+	if ((First < 0) != ICTHeapEmpty(&h)) {
+		Fail("empty differs", NumTasks, n);
+		return;
+	}
+	if ((First >= 0) && ((First != ICTHeapFirst(&h))
+		|| (RefWhen[First] != ICTHeapFirstWhen(&h))))
+	{
+		Fail("first differs", NumTasks, n);
+		return;
+	}
+	for (i = 0; i < NumTasks; ++i) {
+		if (RefPending[i] != ICTHeapPending(&h, i)) {
+			Fail("pending differs", NumTasks, n);
+			return;
+		}
+	}
+}
+
+static void CheckTasks(int NumTasks, ui5b Now, int Spread)
+{
+	int First;
+	int n;
+	int i;
+
+	ICTHeapInit(&h, Heap, Pos, When, NumTasks);
+	memset(RefPending, 0, sizeof(RefPending));
+
+	for (n = 0; n < 20000; ++n) {
+		i = rand() % NumTasks;
+		if (0 == rand() % 3) {
+			ICTHeapCancel(&h, i);
+			RefPending[i] = falseblnr;
+		} else {
+			RefWhen[i] = Now + 1 + rand() % Spread;
+			RefPending[i] = trueblnr;
+			ICTHeapAdd(&h, i, RefWhen[i]);
+		}
+		Check(NumTasks, Now, n);
+
+		/* now and then, time moves on to the first task */
+		if ((0 == rand() % 16) && ! ICTHeapEmpty(&h)) {
+			Now = ICTHeapFirstWhen(&h) - 1;
+		}
+	}
+
+	/* all taken off in order */
+	while (0 <= (First = RefFirst(NumTasks, Now))) {
+		++NumChecks;
+		if (ICTHeapEmpty(&h) || (First != ICTHeapFirst(&h))) {
+			Fail("order differs", NumTasks, n);
+			return;
+		}
+		ICTHeapCancel(&h, First);
+		RefPending[First] = falseblnr;
+	}
+	++NumChecks;
+	if (! ICTHeapEmpty(&h)) {
+		Fail("not empty at the end", NumTasks, n);
+	}
+}
+
+int main(void)
+{
+	int NumTasks;
+
+	srand(1);
+	for (NumTasks = 1; NumTasks <= kMaxTasks; NumTasks += 3) {
+		CheckTasks(NumTasks, 0, 4);
+		CheckTasks(NumTasks, 0, 100000);
+		CheckTasks(NumTasks, (ui5b)0 - 50000, 100000);
+	}
+
+	if (0 != NumFailures) {
+		printf("%lu of %lu checks failed\n", NumFailures, NumChecks);
+		return 1;
+	}
+	printf("ok, %lu checks\n", NumChecks);
+	return 0;
+}
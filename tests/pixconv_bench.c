@@ -0,0 +1,128 @@
+/*
+	pixconv_bench.c
+
+	Times src/PIXCONV.c converting a whole 512 x 342 screen,
+	for every depth and output format, in megapixels per
+	second, next to a pixel at a time loop for comparison.
+
+	Builds on any desktop:
+
+		cc -O2 -I../src -o pixconv_bench pixconv_bench.c ../src/PIXCONV.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "SYSDEPNS.h"
+#include "PIXCONV.h"
+
+#define kWidth 512
+#define kHeight 342
+#define kMinSeconds 0.5
+
+static ui4r Reds[256];
+static ui4r Greens[256];
+static ui4r Blues[256];
+
+static ui3b Src[kWidth * kHeight];
+static ui3b Dst[kWidth * kHeight * 4];
+
+static PixConv Conv;
+
+static void PixelLoop(int Depth, int Format)
+{
+	/* what one pixel at a time costs, with a palette in place */
+	int Bits = 1 << Depth;
+	int Mask = (1 << Bits) - 1;
+	int SrcPitch = kWidth * Bits / 8;
+	int x;
+	int y;
+	int bit;
+	int i;
+
+	for (y = 0; y < kHeight; ++y) {
+		ui3p s = Src + y * SrcPitch;
+
+		if (kPixFmtRGBA8 == Format) {
+			ui3p d = Dst + y * kWidth * 4;
+
+			for (x = 0; x < kWidth; ++x) {
+				bit = x * Bits;
+				i = (s[bit >> 3] >> (8 - Bits - (bit & 7))) & Mask;
+				d[0] = 0xFF;
+				d[1] = Blues[i] >> 8;
+				d[2] = Greens[i] >> 8;
+				d[3] = Reds[i] >> 8;
+				d += 4;
+			}
+		} else {
+			ui3p d = Dst + y * kWidth * 2;
+
+			for (x = 0; x < kWidth; ++x) {
+				unsigned v;
+
+				bit = x * Bits;
+				i = (s[bit >> 3] >> (8 - Bits - (bit & 7))) & Mask;
+				v = ((Reds[i] >> 8) & 0xF8) << 8
+					| ((Greens[i] >> 8) & 0xFC) << 3
+					| (Blues[i] >> 11);
+				d[0] = v;
+				d[1] = v >> 8;
+				d += 2;
+			}
+		}
+	}
+}
+
+static double MegaPixelsPerSecond(int Depth, int Format, int UseConv)
+{
+	int SrcPitch = kWidth * (1 << Depth) / 8;
+	int PixelBytes = (kPixFmtRGBA8 == Format) ? 4 : 2;
+	unsigned long Frames = 0;
+	clock_t t0 = clock();
+	double Seconds;
+
+	do {
+		if (UseConv) {
+			PixConvRect(&Conv, Src, SrcPitch, Dst, kWidth * PixelBytes,
+				kWidth, kHeight);
+		} else {
+			PixelLoop(Depth, Format);
+		}
+		++Frames;
+		Seconds = (double)(clock() - t0) / CLOCKS_PER_SEC;
+	} while (Seconds < kMinSeconds);
+
+	return Frames * (double)kWidth * kHeight / Seconds / 1e6;
+}
+
+int main(void)
+{
+	static const char *FormatNames[kNumPixFmts] = { "RGB565", "RGBA8" };
+	int Depth;
+	int Format;
+	int i;
+
+	for (i = 0; i < 256; ++i) {
+		Reds[i] = rand() & 0xFFFF;
+		Greens[i] = rand() & 0xFFFF;
+		Blues[i] = rand() & 0xFFFF;
+	}
+	for (i = 0; i < (int)sizeof(Src); ++i) {
+		Src[i] = rand();
+	}
+
+	printf("bpp  format  table MP/s  pixel loop MP/s\n");
+	for (Depth = 0; Depth <= 3; ++Depth) {
+		for (Format = 0; Format < kNumPixFmts; ++Format) {
+			PixConvSetup(&Conv, Depth, Format, Reds, Greens, Blues);
+			printf("%3d  %-6s  %10.1f  %15.1f\n", 1 << Depth,
+				FormatNames[Format],
+				MegaPixelsPerSecond(Depth, Format, 1),
+				MegaPixelsPerSecond(Depth, Format, 0));
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,168 @@
+/*
+	pixconv_test.c
+
+	Checks src/PIXCONV.c against a pixel at a time reference,
+	for every depth and output format, every source byte value
+	in every position, every width up to 256 source bytes, and
+	random rectangles. Also checks that nothing outside the
+	rectangle is written.
+
+	Builds on any desktop:
+
+		cc -O2 -I../src -o pixconv_test pixconv_test.c ../src/PIXCONV.c
+
+	Prints "ok" and exits with 0 if everything matches.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SYSDEPNS.h"
+#include "PIXCONV.h"
+
+#define kMaxSrcPitch 300
+#define kMaxDstPitch (kMaxSrcPitch * kPixConvMaxBytes + 16)
+#define kMaxRows 4
+#define kGuard 0xA5
+
+static ui4r Reds[256];
+static ui4r Greens[256];
+static ui4r Blues[256];
+
+static ui3b Src[kMaxRows * kMaxSrcPitch];
+static ui3b Got[kMaxRows * kMaxDstPitch];
+static ui3b Want[kMaxRows * kMaxDstPitch];
+
+static PixConv Conv;
+
+static unsigned long NumChecks = 0;
+static unsigned long NumFailures = 0;
+
+static void RandomPalette(void)
+{
+	int i;
+
+	for (i = 0; i < 256; ++i) {
+		Reds[i] = rand() & 0xFFFF;
+		Greens[i] = rand() & 0xFFFF;
+		Blues[i] = rand() & 0xFFFF;
+	}
+}
+
+/* one pixel, written out the obvious way */
+static void RefPixel(int Format, int i, ui3p p)
+{
+	unsigned r = Reds[i] >> 8;
+	unsigned g = Greens[i] >> 8;
+	unsigned b = Blues[i] >> 8;
+	unsigned long v;
+
+	if (kPixFmtRGBA8 == Format) {
+		v = ((unsigned long)r << 24) | (g << 16) | (b << 8) | 0xFF;
+		p[0] = v;
+		p[1] = v >> 8;
+		p[2] = v >> 16;
+		p[3] = v >> 24;
+	} else {
+		v = ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+		p[0] = v;
+		p[1] = v >> 8;
+	}
+}
+
+static void RefRect(int Depth, int Format, ui3p s, int SrcPitch,
+	ui3p d, int DstPitch, int Width, int Height)
+{
+	int Bits = 1 << Depth;
+	int PixelBytes = (kPixFmtRGBA8 == Format) ? 4 : 2;
+	int x;
+	int y;
+	int bit;
+	int i;
+
+	for (y = 0; y < Height; ++y) {
+		for (x = 0; x < Width; ++x) {
+			bit = x * Bits;
+			i = (s[y * SrcPitch + bit / 8] >> (8 - Bits - bit % 8))
+				& ((1 << Bits) - 1);
+			RefPixel(Format, i, d + y * DstPitch + x * PixelBytes);
+		}
+	}
+}
+
+static void Check(int Depth, int Format, int SrcPitch, int DstPitch,
+	int Width, int Height)
+{
+	memset(Got, kGuard, sizeof(Got));
+	memset(Want, kGuard, sizeof(Want));
+	PixConvRect(&Conv, Src, SrcPitch, Got, DstPitch, Width, Height);
+	RefRect(Depth, Format, Src, SrcPitch, Want, DstPitch, Width, Height);
+
+	++NumChecks;
+	if (0 != memcmp(Got, Want, sizeof(Got))) {
+		if (++NumFailures <= 10) {
+			fprintf(stderr,
+				"mismatch: depth %d format %d width %d height %d\n",
+				Depth, Format, Width, Height);
+		}
+	}
+}
+
+static void CheckDepthFormat(int Depth, int Format)
+{
+	int PixelsPerByte = 8 >> Depth;
+	int PixelBytes = (kPixFmtRGBA8 == Format) ? 4 : 2;
+	int Width;
+	int i;
+	int n;
+
+	RandomPalette();
+	PixConvSetup(&Conv, Depth, Format, Reds, Greens, Blues);
+
+	/*
+		Each byte value in each position of a row: the rows
+		start with all 256 values, then the same shifted by
+		one, and so on, and every width is tried.
+	*/
+	for (i = 0; i < kMaxRows * kMaxSrcPitch; ++i) {
+		Src[i] = i % kMaxSrcPitch + i / kMaxSrcPitch;
+	}
+	for (Width = 1; Width <= 256 * PixelsPerByte; ++Width) {
+		Check(Depth, Format, kMaxSrcPitch,
+			Width * PixelBytes + 16, Width, kMaxRows);
+	}
+
+	/* random rectangles and pitches */
+	for (n = 0; n < 2000; ++n) {
+		int SrcPitch = 1 + rand() % kMaxSrcPitch;
+		int Width = 1 + rand() % (SrcPitch * PixelsPerByte);
+		int DstPitch = Width * PixelBytes + rand() % 16;
+		int Height = 1 + rand() % kMaxRows;
+
+		for (i = 0; i < kMaxRows * kMaxSrcPitch; ++i) {
+			Src[i] = rand();
+		}
+		Check(Depth, Format, SrcPitch, DstPitch, Width, Height);
+	}
+}
+
+int main(void)
+{
+	int Depth;
+	int Format;
+
+	srand(1);
+	for (Depth = 0; Depth <= 3; ++Depth) {
+		for (Format = 0; Format < kNumPixFmts; ++Format) {
+			CheckDepthFormat(Depth, Format);
+		}
+	}
+
+	if (0 != NumFailures) {
+		printf("%lu of %lu checks failed\n", NumFailures, NumChecks);
+		return 1;
+	}
+	printf("ok, %lu checks\n", NumChecks);
+	return 0;
+}
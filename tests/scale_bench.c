@@ -0,0 +1,123 @@
+/*
+	scale_bench.c
+
+	Times src/SCALE.c downscaling a 512 x 342 screen to the
+	sizes of the fit to screen modes, in microseconds per frame:
+	for a frame with one band of 8 rows changed, as when typing
+	or moving the mouse, and with every row changed, as when
+	scrolling, next to a floating point area average of the
+	whole screen for comparison.
+
+	Builds on any desktop:
+
+		cc -O2 -I../src -o scale_bench scale_bench.c ../src/SCALE.c -lm
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "SYSDEPNS.h"
+#include "SCALE.h"
+
+#define kSrcW 512
+#define kSrcH 342
+#define kSrcPitch (kSrcW / 8)
+#define kDstPitch 512
+#define kBandRows 8
+#define kMinSeconds 0.5
+
+static ui3b Screen[kSrcH * kSrcPitch];
+
+static ui3b Src[kSrcH * kSrcPitch + 1];
+static ui3b Across[kSrcH * kSrcW];
+static ui4b Dst[kSrcH * kDstPitch];
+static Scaler Scale;
+
+static void FloatScale(int w, int h)
+{
+	/* what the obvious way costs, an area average per pixel */
+	double sx = (double)kSrcW / w;
+	double sy = (double)kSrcH / h;
+	int x;
+	int y;
+	int i;
+	int j;
+
+	for (y = 0; y < h; ++y) {
+		for (x = 0; x < w; ++x) {
+			double x0 = x * sx;
+			double y0 = y * sy;
+			double d = 0;
+
+			for (j = (int)y0; j < y0 + sy; ++j) {
+				double cy = fmin(j + 1, y0 + sy) - fmax(j, y0);
+
+				for (i = (int)x0; i < x0 + sx; ++i) {
+					if (1 & (Screen[j * kSrcPitch + i / 8]
+						>> (7 - i % 8)))
+					{
+						d += cy * (fmin(i + 1, x0 + sx) - fmax(i, x0));
+					}
+				}
+			}
+			d = 255 - 255 * sqrt(d / (sx * sy));
+			Dst[y * kDstPitch + x] = (((int)d >> 3) << 11)
+				| (((int)d >> 2) << 5) | ((int)d >> 3);
+		}
+	}
+}
+
+static double MicrosecondsPerFrame(int w, int h, int Rows)
+{
+	unsigned long Frames = 0;
+	clock_t t0 = clock();
+	double Seconds;
+	uimr Top;
+	uimr Bottom;
+	int y;
+
+	do {
+		if (0 == Rows) {
+			FloatScale(w, h);
+		} else {
+			y = (Frames * Rows) % kSrcH;
+			if (y + Rows > kSrcH) {
+				y = kSrcH - Rows;
+			}
+			ScaleRows(&Scale, Screen, y, y + Rows, &Top, &Bottom);
+		}
+		++Frames;
+		Seconds = (double)(clock() - t0) / CLOCKS_PER_SEC;
+	} while (Seconds < kMinSeconds);
+
+	return Seconds * 1e6 / Frames;
+}
+
+int main(void)
+{
+	static const int Sizes[3][2] = {
+		{ 400, 240 }, /* stretch */
+		{ 400, 267 }, /* fit to width */
+		{ 359, 240 } /* fit to height */
+	};
+	int i;
+
+	for (i = 0; i < (int)sizeof(Screen); ++i) {
+		Screen[i] = rand() & rand();
+	}
+	ScaleInit(&Scale, kSrcW, kSrcH, Src, Across, Dst, kDstPitch);
+
+	printf("size      one band us  all rows us  float us\n");
+	for (i = 0; i < 3; ++i) {
+		ScaleSetSize(&Scale, Sizes[i][0], Sizes[i][1]);
+		printf("%3d x %3d  %11.1f  %11.1f  %8.1f\n",
+			Sizes[i][0], Sizes[i][1],
+			MicrosecondsPerFrame(Sizes[i][0], Sizes[i][1], kBandRows),
+			MicrosecondsPerFrame(Sizes[i][0], Sizes[i][1], kSrcH),
+			MicrosecondsPerFrame(Sizes[i][0], Sizes[i][1], 0));
+	}
+
+	return 0;
+}
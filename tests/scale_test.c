@@ -0,0 +1,300 @@
+/*
+	scale_test.c
+
+	Checks src/SCALE.c, downscaling a 512 x 342 screen to the
+	sizes of the fit to screen modes and random others:
+
+		against a floating point reference, the exact average
+		of the area under each output pixel, on the same tone
+		curve, to within kTolerance of 255 in each channel
+		(RGB565 alone rounds away up to 8);
+
+		that a one pixel line, across or down, at every place
+		on the screen, leaves an output row or column at least
+		half dark;
+
+		that redoing only changed rows gives exactly the output
+		of scaling everything again, and writes nothing past
+		the output width.
+
+	Also that sizes needing more than kScaleMaxTaps source
+	pixels per output pixel are turned down.
+
+	Builds on any desktop:
+
+		cc -O2 -I../src -o scale_test scale_test.c ../src/SCALE.c -lm
+
+	Prints "ok" and exits with 0 if everything matches.
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SYSDEPNS.h"
+#include "SCALE.h"
+
+#define kSrcW 512
+#define kSrcH 342
+#define kSrcPitch (kSrcW / 8)
+#define kDstPitch 512
+#define kGuard 0xA5A5
+#define kTolerance 12
+
+static ui3b Screen[kSrcH * kSrcPitch];
+
+static ui3b Src[kSrcH * kSrcPitch + 1];
+static ui3b Across[kSrcH * kSrcW];
+static ui4b Dst[kSrcH * kDstPitch];
+static Scaler Scale;
+
+static ui3b Src2[kSrcH * kSrcPitch + 1];
+static ui3b Across2[kSrcH * kSrcW];
+static ui4b Dst2[kSrcH * kDstPitch];
+static Scaler Scale2;
+
+static unsigned long NumChecks = 0;
+static unsigned long NumFailures = 0;
+static int WorstError = 0;
+
+static void Fail(char *s, int w, int h, int a, int b)
+{
+	if (++NumFailures <= 10) {
+		fprintf(stderr, "%s: %d x %d at %d, %d\n", s, w, h, a, b);
+	}
+}
+
+static int Pixel(int x, int y)
+{
+	return (Screen[y * kSrcPitch + x / 8] >> (7 - x % 8)) & 1;
+}
+
+/* how much of [p, p + 1) lies in [a, b) */
+static double Overlap(int p, double a, double b)
+{
+	double l = (p > a) ? p : a;
+	double r = (p + 1 < b) ? p + 1 : b;
+
+	return (r > l) ? r - l : 0;
+}
+
+static int RefGray(int w, int h, int x, int y)
+{
+	double x0 = (double)x * kSrcW / w;
+	double x1 = (double)(x + 1) * kSrcW / w;
+	double y0 = (double)y * kSrcH / h;
+	double y1 = (double)(y + 1) * kSrcH / h;
+	double d = 0;
+	int i;
+	int j;
+
+	for (j = (int)y0; j < y1; ++j) {
+		for (i = (int)x0; i < x1; ++i) {
+			if (Pixel(i, j)) {
+				d += Overlap(i, x0, x1) * Overlap(j, y0, y1);
+			}
+		}
+	}
+	d /= (x1 - x0) * (y1 - y0);
+
+	return (int)(255 - 255 * sqrt(d) + 0.5);
+}
+
+/* the three channels of an output pixel, each 0 to 255 */
+static void Channels(ui4r v, int *c)
+{
+	c[0] = (v >> 11) * 255 / 31;
+	c[1] = ((v >> 5) & 0x3F) * 255 / 63;
+	c[2] = (v & 0x1F) * 255 / 31;
+}
+
+static void CheckRef(int w, int h)
+{
+	int c[3];
+	int Want;
+	int e;
+	int x;
+	int y;
+	int k;
+
+	++NumChecks;
+	for (y = 0; y < h; ++y) {
+		for (x = 0; x < w; ++x) {
+			Want = RefGray(w, h, x, y);
+			Channels(Dst[y * kDstPitch + x], c);
+			for (k = 0; k < 3; ++k) {
+				e = abs(c[k] - Want);
+				if (e > WorstError) {
+					WorstError = e;
+				}
+				if (e > kTolerance) {
+					Fail("off from the reference", w, h, x, y);
+					return;
+				}
+			}
+		}
+	}
+}
+
+static void Rescale(int w, int h)
+{
+	uimr Top;
+	uimr Bottom;
+
+	ScaleRows(&Scale, Screen, 0, kSrcH, &Top, &Bottom);
+	ScaleSetSize(&Scale, w, h);
+}
+
+static int Green(ui4r v)
+{
+	return ((v >> 5) & 0x3F) * 255 / 63;
+}
+
+static void CheckLines(int w, int h)
+{
+	int Darkest;
+	int x;
+	int y;
+	int i;
+
+	/* each row alone, then each column alone */
+	for (i = 0; i < kSrcH + kSrcW; ++i) {
+		memset(Screen, 0, sizeof(Screen));
+		if (i < kSrcH) {
+			memset(Screen + i * kSrcPitch, 0xFF, kSrcPitch);
+		} else {
+			for (y = 0; y < kSrcH; ++y) {
+				Screen[y * kSrcPitch + (i - kSrcH) / 8] =
+					0x80 >> ((i - kSrcH) % 8);
+			}
+		}
+		Rescale(w, h);
+
+		Darkest = 255;
+		for (y = 0; y < h; ++y) {
+			for (x = 0; x < w; ++x) {
+				if (Green(Dst[y * kDstPitch + x]) < Darkest) {
+					Darkest = Green(Dst[y * kDstPitch + x]);
+				}
+			}
+		}
+		++NumChecks;
+		if (Darkest > 128) {
+			Fail("line lost", w, h, i, Darkest);
+		}
+	}
+}
+
+static void CheckIncremental(int w, int h)
+{
+	uimr Top;
+	uimr Bottom;
+	uimr DstTop;
+	uimr DstBottom;
+	int n;
+	int i;
+	int y;
+
+	for (i = 0; i < (int)sizeof(Screen); ++i) {
+		Screen[i] = rand();
+	}
+	ScaleSetSize(&Scale2, 0, 0);
+	for (i = 0; i < (int)sizeof(Dst) / 2; ++i) {
+		Dst[i] = kGuard;
+		Dst2[i] = kGuard;
+	}
+	Rescale(w, h);
+
+	for (n = 0; n < 50; ++n) {
+		/* a few rows change */
+		Top = rand() % kSrcH;
+		Bottom = Top + 1 + rand() % 16;
+		if (Bottom > kSrcH) {
+			Bottom = kSrcH;
+		}
+		for (i = Top * kSrcPitch; i < (int)(Bottom * kSrcPitch); ++i) {
+			Screen[i] = rand() & rand();
+		}
+		if (! ScaleRows(&Scale, Screen, Top, Bottom,
+			&DstTop, &DstBottom))
+		{
+			Fail("not scaling", w, h, Top, Bottom);
+			return;
+		}
+
+		/* against starting over */
+		ScaleRows(&Scale2, Screen, 0, kSrcH, &DstTop, &DstBottom);
+		ScaleSetSize(&Scale2, w, h);
+
+		++NumChecks;
+		for (y = 0; y < kSrcH; ++y) {
+			if (0 != memcmp(Dst + y * kDstPitch, Dst2 + y * kDstPitch,
+				kDstPitch * 2))
+			{
+				Fail("incremental differs", w, h, n, y);
+				return;
+			}
+		}
+		if ((w < kDstPitch) && (kGuard != Dst[w])) {
+			Fail("wrote past the width", w, h, n, 0);
+			return;
+		}
+	}
+}
+
+static void CheckSize(int w, int h)
+{
+	int i;
+
+	for (i = 0; i < (int)sizeof(Screen); ++i) {
+		Screen[i] = rand() & rand() & rand();
+	}
+	Rescale(w, h);
+	CheckRef(w, h);
+	for (i = 0; i < (int)sizeof(Screen); ++i) {
+		Screen[i] = rand() | rand();
+	}
+	Rescale(w, h);
+	CheckRef(w, h);
+	CheckIncremental(w, h);
+}
+
+int main(void)
+{
+	int n;
+
+	srand(1);
+	ScaleInit(&Scale, kSrcW, kSrcH, Src, Across, Dst, kDstPitch);
+	ScaleInit(&Scale2, kSrcW, kSrcH, Src2, Across2, Dst2, kDstPitch);
+
+	/* stretch, fit to width and fit to height on a 400 x 240 screen */
+	CheckSize(400, 240);
+	CheckSize(400, 267);
+	CheckSize(359, 240);
+	CheckLines(400, 240);
+	CheckLines(359, 240);
+
+	CheckSize(kSrcW, kSrcH);
+	CheckSize(kSrcW / 2, kSrcH / 2);
+	for (n = 0; n < 20; ++n) {
+		CheckSize(kSrcW / 2 + rand() % (kSrcW / 2),
+			(kSrcH + 1) / 2 + rand() % (kSrcH / 2));
+	}
+
+	++NumChecks;
+	if (ScaleSetSize(&Scale, kSrcW / 2 - 1, 240)
+		|| ScaleSetSize(&Scale, 400, kSrcH + 1)
+		|| ScaleSetSize(&Scale, 0, 0)
+		|| (0 != Scale.DstW))
+	{
+		Fail("size not turned down", 0, 0, 0, 0);
+	}
+
+	if (0 != NumFailures) {
+		printf("%lu of %lu checks failed\n", NumFailures, NumChecks);
+		return 1;
+	}
+	printf("ok, %lu checks, worst error %d\n", NumChecks, WorstError);
+	return 0;
+}
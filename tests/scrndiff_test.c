@@ -0,0 +1,168 @@
+/*
+	scrndiff_test.c
+
+	Checks src/SCRNDIFF.c against a pixel at a time reference:
+	every row length up to kMaxBytes with each single pixel
+	changed, every pair of changed pixels in a row of the Mac
+	screen's 64 bytes, rows with nothing or everything changed,
+	and random rows. The bytes after each row differ, to check
+	that nothing past the row is looked at.
+
+	Builds on any desktop:
+
+		cc -O2 -I../src -o scrndiff_test scrndiff_test.c \
+			../src/SCRNDIFF.c
+
+	which uses the widest way the compiler allows. Each of the
+	others can be checked by adding -mavx2, or
+	-DScrnDiffUse=kScrnDiffSSE2, kScrnDiffARMv6 or kScrnDiffWords
+	(ARMv6 is plain C, so runs anywhere).
+
+	Prints "ok" and exits with 0 if everything matches.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SYSDEPNS.h"
+#include "SCRNDIFF.h"
+
+#define kMaxBytes 160
+#define kRowBytes 64
+#define kGuardBytes 64
+
+static union {
+	double Align;
+	ui3b b[kMaxBytes + kGuardBytes];
+} Row1, Row2;
+
+static unsigned long NumChecks = 0;
+static unsigned long NumFailures = 0;
+
+static int RefBit(ui3p p, int i)
+{
+	return (p[i / 8] >> (7 - i % 8)) & 1;
+}
+
+/* the first and one past the last differing pixel, one by one */
+static blnr RefRow(ui3p p1, ui3p p2, int n, int *left, int *right)
+{
+	int i;
+
+	*left = -1;
+	for (i = 0; i < n * 8; ++i) {
+		if (RefBit(p1, i) != RefBit(p2, i)) {
+			if (*left < 0) {
+				*left = i;
+			}
+			*right = i + 1;
+		}
+	}
+	return (*left >= 0);
+}
+
+static void Check(int n)
+{
+	uimr l = 0;
+	uimr r = 0;
+	int rl = 0;
+	int rr = 0;
+	blnr Got;
+	blnr Want;
+	int i;
+
+	for (i = n; i < n + kGuardBytes; ++i) {
+		Row1.b[i] = 0x00;
+		Row2.b[i] = 0xFF;
+	}
+	Got = ScrnDiffRow(Row1.b, Row2.b, n, &l, &r);
+	Want = RefRow(Row1.b, Row2.b, n, &rl, &rr);
+
+	++NumChecks;
+	if ((Got != Want)
+		|| (Want && ((l != (uimr)rl) || (r != (uimr)rr))))
+	{
+		if (++NumFailures <= 10) {
+			fprintf(stderr,
+				"mismatch: n %d, got %d %lu %lu, want %d %d %d\n",
+				n, (int)Got, (unsigned long)l, (unsigned long)r,
+				(int)Want, rl, rr);
+		}
+	}
+}
+
+static void RandomRow(int n)
+{
+	int i;
+
+	for (i = 0; i < n; ++i) {
+		Row1.b[i] = rand();
+	}
+	memcpy(Row2.b, Row1.b, n);
+}
+
+static void FlipBit(int i)
+{
+	Row2.b[i / 8] ^= 0x80 >> (i % 8);
+}
+
+int main(void)
+{
+	int n;
+	int i;
+	int j;
+	int k;
+
+	srand(1);
+	printf("%s\n", ScrnDiffName);
+
+	/* each length, unchanged, then each pixel alone */
+	for (n = 1; n <= kMaxBytes; ++n) {
+		RandomRow(n);
+		Check(n);
+		for (i = 0; i < n * 8; ++i) {
+			FlipBit(i);
+			Check(n);
+			FlipBit(i);
+		}
+	}
+
+	/* each pair of pixels in a screen row */
+	RandomRow(kRowBytes);
+	for (i = 0; i < kRowBytes * 8; ++i) {
+		FlipBit(i);
+		for (j = i + 1; j < kRowBytes * 8; ++j) {
+			FlipBit(j);
+			Check(kRowBytes);
+			FlipBit(j);
+		}
+		FlipBit(i);
+	}
+
+	/* everything changed */
+	for (n = 1; n <= kMaxBytes; ++n) {
+		RandomRow(n);
+		for (i = 0; i < n; ++i) {
+			Row2.b[i] = ~ Row1.b[i];
+		}
+		Check(n);
+	}
+
+	/* random rows, with a few changes each */
+	for (k = 0; k < 100000; ++k) {
+		n = 1 + rand() % kMaxBytes;
+		RandomRow(n);
+		for (j = rand() % 4; j > 0; --j) {
+			Row2.b[rand() % n] = rand();
+		}
+		Check(n);
+	}
+
+	if (0 != NumFailures) {
+		printf("%lu of %lu checks failed\n", NumFailures, NumChecks);
+		return 1;
+	}
+	printf("ok, %lu checks\n", NumChecks);
+	return 0;
+}
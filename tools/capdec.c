@@ -0,0 +1,209 @@
+/*
+	capdec.c
+
+	Decoder for the screen recordings made with WantScreenCapture
+	(see "screen capture" in src/MYOSGLUE.c for the format).
+
+	Builds on any desktop with zlib:
+
+		cc -O2 -o capdec capdec.c -lz
+
+	Usage:
+
+		capdec capture.vms.gz
+			lists the records and totals
+		capdec capture.vms.gz prefix
+			also writes the screen after each record as
+			prefix<tick>.pbm, for comparing runs with cmp or
+			any image diff
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+static gzFile InFile;
+static unsigned char *Screen;
+static unsigned long Width;
+static unsigned long Height;
+static unsigned long RowBytes;
+
+static int GetBytes(void *p, unsigned long n)
+{
+	return gzread(InFile, p, n) == (int)n;
+}
+
+static int GetNum(unsigned long *v, int n)
+{
+	unsigned char b[4];
+	int i;
+
+	if (! GetBytes(b, n)) {
+		return 0;
+	}
+	*v = 0;
+	for (i = n; --i >= 0; ) {
+		*v = (*v << 8) | b[i];
+	}
+	return 1;
+}
+
+static int WriteFrame(char *prefix, unsigned long tick)
+{
+	char path[1024];
+	FILE *f;
+	int ok;
+
+	snprintf(path, sizeof(path), "%s%010lu.pbm", prefix, tick);
+	f = fopen(path, "wb");
+	if (NULL == f) {
+		perror(path);
+		return 0;
+	}
+
+	/* 1 is black in both the Mac screen and pbm */
+	fprintf(f, "P4\n%lu %lu\n", Width, Height);
+	ok = fwrite(Screen, RowBytes, Height, f) == Height;
+	if (0 != fclose(f)) {
+		ok = 0;
+	}
+	if (! ok) {
+		perror(path);
+	}
+	return ok;
+}
+
+/* Reads the rectangles of a delta record into Screen */
+static int GetDelta(unsigned long *nbytes)
+{
+	unsigned long n;
+	unsigned long top;
+	unsigned long bottom;
+	unsigned long first;
+	unsigned long count;
+	unsigned long row;
+
+	if (! GetNum(&n, 1)) {
+		return 0;
+	}
+	while (n-- > 0) {
+		if (! (GetNum(&top, 2) && GetNum(&bottom, 2)
+			&& GetNum(&first, 2) && GetNum(&count, 2)))
+		{
+			return 0;
+		}
+		if ((top > bottom) || (bottom > Height)
+			|| (first + count > RowBytes))
+		{
+			fprintf(stderr, "bad rectangle %lu %lu %lu %lu\n",
+				top, bottom, first, count);
+			return 0;
+		}
+		for (row = top; row < bottom; ++row) {
+			if (! GetBytes(Screen + row * RowBytes + first, count)) {
+				return 0;
+			}
+		}
+		*nbytes += 8 + (bottom - top) * count;
+	}
+	return 1;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned char magic[5];
+	unsigned long kind;
+	unsigned long tick;
+	unsigned long nbytes;
+	unsigned long nkeys = 0;
+	unsigned long ndeltas = 0;
+	unsigned long deltabytes = 0;
+	unsigned long firsttick = 0;
+	unsigned long lasttick = 0;
+	int haveKey = 0;
+	int ended = 0;
+	char *prefix = NULL;
+
+	if ((argc < 2) || (argc > 3)) {
+		fprintf(stderr, "usage: %s capture.vms.gz [prefix]\n",
+			argv[0]);
+		return 2;
+	}
+	if (3 == argc) {
+		prefix = argv[2];
+	}
+
+	InFile = gzopen(argv[1], "rb");
+	if (NULL == InFile) {
+		perror(argv[1]);
+		return 1;
+	}
+
+	if (! (GetBytes(magic, 5) && GetNum(&Width, 2) && GetNum(&Height, 2))
+		|| (0 != memcmp(magic, "vMSC", 4)) || (1 != magic[4]))
+	{
+		fprintf(stderr, "%s: not a version 1 capture\n", argv[1]);
+		return 1;
+	}
+	RowBytes = (Width + 7) / 8;
+	Screen = calloc(RowBytes, Height);
+	if (NULL == Screen) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+
+	while (GetNum(&kind, 1)) {
+		if (! GetNum(&tick, 4)) {
+			break;
+		}
+		if ('E' == kind) {
+			ended = 1;
+			break;
+		}
+
+		nbytes = 0;
+		if ('K' == kind) {
+			if (! GetBytes(Screen, RowBytes * Height)) {
+				break;
+			}
+			nbytes = RowBytes * Height;
+			++nkeys;
+			haveKey = 1;
+		} else if ('D' == kind) {
+			if (! haveKey) {
+				fprintf(stderr, "delta before any keyframe\n");
+				return 1;
+			}
+			if (! GetDelta(&nbytes)) {
+				break;
+			}
+			++ndeltas;
+			deltabytes += nbytes;
+		} else {
+			fprintf(stderr, "unknown record kind %lu\n", kind);
+			return 1;
+		}
+
+		if (0 == nkeys + ndeltas - 1) {
+			firsttick = tick;
+		}
+		lasttick = tick;
+		printf("%10lu %c %lu\n", tick, (int)kind, nbytes);
+
+		if ((NULL != prefix) && ! WriteFrame(prefix, tick)) {
+			return 1;
+		}
+	}
+
+	printf("%lu keyframes, %lu deltas (%lu bytes), ticks %lu to %lu\n",
+		nkeys, ndeltas, deltabytes, firsttick, lasttick);
+	if (! ended) {
+		fprintf(stderr, "capture was cut short\n");
+	}
+
+	gzclose(InFile);
+	free(Screen);
+
+	return ended ? 0 : 1;
+}